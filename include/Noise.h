@@ -15,6 +15,8 @@
 #ifndef __Noise_H__
 #define __Noise_H__
 
+#include <stddef.h>
+
 // noise basis functions
 #define NOISE_IMPROVED_PERLIN	1
 #define NOISE_VORONOI_F1		2
@@ -26,6 +28,9 @@
 #define NOISE_CELL  		    8
 #define NOISE_BLENDER			9
 
+// seed of the default permutation table
+#define NOISE_DEFAULT_SEED      1
+
 // voronoi distance metrics
 #define VORONOI_DIST_REAL       0
 #define VORONOI_DIST_SQUARED    1
@@ -35,16 +40,38 @@
 #define VORONOI_DIST_MINKOVSKYH 5
 #define VORONOI_DIST_MINKOVSKY4 6
 
+#ifdef _WIN32
+#define NOISE_CACHE_ALIGN __declspec(align(64))
+#else
+#define NOISE_CACHE_ALIGN __attribute__((aligned(64)))
+#endif
+
+// the lookup data of one permutation table, packed and cache line aligned. gradient and point
+// already include the last permutation step: gradient[i] is the 3d perlin gradient of hash[i],
+// point[i] the voronoi feature point of hash[i] (the 4th component is padding)
+struct NOISE_CACHE_ALIGN NoiseTable
+{
+    float           gradient[512][4];
+    float           point[256][4];
+    unsigned char   hash[512];
+};
+
 
 class Noise
 {
     public:
     	Noise();
-//    	Noise( const unsigned int seed );
+    	Noise( const unsigned int seed );
     	~Noise();
 
+        // the permutation table decides the pattern of the perlin, voronoi and blender noise (the cell noise
+        // hashes the seed itself), NOISE_DEFAULT_SEED gives the original table of Ken Perlin, every other seed
+        // a shuffled one. the shuffled tables are built once and cached (32 seeds), switching seeds is a locked
+        // cache lookup and the instance keeps pointing at the cached table, a seed that isn't cached costs a
+        // table build (a shuffle and about 12KB of folded lookups)
 	    void defaultPermutationTable();
     	void reshufflePermutationTable( const unsigned int seed );
+        unsigned int seed() const { return tableSeed; }
 
         // general noise call for signed noise (just a convinience wrapper)
            float noise3dS(float x, float y, float z, int noiseBasis);
@@ -98,6 +125,28 @@ class Noise
             float improvedPerlin3dS(float x, float y, float z);                        
             float improvedPerlin4dS(float x, float y, float z, float w);
 
+            // improved perlin over n samples at once, the results match the single sample calls
+            void improvedPerlin1dS(const float* x, float* out, size_t n);
+            void improvedPerlin2dS(const float* x, const float* y, float* out, size_t n);
+            void improvedPerlin3dS(const float* x, const float* y, const float* z, float* out, size_t n);
+            void improvedPerlin4dS(const float* x, const float* y, const float* z, const float* w, float* out, size_t n);
+
+            // periodic improved perlin over n samples, the lattice wraps every period[d] cells along axis d, so the
+            // noise tiles with that period, a period of 0 leaves the axis unbounded (a period only for w loops 3d noise in time)
+            void improvedPerlin1dS(const float* x, float* out, size_t n, const int period[1]);
+            void improvedPerlin2dS(const float* x, const float* y, float* out, size_t n, const int period[2]);
+            void improvedPerlin3dS(const float* x, const float* y, const float* z, float* out, size_t n, const int period[3]);
+            void improvedPerlin4dS(const float* x, const float* y, const float* z, const float* w, float* out, size_t n, const int period[4]);
+
+            // improved perlin along a scanline, n samples at x + i * dx with the same y and z, the permutation
+            // table lookups are shared by the samples in the same lattice cell
+            void improvedPerlin3dRowS(float x, float dx, float y, float z, float* out, size_t n);
+
+            // improved perlin with its analytic gradient (d/dx, d/dy, d/dz) in the same pass, single and n samples
+            float improvedPerlin3dS(float x, float y, float z, float grad[3]);
+            void improvedPerlin3dS(const float* x, const float* y, const float* z, float* out,
+                                   float* gx, float* gy, float* gz, size_t n);
+
             // voronoi / worley
             float voronoiF1S(float x, float y, float z);
             float voronoiF2S(float x, float y, float z);
@@ -120,6 +169,35 @@ class Noise
             float musgraveHybridMultiFractalS(float x, float y, float z, float H, float lacunarity, float octaves, float offset, float gain, int noiseBasis);
             float musgraveRidgedMultiFractalS(float x, float y, float z, float H, float lacunarity, float octaves, float offset, float gain, int noiseBasis);               
               
+
+        // batched versions over n samples, the parameters are given per sample, the noise basis
+        // and the voronoi distance metric (with the minkovsky exponent) are the same for all of them
+        // with the default distance metric, the results match the single sample calls
+
+            // general noise call for signed noise
+            void noise3dS(const float* x, const float* y, const float* z, float* out, size_t n,
+                          int noiseBasis, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+
+            // mussgrave noise functions
+            void musgraveFBmS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves,
+                              float* out, size_t n, int noiseBasis, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+            void musgraveMultiFractalS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves,
+                                       float* out, size_t n, int noiseBasis, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+            void musgraveVLNoiseS(const float* x, const float* y, const float* z, const float* distortion,
+                                  float* out, size_t n, int noiseBasis1, int noiseBasis2, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+            void musgraveHeteroTerrainS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset,
+                                        float* out, size_t n, int noiseBasis, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+            void musgraveHybridMultiFractalS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset, const float* gain,
+                                             float* out, size_t n, int noiseBasis, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+            void musgraveRidgedMultiFractalS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset, const float* gain,
+                                             float* out, size_t n, int noiseBasis, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+
+            // turbulence, the octave counts (truncated to int) can differ per sample, the vector comes back in vx, vy, vz
+            void turbulence3dS(const float* x, const float* y, const float* z, const float* octaves, const float* lacunarity, const float* gain,
+                               float* out, size_t n, bool hard, int noiseBasis, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+            void turbulenceVector(const float* x, const float* y, const float* z, const float* octaves, const float* lacunarity, const float* gain,
+                                  float* vx, float* vy, float* vz, size_t n, bool hard, int noiseBasis, int distanceMetric = VORONOI_DIST_REAL, float exponent = 2.5f);
+
         
         // tools
         float unsignedToSignedNoiseValue(float x);
@@ -132,13 +210,18 @@ class Noise
         int floor( const float x ) { return ((int)(x) - ((x) < 0 && (x) != (int)(x)));  }
 	    float gradient( const int hash, const float x );
     	float gradient( const int hash, const float x, const float y );
-    	float gradient( const int hash, const float x, const float y, const float z );
     	float gradient( const int hash, const float x, const float y, const float z, const float w );
             
-//     	unsigned char hash[512];					// permutation table
+     	const NoiseTable *table;                    // permutation table and the lookups folded with it, shared and pinned
+        unsigned int  tableSeed;                    // seed of the permutation table
+        unsigned int  cellSeed;                     // mixed into the cell noise hash, 0 for the default seed
 
         // worley / voronoi
         void  voronoi(float x, float y, float z, float* da, float* pa, float me, int dtype);
+
+        // not copyable, an instance holds a reference on its cached table
+        Noise( const Noise & );
+        Noise& operator=( const Noise & );
 };
 
 #endif // Noise
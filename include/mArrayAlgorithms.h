@@ -0,0 +1,78 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// whole array algorithms (reductions ...) on the flat double layout, threaded through parallelFor
+//
+// data points to count elements of the given number of interleaved components (1 for a double
+// array, ELEMENTS_VEC for a vector array ...). All per chunk partial results are combined in chunk
+// order, so the results don't depend on the number of threads.
+
+#ifndef _mArrayAlgorithms_h_
+#define _mArrayAlgorithms_h_
+
+#include <vector>
+
+
+namespace melfunctions
+{
+
+// biggest number of interleaved components the reductions handle (a matrix)
+#define REDUCE_MAX_ELEMENTS 16
+
+
+// per component sum, pairwise or (compensated = true) Kahan-Babuska compensated
+void reduceSum(const double *data, const unsigned int count, const unsigned int elements, const bool compensated, double *sum);
+
+// per component sum of weight[i]*data[i], weights are read at weights[i*weightStride] (stride 0 broadcasts)
+void reduceWeightedSum(const double *data, const unsigned int count, const unsigned int elements,
+					   const double *weights, const unsigned int weightStride, const bool compensated,
+					   double *sum, double &weightSum);
+
+// per component minimum and maximum, count has to be > 0
+void reduceMinMax(const double *data, const unsigned int count, const unsigned int elements, double *min, double *max);
+
+// mean and population variance of a double array, count has to be > 0
+void reduceMeanVariance(const double *data, const unsigned int count, double &mean, double &variance);
+
+
+// stable radix sort of a double array, either output may be NULL
+// sorted receives the values in order, order[i] the original index of the i-th value
+// -0.0 sorts before 0.0, NaNs with the sign bit set end up first, others last
+void radixSortDoubles(const double *data, const unsigned int count, const bool descending, double *sorted, unsigned int *order);
+
+
+// prefix sum, inclusive (out[i] = data[0]+...+data[i]) or exclusive (out[i] = data[0]+...+data[i-1])
+void scanSum(const double *data, const unsigned int count, const bool inclusive, double *out);
+
+// first pass of a compaction: count the non zero mask values per chunk and turn the counts into
+// the chunk write offsets, returns the number of elements that will be kept
+unsigned int compactOffsets(const double *mask, const unsigned int count, std::vector<unsigned int> &offsets);
+
+// second pass: copy the elements with a non zero mask value to out, in their original order
+// if data is NULL the indices of the kept elements are written instead (one value each)
+void compactByMask(const double *data, const unsigned int count, const unsigned int elements, const double *mask,
+				   const std::vector<unsigned int> &offsets, double *out);
+
+
+// count the values in bins equal sized bins between min and max, min and max are read at min[i*minStride],
+// max[i*maxStride] (stride 0 broadcasts, same for the data), values outside [min,max] and NaNs are not counted
+void histogramCounts(const double *data, const unsigned int dataStride,
+					 const double *min, const unsigned int minStride,
+					 const double *max, const unsigned int maxStride,
+					 const unsigned int count, const unsigned int bins, unsigned int *counts);
+
+// bucket index of every value for the ascending edges: the number of edges <= the value
+// (0 below the first edge, edgeCount at or above the last one and for NaNs)
+void digitize(const double *data, const unsigned int count, const double *edges, const unsigned int edgeCount, double *out);
+
+}//end namespace
+#endif
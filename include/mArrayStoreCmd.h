@@ -0,0 +1,171 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef _mArrayStoreCmd_h_
+#define _mArrayStoreCmd_h_
+
+#include <maya/MPxCommand.h>
+#include <maya/MArgList.h>
+#include <maya/MDoubleArray.h>
+#include <maya/MString.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mHelperMacros.h"
+
+
+namespace melfunctions
+{
+
+static const char* MAS_COMMAND_NAME = "mArrayStore";
+
+static const char* MAS_HELP_FLAG = "h";
+static const char* MAS_HELP_FLAG_LONG = "help";
+
+// things that can be created, edited and queried
+static const char* MAS_VALUES_FLAG = "v";
+static const char* MAS_VALUES_FLAG_LONG = "values";
+
+static const char* MAS_TYPE_FLAG = "t";
+static const char* MAS_TYPE_FLAG_LONG = "type";
+
+static const char* MAS_SINGLE_FLAG = "s";
+static const char* MAS_SINGLE_FLAG_LONG = "single";
+
+static const char* MAS_COUNT_FLAG = "c";
+static const char* MAS_COUNT_FLAG_LONG = "count";
+
+// delete the named store object
+static const char* MAS_DELETE_FLAG = "d";
+static const char* MAS_DELETE_FLAG_LONG = "delete";
+
+// delete all store objects
+static const char* MAS_DELETE_ALL_FLAG = "da";
+static const char* MAS_DELETE_ALL_FLAG_LONG = "deleteAll";
+
+// get a list of all created objects
+static const char* MAS_LIST_FLAG = "l";
+static const char* MAS_LIST_FLAG_LONG = "list";
+
+
+#define MAS_CMD_ACTION_CREATE 0
+#define MAS_CMD_ACTION_EDIT 1
+#define MAS_CMD_ACTION_QUERY 2
+
+#define MAS_CMD_CREATE_CREATE 0
+#define MAS_CMD_CREATE_DELETE_ALL 1
+#define MAS_CMD_CREATE_LIST 2
+
+#define MAS_CMD_EDIT_VALUES 0
+#define MAS_CMD_EDIT_DELETE 1
+
+#define MAS_CMD_QUERY_VALUES 0
+#define MAS_CMD_QUERY_COUNT 1
+#define MAS_CMD_QUERY_TYPE 2
+#define MAS_CMD_QUERY_SINGLE 3
+
+
+// a flat array living on the plugin side, in the same layout as the double arrays on the mel side
+// (elements values per element), stored either in double or, opt-in, in single precision
+struct mArrayStoreStruct
+{
+	mArrayStoreStruct() : elements(1), single(false) {}
+
+	// number of values (not elements) in the store
+	unsigned int length() const { return (unsigned int)(single ? flt.size() : dbl.size()); }
+	unsigned int count() const { return length() / elements; }
+
+	unsigned int		elements;
+	bool				single;
+	std::vector<double>	dbl;
+	std::vector<float>	flt;
+};
+
+typedef std::map < std::string, mArrayStoreStruct> mArrayStoreMapType;
+typedef	std::map < std::string, mArrayStoreStruct>::iterator mArrayStoreIterType;
+
+
+class mArrayStore : public MPxCommand
+{
+		public:
+						mArrayStore();
+                        ~mArrayStore(){};
+
+			MStatus		doIt( const MArgList& );
+			MStatus		doCreate();
+			MStatus		doEdit();
+			MStatus		doQuery();
+
+    		static		void* creator();
+
+            MStatus     parseArgs( const MArgList& args );
+            void        help() const;
+
+			// access to the stores for the commands working on them, displays an error if there is no such store
+			static		MStatus getStore(const MString &name, mArrayStoreStruct *&store);
+			// get the named store, create it if it doesn't exist (an empty name generates a new one)
+			static		mArrayStoreStruct& getOrCreateStore(MString &name);
+
+        private:
+
+			static		std::string generateStoreName();
+
+            bool        argParseIsFlagSet( const MArgList& args, const char *shortFlag, const char *longFlag, int &flagIndex);
+            MStatus     argParseGetObjectStringArg (const MArgList& args,MString& name);
+
+			MStatus		deleteStore();
+			MStatus		listAllStores();
+
+            short           mCmdAction;
+			short			mCreateAction;
+			short			mEditAction;
+			short			mQueryAction;
+
+            bool            mHelpFlagSet;
+			bool			mSingle;
+			unsigned int	mElements;
+            MString			mStoreName;
+
+            bool            mValuesFlagSet;
+            MDoubleArray    mValues;
+
+			// map storing all the array store objects
+			static	mArrayStoreMapType mASMap;
+            static  int mArrayStoreIndex;
+};
+
+
+// copy between the mel side double arrays and a store, converting the precision where needed
+void arrayStoreSetValues(mArrayStoreStruct &store, MDoubleArray &values);
+void arrayStoreGetValues(const mArrayStoreStruct &store, MDoubleArray &values);
+
+
+// in place versions of the Set commands, used when their first argument is the name of a store (see isStoreArg)
+// arrayStoreSetCmd: (store, ids, values) like mDblSet, mVecSet ...
+// arrayStoreSetComponentCmd: (store, values) for a fixed component >= 0, else (store, component, values),
+// for matrices (store, row, column, values)
+bool isStoreArg(const MArgList& args, const unsigned int argIndex);
+MStatus arrayStoreSetCmd(const MArgList& args, const unsigned int elements, MString &name);
+MStatus arrayStoreSetComponentCmd(const MArgList& args, const unsigned int elements, const int component, MString &name);
+
+// commands working on the stores directly, the result store is named by the first argument
+DECLARE_COMMAND(mStoreVecMatMult)
+DECLARE_COMMAND(mStoreMatMult)
+DECLARE_COMMAND(mStore3dNoise)
+
+
+}//end namespace
+
+
+#endif
@@ -26,5 +26,12 @@ DECLARE_COMMAND(mDblAppend)
 DECLARE_COMMAND(mDblGet)
 DECLARE_COMMAND(mDblSet)
 
+DECLARE_COMMAND(mDblSort)
+DECLARE_COMMAND(mDblArgSort)
+
+DECLARE_COMMAND(mDblScan)
+DECLARE_COMMAND(mDblCompact)
+DECLARE_COMMAND(mDblWhere)
+
 }//end namespace
 #endif
@@ -48,6 +48,29 @@ inline double distanceSqr(MVector a, MVector b)
 	return (pow((a.x-b.x),2)+pow((a.y-b.y),2)+pow((a.z-b.z),2));
 }
 
+// raw access for the threaded kernels (see mThreadPool.h)
+
+// pointer to the first value of an array, NULL for an empty array
+inline double* arrayPtr(MDoubleArray &a)
+{
+	return a.length() ? &a[0] : NULL;
+}
+
+// read only view on a (possibly broadcast) argument array as returned by the getArg functions,
+// element i starts at data[i*stride], offset selects a component of an interleaved type
+struct mArgStream
+{
+	mArgStream() : data(NULL), stride(0) {}
+	mArgStream(MDoubleArray &a, const unsigned int inc, const unsigned int elements = 1, const unsigned int offset = 0)
+		: data(a.length() ? &a[0] + offset : NULL), stride(inc * elements) {}
+
+	const double* ptr(const unsigned int i) const { return data + i * stride; }
+	double operator[](const unsigned int i) const { return data[i * stride]; }
+
+	const double	*data;
+	unsigned int	stride;
+};
+
 MString doubleArrayToString(MDoubleArray a);
 MString pointArrayToString(MPointArray a);
 MString matrixToString(MMatrix m);
@@ -139,6 +162,13 @@ MStatus getArgMatDbl(const MArgList& args, MDoubleArray  & matA,MDoubleArray  &
 MStatus getArgMatDblDbl(const MArgList& args, MDoubleArray  & matA,MDoubleArray  & dblB,MDoubleArray  & dblC, unsigned int &incA,unsigned int &incB,unsigned int &incC,unsigned int &count);
 MStatus getArgMatDblDblDbl(const MArgList& args, MDoubleArray  & matA,MDoubleArray  & dblB,MDoubleArray  & dblC,MDoubleArray  & dblD, unsigned int &incA,unsigned int &incB,unsigned int &incC,unsigned int &incD, unsigned int &count);
 MStatus getArgMatMatDbl(const MArgList& args, MDoubleArray  & matA,MDoubleArray  & matB, MDoubleArray  & dblC,unsigned int &incA,unsigned int &incB, unsigned int &incC, unsigned int &count);
+
+MStatus getArgQuat(const MArgList& args, MDoubleArray  & quatA,  unsigned int &count);
+MStatus getArgQuatQuat(const MArgList& args, MDoubleArray  & quatA,MDoubleArray  & quatB, unsigned int &incA,unsigned int &incB, unsigned int &count);
+MStatus getArgQuatQuatDbl(const MArgList& args, MDoubleArray  & quatA,MDoubleArray  & quatB, MDoubleArray  & dblC,unsigned int &incA,unsigned int &incB,unsigned int &incC, unsigned int &count);
+MStatus getArgVecQuat(const MArgList& args, MDoubleArray  & vecA,MDoubleArray  & quatB, unsigned int &incA,unsigned int &incB, unsigned int &count);
+
+MStatus getArgMask(const MArgList& args, const unsigned int elements, MDoubleArray  & a, MDoubleArray  & mask, unsigned int &count);
 }// namespace
 
 #endif
@@ -0,0 +1,542 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// closed form 4x4 matrix math working straight on the flat double layout of a matrix array
+//
+// m points to the 16 values of one matrix in row order (like MMatrix: the translation is in the
+// last row, points are multiplied from the left). Everything is inline straight line code without
+// branches on the values, so the batched kernels can be unrolled and vectorized by the compiler.
+
+#ifndef _mMatrixAlgorithms_h_
+#define _mMatrixAlgorithms_h_
+
+#include <math.h>
+
+
+namespace melfunctions
+{
+
+// matrices with an absolute 4x4 determinant below this are left to MMatrix (singularity test, inverse)
+#define MAT_DET_TOLERANCE 1.0e-10
+
+
+// the last column is (0,0,0,1), so the matrix is a 3x3 rotation/scale/shear plus a translation
+inline bool matIsAffine(const double *m)
+{
+	return (m[3] == 0.0) && (m[7] == 0.0) && (m[11] == 0.0) && (m[15] == 1.0);
+}
+
+// determinant of the upper left 3x3
+inline double matDet3x3(const double *m)
+{
+	return m[0] * (m[5] * m[10] - m[6] * m[9])
+		 - m[1] * (m[4] * m[10] - m[6] * m[8])
+		 + m[2] * (m[4] * m[9]  - m[5] * m[8]);
+}
+
+// 4x4 determinant through the 2x2 sub determinants of the upper and lower two rows
+inline double matDet4x4(const double *m)
+{
+	double s0 = m[0] * m[5]  - m[4] * m[1];
+	double s1 = m[0] * m[6]  - m[4] * m[2];
+	double s2 = m[0] * m[7]  - m[4] * m[3];
+	double s3 = m[1] * m[6]  - m[5] * m[2];
+	double s4 = m[1] * m[7]  - m[5] * m[3];
+	double s5 = m[2] * m[7]  - m[6] * m[3];
+
+	double c5 = m[10] * m[15] - m[14] * m[11];
+	double c4 = m[9]  * m[15] - m[13] * m[11];
+	double c3 = m[9]  * m[14] - m[13] * m[10];
+	double c2 = m[8]  * m[15] - m[12] * m[11];
+	double c1 = m[8]  * m[14] - m[12] * m[10];
+	double c0 = m[8]  * m[13] - m[12] * m[9];
+
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+// adjoint (transposed cofactor matrix, m * adj = det * identity) by cofactor expansion, returns the determinant
+inline double matAdjoint(const double *m, double *adj)
+{
+	double s0 = m[0] * m[5]  - m[4] * m[1];
+	double s1 = m[0] * m[6]  - m[4] * m[2];
+	double s2 = m[0] * m[7]  - m[4] * m[3];
+	double s3 = m[1] * m[6]  - m[5] * m[2];
+	double s4 = m[1] * m[7]  - m[5] * m[3];
+	double s5 = m[2] * m[7]  - m[6] * m[3];
+
+	double c5 = m[10] * m[15] - m[14] * m[11];
+	double c4 = m[9]  * m[15] - m[13] * m[11];
+	double c3 = m[9]  * m[14] - m[13] * m[10];
+	double c2 = m[8]  * m[15] - m[12] * m[11];
+	double c1 = m[8]  * m[14] - m[12] * m[10];
+	double c0 = m[8]  * m[13] - m[12] * m[9];
+
+	adj[0]  =  m[5]  * c5 - m[6]  * c4 + m[7]  * c3;
+	adj[1]  = -m[1]  * c5 + m[2]  * c4 - m[3]  * c3;
+	adj[2]  =  m[13] * s5 - m[14] * s4 + m[15] * s3;
+	adj[3]  = -m[9]  * s5 + m[10] * s4 - m[11] * s3;
+
+	adj[4]  = -m[4]  * c5 + m[6]  * c2 - m[7]  * c1;
+	adj[5]  =  m[0]  * c5 - m[2]  * c2 + m[3]  * c1;
+	adj[6]  = -m[12] * s5 + m[14] * s2 - m[15] * s1;
+	adj[7]  =  m[8]  * s5 - m[10] * s2 + m[11] * s1;
+
+	adj[8]  =  m[4]  * c4 - m[5]  * c2 + m[7]  * c0;
+	adj[9]  = -m[0]  * c4 + m[1]  * c2 - m[3]  * c0;
+	adj[10] =  m[12] * s4 - m[13] * s2 + m[15] * s0;
+	adj[11] = -m[8]  * s4 + m[9]  * s2 - m[11] * s0;
+
+	adj[12] = -m[4]  * c3 + m[5]  * c1 - m[6]  * c0;
+	adj[13] =  m[0]  * c3 - m[1]  * c1 + m[2]  * c0;
+	adj[14] = -m[12] * s3 + m[13] * s1 - m[14] * s0;
+	adj[15] =  m[8]  * s3 - m[9]  * s1 + m[10] * s0;
+
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+// inverse of a general matrix, returns false (and leaves inv alone) if it is (close to) singular
+inline bool matInverse(const double *m, double *inv)
+{
+	double adj[16];
+	double det = matAdjoint(m, adj);
+	if (!(fabs(det) > MAT_DET_TOLERANCE))
+		return false;
+
+	double s = 1.0 / det;
+	for (unsigned int i = 0; i < 16; i++)
+		inv[i] = adj[i] * s;
+	return true;
+}
+
+// inverse of an affine matrix (see matIsAffine): the inverse 3x3 and the translation moved back through it
+inline bool matInverseAffine(const double *m, double *inv)
+{
+	double a0 = m[5] * m[10] - m[6] * m[9];
+	double a1 = m[6] * m[8]  - m[4] * m[10];
+	double a2 = m[4] * m[9]  - m[5] * m[8];
+	double det = m[0] * a0 + m[1] * a1 + m[2] * a2;
+	if (!(fabs(det) > MAT_DET_TOLERANCE))
+		return false;
+
+	double s = 1.0 / det;
+	double r[9];
+	r[0] = a0 * s;
+	r[1] = (m[2] * m[9]  - m[1] * m[10]) * s;
+	r[2] = (m[1] * m[6]  - m[2] * m[5])  * s;
+	r[3] = a1 * s;
+	r[4] = (m[0] * m[10] - m[2] * m[8])  * s;
+	r[5] = (m[2] * m[4]  - m[0] * m[6])  * s;
+	r[6] = a2 * s;
+	r[7] = (m[1] * m[8]  - m[0] * m[9])  * s;
+	r[8] = (m[0] * m[5]  - m[1] * m[4])  * s;
+
+	inv[0] = r[0]; inv[1] = r[1]; inv[2]  = r[2]; inv[3]  = 0.0;
+	inv[4] = r[3]; inv[5] = r[4]; inv[6]  = r[5]; inv[7]  = 0.0;
+	inv[8] = r[6]; inv[9] = r[7]; inv[10] = r[8]; inv[11] = 0.0;
+
+	inv[12] = -(m[12] * r[0] + m[13] * r[3] + m[14] * r[6]);
+	inv[13] = -(m[12] * r[1] + m[13] * r[4] + m[14] * r[7]);
+	inv[14] = -(m[12] * r[2] + m[13] * r[5] + m[14] * r[8]);
+	inv[15] = 1.0;
+	return true;
+}
+
+// c = a * b, every row times column product summed left to right, c may not be a or b
+inline void matMult(const double *a, const double *b, double *c)
+{
+	for (unsigned int r = 0; r < 16; r += 4)
+	{
+		const double a0 = a[r], a1 = a[r + 1], a2 = a[r + 2], a3 = a[r + 3];
+		c[r]     = a0 * b[0] + a1 * b[4] + a2 * b[8]  + a3 * b[12];
+		c[r + 1] = a0 * b[1] + a1 * b[5] + a2 * b[9]  + a3 * b[13];
+		c[r + 2] = a0 * b[2] + a1 * b[6] + a2 * b[10] + a3 * b[14];
+		c[r + 3] = a0 * b[3] + a1 * b[7] + a2 * b[11] + a3 * b[15];
+	}
+}
+
+// c = a * b for two affine matrices (see matIsAffine), the last column is known and the products
+// with its zeros are left out, which only differs from matMult for non finite values or the sign of a zero
+inline void matMultAffine(const double *a, const double *b, double *c)
+{
+	for (unsigned int r = 0; r < 12; r += 4)
+	{
+		const double a0 = a[r], a1 = a[r + 1], a2 = a[r + 2];
+		c[r]     = a0 * b[0] + a1 * b[4] + a2 * b[8];
+		c[r + 1] = a0 * b[1] + a1 * b[5] + a2 * b[9];
+		c[r + 2] = a0 * b[2] + a1 * b[6] + a2 * b[10];
+		c[r + 3] = 0.0;
+	}
+
+	const double a0 = a[12], a1 = a[13], a2 = a[14];
+	c[12] = a0 * b[0] + a1 * b[4] + a2 * b[8]  + b[12];
+	c[13] = a0 * b[1] + a1 * b[5] + a2 * b[9]  + b[13];
+	c[14] = a0 * b[2] + a1 * b[6] + a2 * b[10] + b[14];
+	c[15] = 1.0;
+}
+
+
+//************************************************************************************************
+// transform components
+//
+// Like MTransformationMatrix (without pivots) the upper 3x3 is scale * shear * rotation, the shear is
+// the lower triangle (xy, xz, yz) of a unit matrix, the translation is the last row
+
+#define ROTATE_ORDER_XYZ	0
+#define ROTATE_ORDER_YZX	1
+#define ROTATE_ORDER_ZXY	2
+#define ROTATE_ORDER_XZY	3
+#define ROTATE_ORDER_YXZ	4
+#define ROTATE_ORDER_ZYX	5
+
+
+// c = a * b for 3x3 matrices stored as 9 values in row order, c may not be a or b
+inline void mat3Mult(const double *a, const double *b, double *c)
+{
+	for (unsigned int r = 0; r < 3; r++)
+	{
+		c[r * 3]     = a[r * 3] * b[0] + a[r * 3 + 1] * b[3] + a[r * 3 + 2] * b[6];
+		c[r * 3 + 1] = a[r * 3] * b[1] + a[r * 3 + 1] * b[4] + a[r * 3 + 2] * b[7];
+		c[r * 3 + 2] = a[r * 3] * b[2] + a[r * 3 + 1] * b[5] + a[r * 3 + 2] * b[8];
+	}
+}
+
+// split the upper 3x3 into scale, shear and a rotation (3x3) by a QR (Gram-Schmidt) decomposition of its rows,
+// a mirroring matrix gets a negative z scale so the rotation always stays a proper one
+inline void matDecompose(const double *m, double *scale, double *shear, double *rot)
+{
+	const double *r0 = m, *r1 = m + 4, *r2 = m + 8;
+
+	scale[0] = sqrt(r0[0] * r0[0] + r0[1] * r0[1] + r0[2] * r0[2]);
+	if (scale[0] > 0.0)
+	{
+		double s = 1.0 / scale[0];
+		rot[0] = r0[0] * s; rot[1] = r0[1] * s; rot[2] = r0[2] * s;
+	}
+	else
+	{
+		rot[0] = 1.0; rot[1] = rot[2] = 0.0;
+	}
+
+	double xy = r1[0] * rot[0] + r1[1] * rot[1] + r1[2] * rot[2];
+	double u[3] = { r1[0] - xy * rot[0], r1[1] - xy * rot[1], r1[2] - xy * rot[2] };
+	scale[1] = sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+	if (!(scale[1] > 0.0))
+	{
+		// a flat matrix, any axis perpendicular to the first one keeps the rotation valid
+		double axis[3] = { 0.0, 0.0, 0.0 };
+		axis[(fabs(rot[0]) < 0.9) ? 0 : 1] = 1.0;
+		double d = axis[0] * rot[0] + axis[1] * rot[1];
+		u[0] = axis[0] - d * rot[0];
+		u[1] = axis[1] - d * rot[1];
+		u[2] = -d * rot[2];
+	}
+	double s = 1.0 / sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+	rot[3] = u[0] * s; rot[4] = u[1] * s; rot[5] = u[2] * s;
+
+	// the third axis is fixed by the first two, the sign of the scale picks up a mirroring
+	rot[6] = rot[1] * rot[5] - rot[2] * rot[4];
+	rot[7] = rot[2] * rot[3] - rot[0] * rot[5];
+	rot[8] = rot[0] * rot[4] - rot[1] * rot[3];
+
+	double xz = r2[0] * rot[0] + r2[1] * rot[1] + r2[2] * rot[2];
+	double yz = r2[0] * rot[3] + r2[1] * rot[4] + r2[2] * rot[5];
+	scale[2] = r2[0] * rot[6] + r2[1] * rot[7] + r2[2] * rot[8];
+
+	shear[0] = (scale[1] != 0.0) ? xy / scale[1] : 0.0;
+	shear[1] = (scale[2] != 0.0) ? xz / scale[2] : 0.0;
+	shear[2] = (scale[2] != 0.0) ? yz / scale[2] : 0.0;
+}
+
+// build the upper 3x3 from scale, shear and rotation (3x3), the rest of m stays untouched
+inline void matCompose(const double *scale, const double *shear, const double *rot, double *m)
+{
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		m[c]     = scale[0] * rot[c];
+		m[4 + c] = scale[1] * (shear[0] * rot[c] + rot[3 + c]);
+		m[8 + c] = scale[2] * (shear[1] * rot[c] + shear[2] * rot[3 + c] + rot[6 + c]);
+	}
+}
+
+// rotation part of the polar decomposition of the upper 3x3, the rotation closest to it, by scaled Newton
+// iterations (q = (g * q + inverse transpose(q) / g) / 2), a mirroring matrix gets the rotation of its
+// z mirrored version like in matDecompose, returns false (and leaves rot alone) if it is (close to) singular
+inline bool matPolarRotation(const double *m, double *rot)
+{
+	double q[9] = { m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10] };
+	if (matDet3x3(m) < 0.0)
+	{
+		q[6] = -q[6]; q[7] = -q[7]; q[8] = -q[8];
+	}
+
+	for (unsigned int it = 0; it < 32; it++)
+	{
+		// the rows of the cofactor matrix are the cross products of the other two rows
+		double c[9];
+		for (unsigned int r = 0; r < 3; r++)
+		{
+			const double *a = q + ((r + 1) % 3) * 3;
+			const double *b = q + ((r + 2) % 3) * 3;
+			c[r * 3]     = a[1] * b[2] - a[2] * b[1];
+			c[r * 3 + 1] = a[2] * b[0] - a[0] * b[2];
+			c[r * 3 + 2] = a[0] * b[1] - a[1] * b[0];
+		}
+
+		double det = q[0] * c[0] + q[1] * c[1] + q[2] * c[2];
+		if (!(det > MAT_DET_TOLERANCE))
+			return false;
+
+		// scaling by the determinant speeds up the first iterations, it goes to 1 when converging
+		double g = pow(det, -1.0 / 3.0);
+		double ga = 0.5 * g;
+		double gb = 0.5 / (g * det);
+
+		double change = 0.0;
+		for (unsigned int k = 0; k < 9; k++)
+		{
+			double v = ga * q[k] + gb * c[k];
+			change += fabs(v - q[k]);
+			q[k] = v;
+		}
+
+		if (change < 1e-14)
+			break;
+	}
+
+	for (unsigned int k = 0; k < 9; k++)
+		rot[k] = q[k];
+	return true;
+}
+
+// axes of the rotate orders, from the first to the last applied one
+static const unsigned int rotateOrderAxes[6][3] = { {0,1,2}, {1,2,0}, {2,0,1}, {0,2,1}, {1,0,2}, {2,1,0} };
+
+// rotation (3x3) for euler angles in radians
+inline void eulerToRotation(const double *euler, const int order, double *rot)
+{
+	double axis[3][9];
+	for (unsigned int a = 0; a < 3; a++)
+	{
+		double c = cos(euler[a]), s = sin(euler[a]);
+		unsigned int i = (a + 1) % 3, j = (a + 2) % 3;
+		double *r = axis[a];
+
+		r[0] = r[1] = r[2] = r[3] = r[4] = r[5] = r[6] = r[7] = r[8] = 0.0;
+		r[a * 4] = 1.0;
+		r[i * 4] = c;  r[i * 3 + j] = s;
+		r[j * 3 + i] = -s; r[j * 4] = c;
+	}
+
+	const unsigned int *o = rotateOrderAxes[order];
+	double tmp[9];
+	mat3Mult(axis[o[0]], axis[o[1]], tmp);
+	mat3Mult(tmp, axis[o[2]], rot);
+}
+
+// euler angles in radians of a rotation (3x3)
+// the rotation is relabeled so the rotate order becomes xyz (odd orders flip the rotation direction)
+inline void rotationToEuler(const double *rot, const int order, double *euler)
+{
+	const unsigned int *o = rotateOrderAxes[order];
+	double sign = (order < ROTATE_ORDER_XZY) ? 1.0 : -1.0;
+
+	double r00 = rot[o[0] * 3 + o[0]], r01 = rot[o[0] * 3 + o[1]], r02 = rot[o[0] * 3 + o[2]];
+	double r11 = rot[o[1] * 3 + o[1]], r12 = rot[o[1] * 3 + o[2]];
+	double r21 = rot[o[2] * 3 + o[1]], r22 = rot[o[2] * 3 + o[2]];
+
+	double cy = sqrt(r00 * r00 + r01 * r01);
+	double a[3];
+	a[1] = atan2(-r02 * sign, cy);
+	if (cy > 1.0e-12)
+	{
+		a[0] = atan2(r12, r22);
+		a[2] = atan2(r01, r00);
+	}
+	else
+	{
+		// gimbal lock, put everything into the first angle
+		a[0] = atan2(-r21, r11);
+		a[2] = 0.0;
+	}
+
+	euler[o[0]] = a[0] * sign;
+	euler[o[1]] = a[1];
+	euler[o[2]] = a[2] * sign;
+}
+
+
+//************************************************************************************************
+// quaternions
+//
+// q points to the 4 values (x, y, z, w) of a quaternion like MQuaternion. The product has the
+// same order as the matrix product: quatMult(a, b) first rotates by a, then by b, so
+// quatToRotation(a*b) = quatToRotation(a) * quatToRotation(b).
+
+// c = a * b, c may be a or b
+inline void quatMult(const double *a, const double *b, double *c)
+{
+	double x = b[3] * a[0] + a[3] * b[0] + b[1] * a[2] - b[2] * a[1];
+	double y = b[3] * a[1] + a[3] * b[1] + b[2] * a[0] - b[0] * a[2];
+	double z = b[3] * a[2] + a[3] * b[2] + b[0] * a[1] - b[1] * a[0];
+	double w = b[3] * a[3] - b[0] * a[0] - b[1] * a[1] - b[2] * a[2];
+	c[0] = x; c[1] = y; c[2] = z; c[3] = w;
+}
+
+// quaternion for a rotation by angle (radians) about axis, the axis doesn't have to be normalized
+inline void axisAngleToQuat(const double *axis, const double angle, double *q)
+{
+	double l = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	double s = (l > 0.0) ? sin(angle * 0.5) / l : 0.0;
+	q[0] = axis[0] * s; q[1] = axis[1] * s; q[2] = axis[2] * s;
+	q[3] = (l > 0.0) ? cos(angle * 0.5) : 1.0;
+}
+
+// quaternion for euler angles in radians, like eulerToRotation
+inline void eulerToQuat(const double *euler, const int order, double *q)
+{
+	double axis[3][4];
+	for (unsigned int a = 0; a < 3; a++)
+	{
+		double h = euler[a] * 0.5;
+		axis[a][0] = axis[a][1] = axis[a][2] = 0.0;
+		axis[a][a] = sin(h);
+		axis[a][3] = cos(h);
+	}
+
+	const unsigned int *o = rotateOrderAxes[order];
+	quatMult(axis[o[0]], axis[o[1]], q);
+	quatMult(q, axis[o[2]], q);
+}
+
+// rotation (3x3) of a unit quaternion
+inline void quatToRotation(const double *q, double *rot)
+{
+	double x2 = q[0] + q[0], y2 = q[1] + q[1], z2 = q[2] + q[2];
+	double xx = q[0] * x2, yy = q[1] * y2, zz = q[2] * z2;
+	double xy = q[0] * y2, xz = q[0] * z2, yz = q[1] * z2;
+	double wx = q[3] * x2, wy = q[3] * y2, wz = q[3] * z2;
+
+	rot[0] = 1.0 - (yy + zz); rot[1] = xy + wz;         rot[2] = xz - wy;
+	rot[3] = xy - wz;         rot[4] = 1.0 - (xx + zz); rot[5] = yz + wx;
+	rot[6] = xz + wy;         rot[7] = yz - wx;         rot[8] = 1.0 - (xx + yy);
+}
+
+// unit quaternion of a rotation (3x3), built from the biggest of the diagonal terms to stay precise
+inline void rotationToQuat(const double *rot, double *q)
+{
+	double trace = rot[0] + rot[4] + rot[8];
+	if (trace > 0.0)
+	{
+		double s = 0.5 / sqrt(trace + 1.0);
+		q[3] = 0.25 / s;
+		q[0] = (rot[5] - rot[7]) * s;
+		q[1] = (rot[6] - rot[2]) * s;
+		q[2] = (rot[1] - rot[3]) * s;
+	}
+	else if ((rot[0] > rot[4]) && (rot[0] > rot[8]))
+	{
+		double s = 2.0 * sqrt(1.0 + rot[0] - rot[4] - rot[8]);
+		q[3] = (rot[5] - rot[7]) / s;
+		q[0] = 0.25 * s;
+		q[1] = (rot[1] + rot[3]) / s;
+		q[2] = (rot[2] + rot[6]) / s;
+	}
+	else if (rot[4] > rot[8])
+	{
+		double s = 2.0 * sqrt(1.0 + rot[4] - rot[0] - rot[8]);
+		q[3] = (rot[6] - rot[2]) / s;
+		q[0] = (rot[1] + rot[3]) / s;
+		q[1] = 0.25 * s;
+		q[2] = (rot[5] + rot[7]) / s;
+	}
+	else
+	{
+		double s = 2.0 * sqrt(1.0 + rot[8] - rot[0] - rot[4]);
+		q[3] = (rot[1] - rot[3]) / s;
+		q[0] = (rot[2] + rot[6]) / s;
+		q[1] = (rot[5] + rot[7]) / s;
+		q[2] = 0.25 * s;
+	}
+}
+
+// rotate vector v by a unit quaternion, same as v * quatToRotation(q)
+inline void quatRotate(const double *q, const double *v, double *out)
+{
+	// t = 2 * (q.xyz x v), out = v + w * t + q.xyz x t
+	double tx = 2.0 * (q[1] * v[2] - q[2] * v[1]);
+	double ty = 2.0 * (q[2] * v[0] - q[0] * v[2]);
+	double tz = 2.0 * (q[0] * v[1] - q[1] * v[0]);
+
+	out[0] = v[0] + q[3] * tx + (q[1] * tz - q[2] * ty);
+	out[1] = v[1] + q[3] * ty + (q[2] * tx - q[0] * tz);
+	out[2] = v[2] + q[3] * tz + (q[0] * ty - q[1] * tx);
+}
+
+// normalized linear interpolation along the shorter arc
+inline void quatNlerp(const double *a, const double *b, const double t, double *q)
+{
+	double d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	double wb = (d < 0.0) ? -t : t;
+	double wa = 1.0 - t;
+
+	for (unsigned int k = 0; k < 4; k++)
+		q[k] = wa * a[k] + wb * b[k];
+
+	double l = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	double s = (l > 0.0) ? 1.0 / l : 0.0;
+	for (unsigned int k = 0; k < 4; k++)
+		q[k] *= s;
+}
+
+// spherical linear interpolation along the shorter arc, nearly equal quaternions are nlerped
+inline void quatSlerp(const double *a, const double *b, const double t, double *q)
+{
+	double d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	double sign = (d < 0.0) ? -1.0 : 1.0;
+	d *= sign;
+
+	if (d > 0.9995)
+	{
+		quatNlerp(a, b, t, q);
+		return;
+	}
+
+	double angle = acos(d);
+	double s = 1.0 / sin(angle);
+	double wa = sin((1.0 - t) * angle) * s;
+	double wb = sin(t * angle) * s * sign;
+
+	for (unsigned int k = 0; k < 4; k++)
+		q[k] = wa * a[k] + wb * b[k];
+}
+
+// dual part of the unit dual quaternion for rotating by q, then translating by t
+inline void quatTranslationToDual(const double *q, const double *t, double *d)
+{
+	// d = 0.5 * t * q in the usual (reversed) notation
+	double tq[4] = { t[0], t[1], t[2], 0.0 };
+	quatMult(q, tq, d);
+	for (unsigned int k = 0; k < 4; k++)
+		d[k] *= 0.5;
+}
+
+// translation of a unit dual quaternion with the real part q and the dual part d
+inline void dualToTranslation(const double *q, const double *d, double *t)
+{
+	double qc[4] = { -q[0], -q[1], -q[2], q[3] };
+	double tq[4];
+	quatMult(qc, d, tq);
+	t[0] = 2.0 * tq[0]; t[1] = 2.0 * tq[1]; t[2] = 2.0 * tq[2];
+}
+
+}//end namespace
+#endif
@@ -26,6 +26,7 @@ DECLARE_COMMAND(mMatSize)
 DECLARE_COMMAND(mMatAppend)
 DECLARE_COMMAND(mMatGet)
 DECLARE_COMMAND(mMatSet)
+DECLARE_COMMAND(mMatCompact)
 DECLARE_COMMAND(mMatGetComponent)
 DECLARE_COMMAND(mMatSetComponent)
 
@@ -24,6 +24,9 @@ namespace melfunctions
 DECLARE_COMMAND(mMatAdd)
 DECLARE_COMMAND(mMatSub)
 DECLARE_COMMAND(mMatMult)
+DECLARE_COMMAND(mMatHierarchy)
+DECLARE_COMMAND(mMatBlend)
+DECLARE_COMMAND(mMatOrthonormalize)
 DECLARE_COMMAND(mMatDblMult)
 DECLARE_COMMAND(mMatIsEqual)
 DECLARE_COMMAND(mMatIsNotEqual)
@@ -40,6 +43,7 @@ DECLARE_COMMAND(mMatGetRow)
 DECLARE_COMMAND(mMatSetRow)
 DECLARE_COMMAND(mMatGetColumn)
 DECLARE_COMMAND(mMatSetColumn)
+*/
 DECLARE_COMMAND(mMatGetTranslation)
 DECLARE_COMMAND(mMatSetTranslation)
 DECLARE_COMMAND(mMatAddTranslation)
@@ -52,6 +56,5 @@ DECLARE_COMMAND(mMatAddScale)
 DECLARE_COMMAND(mMatGetShear)
 DECLARE_COMMAND(mMatSetShear)
 DECLARE_COMMAND(mMatAddShear)
-*/
 }//end namespace
 #endif
@@ -18,6 +18,9 @@
 
 namespace melfunctions
 {
+// the seed set by mSeed, used by the random commands and as the default seed of the noise commands
+extern int mfSeed;
+
 // wrapped in a macro, check out "helperMacros.h"
 
 
@@ -37,6 +40,19 @@ DECLARE_COMMAND(mVec3dNoise)
 DECLARE_COMMAND(mDbl3dTurbulence)
 DECLARE_COMMAND(mVec3dTurbulence)
 
+DECLARE_COMMAND(mDbl3dBasisNoise)
+DECLARE_COMMAND(mDbl3dFBm)
+DECLARE_COMMAND(mDbl3dMultiFractal)
+DECLARE_COMMAND(mDbl3dHeteroTerrain)
+DECLARE_COMMAND(mDbl3dHybridMultiFractal)
+DECLARE_COMMAND(mDbl3dRidgedMultiFractal)
+DECLARE_COMMAND(mDbl3dVLNoise)
+
+DECLARE_COMMAND(mVec3dNoiseGradient)
+DECLARE_COMMAND(mVec3dCurlNoise)
+
+DECLARE_COMMAND(mDblNoiseGrid)
+
 
 
 }//end namespace
@@ -0,0 +1,112 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// shared worker threads for the array commands
+//
+// The pool is created in initializePlugin and released in uninitializePlugin. Commands hand their
+// per element work to parallelFor as a kernel - any class or struct with an
+//
+//		void operator()(unsigned int begin, unsigned int end)
+//
+// that processes the half open element range [begin,end). The range is cut into chunks of a fixed
+// grain size, independent of the number of threads, so every element (and every per chunk partial
+// result of a reduction) is always computed the same way - results don't change with the thread count.
+
+#ifndef _mThreadPool_h_
+#define _mThreadPool_h_
+
+#include "mHelperMacros.h"
+
+
+namespace melfunctions
+{
+
+// grain sizes (elements per chunk), also the serial threshold: arrays that fit into a single chunk
+// are processed on the calling thread without touching the pool
+
+// cheap per element work (arithmetic on doubles) - 4096 doubles fill 32k, a typical L1 cache
+#define PARALLEL_GRAIN_LIGHT 4096
+// matrix/quaternion work
+#define PARALLEL_GRAIN_MEDIUM 512
+// noise and other expensive per element work
+#define PARALLEL_GRAIN_HEAVY 128
+
+
+// abstract chunk of work handed to the worker threads
+class mParallelTask
+{
+	public:
+		virtual			~mParallelTask() {}
+		virtual void	run(unsigned int begin, unsigned int end) = 0;
+};
+
+template <class Kernel>
+class mParallelKernelTask : public mParallelTask
+{
+	public:
+						mParallelKernelTask(Kernel &kernel) : m_kernel(kernel) {}
+		void			run(unsigned int begin, unsigned int end) { m_kernel(begin, end); }
+
+	private:
+		Kernel			&m_kernel;
+};
+
+
+class mThreadPool
+{
+	public:
+		// start the worker threads, threadCount 0 means one thread per processor
+		static void				init(unsigned int threadCount = 0);
+		// stop and join all worker threads
+		static void				release();
+
+		// number of threads working on a parallelFor, including the calling thread
+		static unsigned int		threadCount();
+		static unsigned int		processorCount();
+
+		// process count elements in chunks of grain elements, blocks until all chunks are done
+		static void				run(mParallelTask &task, unsigned int count, unsigned int grain);
+};
+
+
+// run kernel over [0,count) - serially if the array fits into one chunk or there is only one thread
+template <class Kernel>
+inline void parallelFor(unsigned int count, unsigned int grain, Kernel &kernel)
+{
+	if (grain == 0)
+		grain = 1;
+
+	if ((count <= grain) || (mThreadPool::threadCount() < 2))
+	{
+		if (count)
+			kernel(0, count);
+		return;
+	}
+
+	mParallelKernelTask<Kernel> task(kernel);
+	mThreadPool::run(task, count, grain);
+}
+
+// number of chunks parallelFor will cut count elements into, used to size per chunk partial results
+inline unsigned int parallelChunkCount(unsigned int count, unsigned int grain)
+{
+	if (grain == 0)
+		grain = 1;
+	return (count + grain - 1) / grain;
+}
+
+
+// wrapped in a macro, check out "helperMacros.h"
+DECLARE_COMMAND(mThreadCount)
+
+}//end namespace
+#endif
@@ -36,5 +36,9 @@ DECLARE_COMMAND(mUVSetU)
 DECLARE_COMMAND(mUVSetV)
 DECLARE_COMMAND(mUVSetComponent)
 
+DECLARE_COMMAND(mUVTransform)
+DECLARE_COMMAND(mUVWrap)
+DECLARE_COMMAND(mUVTile)
+
 }//end namespace
 #endif
@@ -27,6 +27,8 @@ DECLARE_COMMAND(mVecSize)
 DECLARE_COMMAND(mVecAppend)
 DECLARE_COMMAND(mVecGet)
 DECLARE_COMMAND(mVecSet)
+DECLARE_COMMAND(mVecGather)
+DECLARE_COMMAND(mVecCompact)
    
 DECLARE_COMMAND(mVecGetX)
 DECLARE_COMMAND(mVecGetY)
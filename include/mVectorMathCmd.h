@@ -40,7 +40,7 @@ DECLARE_COMMAND(mVecCross)
 DECLARE_COMMAND(mVecDot)
 
 DECLARE_COMMAND(mVecRotateByEuler)
-//DECLARE_COMMAND(mVecRotateByQuat)
+DECLARE_COMMAND(mVecRotateByQuat)
 DECLARE_COMMAND(mVecRotateByAxisAngle)
 DECLARE_COMMAND(mVecAimUpToEuler)
 DECLARE_COMMAND(mVecAngle)
@@ -12,6 +12,8 @@
  
 #include "Noise.h"
 #include <math.h>
+#include <stdlib.h>
+#include <pthread.h>
 
 
 //************************************************************************************************
@@ -20,9 +22,8 @@
 //************************************************************************************************
 //************************************************************************************************
 
-// for perlin
-//unsigned char g_hash[256]= {
-unsigned char hash[512]= {
+// for perlin, the default permutation table, the seeded ones are shuffled copies (see reshufflePermutationTable)
+static const unsigned char g_hash[512]= {
 	151,160,137,91,90,15,131, 13,201,95,96,53,194,233,7,
 	225,140,36,103,30,69,142,8,99,37,240,21,10,23,190,6,
 	148,247,120,234,75, 0,26,197, 62,94,252,219,203,117,
@@ -62,7 +63,7 @@ unsigned char hash[512]= {
  };   
  
  /* needed for voronoi */
-#define HASHPNT(x,y,z) hashpntf+3*hash[ (hash[ (hash[(z) & 255]+(y)) & 255]+(x)) & 255]
+#define HASHPNT(x,y,z) table.point[ (hash[ (hash[(z) & 255]+(y)) & 255]+(x)) & 255]
 static float hashpntf[768] = {
 0.536902, 0.020915, 0.501445, 0.216316, 0.517036, 0.822466, 0.965315,
 0.377313, 0.678764, 0.744545, 0.097731, 0.396357, 0.247202, 0.520897,
@@ -176,6 +177,11 @@ static float hashpntf[768] = {
 0.114246, 0.905043, 0.713870, 0.555261, 0.951333
 };
 
+// for improved perlin, the gradients of the 3d noise: the 12 cube edge directions, padded to 16
+static const float gradient3dX[16] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f };
+static const float gradient3dY[16] = { 1.0f, 1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+static const float gradient3dZ[16] = { 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f, -1.0f };
+
 // for blender noise
 float hashvectf[768]= {
 0.33783,0.715698,-0.611206,-0.944031,-0.326599,-0.045624,-0.101074,-0.416443,-0.903503,0.799286,0.49411,-0.341949,-0.854645,0.518036,0.033936,0.42514,-0.437866,-0.792114,-0.358948,0.597046,0.717377,-0.985413,0.144714,0.089294,-0.601776,-0.33728,-0.723907,-0.449921,0.594513,0.666382,0.208313,-0.10791,
@@ -213,139 +219,226 @@ float hashvectf[768]= {
 //************************************************************************************************
 
 //************************************************************************************************
-// constructor
-Noise::Noise()
+// the lookup tables of a permutation table, see NoiseTable. the gradients and feature points are
+// fetched through the permutation table, folding them into it saves the last (dependent) lookup
+
+// fill in gradient and point from the first 256 entries of hash, and repeat those in the second half
+static void foldNoiseTable( NoiseTable &table )
 {
-	// start with the default permutation table
-//	for( unsigned int i = 0; i < 256; ++i )
-//		hash[i] = hash[256+i] = g_hash[i];
+	for( unsigned int i = 0; i < 256; ++i )
+		table.hash[256+i] = table.hash[i];
+
+	for( unsigned int i = 0; i < 512; ++i )
+	{
+		const int h = table.hash[i] & 15;
+		table.gradient[i][0] = gradient3dX[h];
+		table.gradient[i][1] = gradient3dY[h];
+		table.gradient[i][2] = gradient3dZ[h];
+		table.gradient[i][3] = 0.0f;
+	}
+
+	for( unsigned int i = 0; i < 256; ++i )
+	{
+		const float *p = hashpntf + 3*table.hash[i];
+		table.point[i][0] = p[0];
+		table.point[i][1] = p[1];
+		table.point[i][2] = p[2];
+		table.point[i][3] = 0.0f;
+	}
 }
-/*
-Noise::Noise( const unsigned int seed )
-{
-	const unsigned int modseed = (1402024253 * seed + 586950981) >> 24;		// 0  255
 
+static NoiseTable buildDefaultTable()
+{
+	NoiseTable table;
 	for( unsigned int i = 0; i < 256; ++i )
-		hash[i] = hash[256+i] = g_hash[(modseed + i) & 255];
+		table.hash[i] = g_hash[i];
+	foldNoiseTable(table);
+	return table;
+}
+
+static const NoiseTable s_defaultTable = buildDefaultTable();
+
+// the 3d gradient term of a corner, g is a row of NoiseTable::gradient
+static inline float tableGradient( const float g[4], const float x, const float y, const float z )
+{
+	return g[0] * x + g[1] * y + g[2] * z;
 }
-*/
+
 
 //************************************************************************************************
-// destructor
-Noise::~Noise()
-{}
+// permutation tables for the seeds other than the default one, built once per seed and kept in a small
+// cache shared by all threads, when it's full the least recently used table is replaced. the tables never
+// change once built, so a Noise instance just points at its table and keeps it pinned: an evicted table
+// that is still in use stays alive until its last user lets go of it
 
-//*************************************************************************************************
-// helper function to obtain the function pointer to the noise basis function
+#define NOISE_TABLE_CACHE_SIZE 32
 
-float (Noise::*getNoiseFunctionPtrS(const int noiseBasis))(float, float, float)
+// the table comes first, so the table pointer of a Noise instance leads back to its cache entry
+struct NoisePermutationTable
 {
-    switch (noiseBasis) 
-    {
-		case NOISE_VORONOI_F1       : return &Noise::voronoiF1S;
-		case NOISE_VORONOI_F2       : return &Noise::voronoiF2S;   
-		case NOISE_VORONOI_F3       : return &Noise::voronoiF3S;   
-		case NOISE_VORONOI_F4       : return &Noise::voronoiF4S; 
-		case NOISE_VORONOI_F2F1     : return &Noise::voronoiF1F2S; 
-		case NOISE_VORONOI_CRACKLE  : return &Noise::voronoiCrackleS;
-		case NOISE_CELL             : return &Noise::cellNoiseS;
-		case NOISE_BLENDER          : return &Noise::blenderNoiseS;   
-   		case NOISE_IMPROVED_PERLIN  : 
-		default                     : return &Noise::improvedPerlin3dS;
+	NoiseTable		table;
+	unsigned int	seed;
+	unsigned int	used;		// clock of the last lookup
+	unsigned int	users;		// Noise instances pointing at the table
+	bool			cached;		// false once evicted, the last user deletes it
+	void			*block;		// the allocation, the entry is cache line aligned inside it
+};
+
+static NoisePermutationTable *s_tableCache[NOISE_TABLE_CACHE_SIZE];
+static unsigned int s_tableCount = 0;
+static unsigned int s_tableClock = 0;
+static pthread_mutex_t s_tableMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// new does not align beyond the default alignment before c++17, so align by hand
+static NoisePermutationTable* newPermutationTable()
+{
+	void *block = malloc(sizeof(NoisePermutationTable) + 63);
+	NoisePermutationTable *entry = (NoisePermutationTable*)(((size_t)block + 63) & ~(size_t)63);
+	entry->block = block;
+	return entry;
+}
+
+// shuffle the default table with a fixed lcg, so a seed gives the same table on every platform
+static void buildPermutationTable( const unsigned int seed, NoiseTable &table )
+{
+	unsigned int r = seed;
+
+	for( unsigned int i = 0; i < 256; ++i )
+		table.hash[i] = g_hash[i];
+
+	for( unsigned int i = 255; i > 0; --i )
+	{
+		r = 1664525 * r + 1013904223;
+		const unsigned int j = (r >> 8) % (i + 1);
+		const unsigned char t = table.hash[i];
+		table.hash[i] = table.hash[j];
+		table.hash[j] = t;
 	}
+
+	foldNoiseTable(table);
 }
 
+// the table of the seed, pinned until it's handed back with releasePermutationTable
+static const NoiseTable* getPermutationTable( const unsigned int seed )
+{
+	pthread_mutex_lock(&s_tableMutex);
 
+	unsigned int slot = 0;
+	while( (slot < s_tableCount) && (s_tableCache[slot]->seed != seed) )
+		++slot;
 
-//*************************************************************************************************
-// generic noise function, call noise based on basis function
-float Noise::noise3dS(float x, float y, float z, int noiseBasis)
+	if( slot == s_tableCount )
+	{
+		NoisePermutationTable *entry = NULL;
+
+		if( s_tableCount < NOISE_TABLE_CACHE_SIZE )
+			++s_tableCount;
+		else
+		{
+			slot = 0;
+			for( unsigned int i = 1; i < NOISE_TABLE_CACHE_SIZE; ++i )
+				if( s_tableCache[i]->used < s_tableCache[slot]->used )
+					slot = i;
+
+			// reuse the evicted table unless somebody still works with it
+			entry = s_tableCache[slot];
+			entry->cached = false;
+			if( entry->users > 0 )
+				entry = NULL;
+		}
+
+		if( !entry )
+			entry = newPermutationTable();
+
+		entry->seed = seed;
+		entry->users = 0;
+		entry->cached = true;
+		buildPermutationTable(seed, entry->table);
+		s_tableCache[slot] = entry;
+	}
+
+	NoisePermutationTable *entry = s_tableCache[slot];
+	entry->used = ++s_tableClock;
+	++entry->users;
+
+	pthread_mutex_unlock(&s_tableMutex);
+
+	return &entry->table;
+}
+
+static void releasePermutationTable( const NoiseTable *table )
 {
-    float (Noise::*noisefunc)(float, float, float) ;
-    noisefunc = getNoiseFunctionPtrS(noiseBasis);
-    return (*this.*noisefunc)(x, y, z);
+	if( table == &s_defaultTable )
+		return;
+
+	pthread_mutex_lock(&s_tableMutex);
+
+	NoisePermutationTable *entry = (NoisePermutationTable*)table;
+	if( (--entry->users == 0) && !entry->cached )
+		free(entry->block);
+
+	pthread_mutex_unlock(&s_tableMutex);
 }
 
-/* General Vector noise */
-void Noise::noiseVector( float x, float y, float z, int nb, float v[3] )
-{   
-    float (Noise::*noisefunc)(float, float, float) ;
-    noisefunc = getNoiseFunctionPtrS(nb);
 
-	/* Simply evaluate noise at 3 different positions */
-	v[0] = (float)( (*this.*noisefunc)(x + 9.321f, y - 1.531f,  z - 7.951f));
-	v[1] = (float)( (*this.*noisefunc)(x,          y,           z        ) );
-	v[2] = (float)( (*this.*noisefunc)(x + 6.327f, y + 0.1671f, z - 2.672f));
+//************************************************************************************************
+// constructor
+Noise::Noise()
+{
+	// start with the default permutation table
+	table = &s_defaultTable;
+	defaultPermutationTable();
+}
+
+Noise::Noise( const unsigned int seed )
+{
+	table = &s_defaultTable;
+	defaultPermutationTable();
+	reshufflePermutationTable(seed);
 }
 
 //************************************************************************************************
-// turbulence
+void Noise::defaultPermutationTable()
+{
+	releasePermutationTable(table);
+	table = &s_defaultTable;
 
-float Noise::turbulence3dS(float x, float y, float z, int oct, bool hard, int noiseBasis)
+	tableSeed = NOISE_DEFAULT_SEED;
+	cellSeed = 0;
+}
+
+void Noise::reshufflePermutationTable( const unsigned int seed )
 {
-    // todo: maybe make frequency scale and amp scale visible to the outside
-    
-	float (Noise::*noisefunc)(float, float, float) ;
-	float sum, t, amp=1, fscale =1;
-	int i;
-	
-    noisefunc = getNoiseFunctionPtrS(noiseBasis);
+	if( seed == tableSeed )
+		return;
 
-	sum = 0;
-	for (i=0;i<=oct;i++, amp*=0.5, fscale*=2) 
-    {
-		t = (*this.*noisefunc)(fscale*x, fscale*y, fscale*z);
-		if (hard) t = fabs(2.0*t-1.0);
-		sum += t * amp;
+	if( seed == NOISE_DEFAULT_SEED )
+	{
+		defaultPermutationTable();
+		return;
 	}
-	
-	sum *= ((float)(1<<oct)/(float)((1<<(oct+1))-1));
 
-	return sum;
+	// only the lookup is done under the lock, the table itself isn't copied
+	const NoiseTable *seedTable = getPermutationTable(seed);
+	releasePermutationTable(table);
+	table = seedTable;
 
+	tableSeed = seed;
+	cellSeed = seed * 2654435761u;
 }
 
-
-/* Turbulence Vector */
-
-void Noise::turbulenceVector( float x, float y, float z, int oct, bool hard, int noiseBasis, float v[3] )
+//************************************************************************************************
+// destructor
+Noise::~Noise()
 {
-	float t[3];
-	int i;
-	float amp = 1.f;
-	float ampScale = 0.5f;    
-    float freqscale = 1.f;
-    
-	noiseVector( x, y, z, noiseBasis, v );
-	if( hard ) 
-    {
-		v[0] = (float)fabs( v[0] );
-		v[1] = (float)fabs( v[1] );
-		v[2] = (float)fabs( v[2] );
-	}
-    
-	for( i = 1; i < oct; i++ ) 
-    {
-		amp *= ampScale;
-        freqscale *= 2;
-		x *= freqscale;
-		y *= freqscale;
-		z *= freqscale;
-		noiseVector( x, y, z, noiseBasis, t );
-        
-		if( hard ) 
-        {
-			t[0] = (float)fabs( t[0] );
-			t[1] = (float)fabs( t[1] );
-			t[2] = (float)fabs( t[2] );
-		}
-		v[0] += amp * t[0];
-		v[1] += amp * t[1];
-		v[2] += amp * t[2];
-	}
+	releasePermutationTable(table);
 }
 
 
+//*************************************************************************************************
+// the same as the floor and unsignedToSignedNoiseValue members, for the templates outside the class
+static inline int noiseFloor( const float x ) { return ((int)(x) - ((x) < 0 && (x) != (int)(x)));  }
+static inline float noiseToSigned( const float x ) { return (2.0 * x -1.0); }
 
 
 //************************************************************************************************
@@ -468,58 +561,6 @@ float Noise::gradient( const int hash, const float x, const float y, const float
 	}
 }
 
-float Noise::gradient( const int hash, const float x, const float y, const float z ) 
-{
-	// choose the index of one of 16 gradient vectors ( 0  15 )
-	const int h = hash & 15;
-
-	/* original Perlin's code, much shorter from my BIG-GIANT switch statement
-
-	float u = (h < 8) ? x : y; 
-	float v = (h < 4) ? y : (h==12 || h==14) ? x : z;
-	return (( h & 1 ) == 0 ? u : -u) + (( h & 2 ) == 0 ? v : -v);
-	*/
-
-	switch( h )
-	{
-	case 0:
-		return x + y;		// DP3( (x,y,z), (1,1,0) )
-	case 1:
-		return -x + y;		// DP3( (x,y,z), (-1,1,0) )
-	case 2:
-		return x - y;		// DP3( (x,y,z), (1,-1,0) )
-	case 3:
-		return -x - y;		// DP3( (x,y,z), (-1,-1,0) )
-	case 4:
-		return x + z;		// DP3( (x,y,z), (1,0,1) )
-	case 5:
-		return -x + z;
-	case 6:
-		return x - z;
-	case 7:
-		return -x - z;
-	case 8:
-		return y + z;
-	case 9:
-		return -y + z;
-	case 10:
-		return y - z;
-	case 11:
-		return -y - z;
-
-	// padding from 12 to 16 cases, for explanation
-	// see Perlin's document on Improved Perlin Noise implementation
-	case 12:
-		return y + x;
-	case 13:
-		return -y + z;
-	case 14:
-		return y - x;
-	default:				// case 15:
-		return -y - z;		// DP3( (x,y,z), (0,-1,-1) )
-	}
-}
-
 float Noise::gradient( const int hash, const float x, const float y )
 {
 
@@ -561,8 +602,8 @@ float Noise::improvedPerlin1dS( float x)
 
 	int X1 = X + 1;	
 
-	return lerp( fade( x ), gradient( hash[ X  ], x     ),
-							gradient( hash[ X1 ], x - 1 ));
+	return lerp( fade( x ), gradient( table->hash[ X  ], x     ),
+							gradient( table->hash[ X1 ], x - 1 ));
 }
 
 float Noise::improvedPerlin1dU(float x)
@@ -593,18 +634,18 @@ float Noise::improvedPerlin2dS( float x, float y)
 	int X1 = X + 1;	
 	int Y1 = Y + 1;	
 
-	int AA = hash[ X  ] + Y;		// left		bottom
-	int BA = hash[ X1 ] + Y;		// right	bottom
-	int AB = hash[ X  ] + Y1;	// left		top
-	int BB = hash[ X1 ] + Y1;	// right	top
+	int AA = table->hash[ X  ] + Y;		// left		bottom
+	int BA = table->hash[ X1 ] + Y;		// right	bottom
+	int AB = table->hash[ X  ] + Y1;	// left		top
+	int BB = table->hash[ X1 ] + Y1;	// right	top
 
 	const float x_1 = x - 1.0f;
 	const float y_1 = y - 1.0f;
 
-	return lerp( b, lerp( a, gradient( hash[ AA ], x  , y   ),
-							 gradient( hash[ BA ], x_1, y   )),
-					lerp( a, gradient( hash[ AB ], x  , y_1 ),
-							 gradient( hash[ BB ], x_1, y_1 )));
+	return lerp( b, lerp( a, gradient( table->hash[ AA ], x  , y   ),
+							 gradient( table->hash[ BA ], x_1, y   )),
+					lerp( a, gradient( table->hash[ AB ], x  , y_1 ),
+							 gradient( table->hash[ BB ], x_1, y_1 )));
 }
 
 float Noise::improvedPerlin2dU(float x, float y)
@@ -646,22 +687,22 @@ float Noise::improvedPerlin3dS(float x, float y, float z)
 	// indices for 2 noise quads
 	//--------------------------
 
-	int AA = hash[ X  ] + Y;		// left		bottom
-	int BA = hash[ X1 ] + Y;		// right	bottom
-	int AB = hash[ X  ] + Y1;	// left		top
-	int BB = hash[ X1 ] + Y1;	// right	top
+	int AA = table->hash[ X  ] + Y;		// left		bottom
+	int BA = table->hash[ X1 ] + Y;		// right	bottom
+	int AB = table->hash[ X  ] + Y1;	// left		top
+	int BB = table->hash[ X1 ] + Y1;	// right	top
 
 	// front-side quad indices
-	int AAA = hash[ AA ] + Z;
-	int BAA = hash[ BA ] + Z;
-	int ABA = hash[ AB ] + Z;
-	int BBA = hash[ BB ] + Z;
+	int AAA = table->hash[ AA ] + Z;
+	int BAA = table->hash[ BA ] + Z;
+	int ABA = table->hash[ AB ] + Z;
+	int BBA = table->hash[ BB ] + Z;
 
 	// back-side quad indices
-	int AAB = hash[ AA ] + Z1;
-	int BAB = hash[ BA ] + Z1;
-	int ABB = hash[ AB ] + Z1;
-	int BBB = hash[ BB ] + Z1;
+	int AAB = table->hash[ AA ] + Z1;
+	int BAB = table->hash[ BA ] + Z1;
+	int ABB = table->hash[ AB ] + Z1;
+	int BBB = table->hash[ BB ] + Z1;
 
 	//-----------------------
 	// lerp between the quads
@@ -671,14 +712,14 @@ float Noise::improvedPerlin3dS(float x, float y, float z)
 	const float y_1 = y - 1.0f;
 	const float z_1 = z - 1.0f;
 
-	return lerp( c, lerp( b, lerp( a, gradient( hash[ AAA ], x  , y  , z   ),
-								      gradient( hash[ BAA ], x_1, y  , z   )),
-						     lerp( a, gradient( hash[ ABA ], x  , y_1, z   ),
-								      gradient( hash[ BBA ], x_1, y_1, z   ))),
-				    lerp( b, lerp( a, gradient( hash[ AAB ], x  , y  , z_1 ),
-								      gradient( hash[ BAB ], x_1, y  , z_1 )),
-						     lerp( a, gradient( hash[ ABB ], x  , y_1, z_1 ),
-								      gradient( hash[ BBB ], x_1, y_1, z_1 ))));
+	return lerp( c, lerp( b, lerp( a, tableGradient( table->gradient[ AAA ], x  , y  , z   ),
+								      tableGradient( table->gradient[ BAA ], x_1, y  , z   )),
+						     lerp( a, tableGradient( table->gradient[ ABA ], x  , y_1, z   ),
+								      tableGradient( table->gradient[ BBA ], x_1, y_1, z   ))),
+				    lerp( b, lerp( a, tableGradient( table->gradient[ AAB ], x  , y  , z_1 ),
+								      tableGradient( table->gradient[ BAB ], x_1, y  , z_1 )),
+						     lerp( a, tableGradient( table->gradient[ ABB ], x  , y_1, z_1 ),
+								      tableGradient( table->gradient[ BBB ], x_1, y_1, z_1 ))));
 }
 
 float Noise::improvedPerlin3dU(float x, float y, float z)                      
@@ -723,39 +764,39 @@ float Noise::improvedPerlin4dS(	float x, float y, float z, float w)
 	// indices for 2 noise volumes
 	//----------------------------
 
-	int AA = hash[ X  ] + Y;		// left		bottom
-	int BA = hash[ X1 ] + Y;		// right	bottom
-
-	int AB = hash[ X  ] + Y1;	// left		top
-	int BB = hash[ X1 ] + Y1;	// right	top
-
-	int AAA = hash[ AA ] + Z;	// left		bottom	front
-	int BAA = hash[ BA ] + Z;	// right	bottom	front
-	int ABA = hash[ AB ] + Z;	// left		top		front
-	int BBA = hash[ BB ] + Z;	// right	top		front
-
-	int AAB = hash[ AA ] + Z1;	// left		bottom	back
-	int BAB = hash[ BA ] + Z1;	// right	bottom	back
-	int ABB = hash[ AB ] + Z1;	// left		top		back
-	int BBB = hash[ BB ] + Z1;	// right	top		back
-
-	int AAAA = hash[ AAA ] + W;	// left		bottom	front	volume1
-	int BAAA = hash[ BAA ] + W;	// right	bottom	front	volume1
-	int ABAA = hash[ ABA ] + W;	// left		top		front	volume1
-	int BBAA = hash[ BBA ] + W;	// right	top		front	volume1
-	int AABA = hash[ AAB ] + W;	// left		bottom	back	volume1
-	int BABA = hash[ BAB ] + W;	// right	bottom	back	volume1
-	int ABBA = hash[ ABB ] + W;	// left		top		back	volume1
-	int BBBA = hash[ BBB ] + W;	// right	top		back	volume1
-
-	int AAAB = hash[ AAA ] + W1;	// left		bottom	front	volume2
-	int BAAB = hash[ BAA ] + W1;	// right	bottom	front	volume2
-	int ABAB = hash[ ABA ] + W1;	// left		top		front	volume2
-	int BBAB = hash[ BBA ] + W1;	// right	top		front	volume2
-	int AABB = hash[ AAB ] + W1;	// left		bottom	back	volume2
-	int BABB = hash[ BAB ] + W1;	// right	bottom	back	volume2
-	int ABBB = hash[ ABB ] + W1;	// left		top		back	volume2
-	int BBBB = hash[ BBB ] + W1;	// right	top		back	volume2
+	int AA = table->hash[ X  ] + Y;		// left		bottom
+	int BA = table->hash[ X1 ] + Y;		// right	bottom
+
+	int AB = table->hash[ X  ] + Y1;	// left		top
+	int BB = table->hash[ X1 ] + Y1;	// right	top
+
+	int AAA = table->hash[ AA ] + Z;	// left		bottom	front
+	int BAA = table->hash[ BA ] + Z;	// right	bottom	front
+	int ABA = table->hash[ AB ] + Z;	// left		top		front
+	int BBA = table->hash[ BB ] + Z;	// right	top		front
+
+	int AAB = table->hash[ AA ] + Z1;	// left		bottom	back
+	int BAB = table->hash[ BA ] + Z1;	// right	bottom	back
+	int ABB = table->hash[ AB ] + Z1;	// left		top		back
+	int BBB = table->hash[ BB ] + Z1;	// right	top		back
+
+	int AAAA = table->hash[ AAA ] + W;	// left		bottom	front	volume1
+	int BAAA = table->hash[ BAA ] + W;	// right	bottom	front	volume1
+	int ABAA = table->hash[ ABA ] + W;	// left		top		front	volume1
+	int BBAA = table->hash[ BBA ] + W;	// right	top		front	volume1
+	int AABA = table->hash[ AAB ] + W;	// left		bottom	back	volume1
+	int BABA = table->hash[ BAB ] + W;	// right	bottom	back	volume1
+	int ABBA = table->hash[ ABB ] + W;	// left		top		back	volume1
+	int BBBA = table->hash[ BBB ] + W;	// right	top		back	volume1
+
+	int AAAB = table->hash[ AAA ] + W1;	// left		bottom	front	volume2
+	int BAAB = table->hash[ BAA ] + W1;	// right	bottom	front	volume2
+	int ABAB = table->hash[ ABA ] + W1;	// left		top		front	volume2
+	int BBAB = table->hash[ BBA ] + W1;	// right	top		front	volume2
+	int AABB = table->hash[ AAB ] + W1;	// left		bottom	back	volume2
+	int BABB = table->hash[ BAB ] + W1;	// right	bottom	back	volume2
+	int ABBB = table->hash[ ABB ] + W1;	// left		top		back	volume2
+	int BBBB = table->hash[ BBB ] + W1;	// right	top		back	volume2
 
 	//-------------------------
 	// lerp between the volumes
@@ -766,22 +807,22 @@ float Noise::improvedPerlin4dS(	float x, float y, float z, float w)
 	const float z_1 = z - 1.0f;
 	const float w_1 = w - 1.0f;
 
-	return lerp( d, lerp( c, lerp( b, lerp( a,  gradient( hash[ AAAA ], x  , y  , z  , w   ), 
-												gradient( hash[ BAAA ], x_1, y  , z  , w   )),
-									  lerp( a,	gradient( hash[ ABAA ], x  , y_1, z  , w   ), 
-												gradient( hash[ BBAA ], x_1, y_1, z  , w   ))),
-							 lerp( b, lerp( a,	gradient( hash[ AABA ], x  , y  , z_1, w   ), 
-												gradient( hash[ BABA ], x_1, y  , z_1, w   )),
-									  lerp( a,	gradient( hash[ ABBA ], x  , y_1, z_1, w   ),
-												gradient( hash[ BBBA ], x_1, y_1, z_1, w   )))),
-					lerp( c, lerp( b, lerp( a,	gradient( hash[ AAAB ], x  , y  , z  , w_1 ), 
-												gradient( hash[ BAAB ], x_1, y  , z  , w_1 )),
-									  lerp( a,	gradient( hash[ ABAB ], x  , y_1, z  , w_1 ), 
-												gradient( hash[ BBAB ], x_1, y_1, z  , w_1 ))),
-							 lerp( b, lerp( a,	gradient( hash[ AABB ], x  , y  , z_1, w_1 ), 
-												gradient( hash[ BABB ], x_1, y  , z_1, w_1 )),
-									  lerp( a,	gradient( hash[ ABBB ], x  , y_1, z_1, w_1 ),
-												gradient( hash[ BBBB ], x_1, y_1, z_1, w_1 )))));
+	return lerp( d, lerp( c, lerp( b, lerp( a,  gradient( table->hash[ AAAA ], x  , y  , z  , w   ), 
+												gradient( table->hash[ BAAA ], x_1, y  , z  , w   )),
+									  lerp( a,	gradient( table->hash[ ABAA ], x  , y_1, z  , w   ), 
+												gradient( table->hash[ BBAA ], x_1, y_1, z  , w   ))),
+							 lerp( b, lerp( a,	gradient( table->hash[ AABA ], x  , y  , z_1, w   ), 
+												gradient( table->hash[ BABA ], x_1, y  , z_1, w   )),
+									  lerp( a,	gradient( table->hash[ ABBA ], x  , y_1, z_1, w   ),
+												gradient( table->hash[ BBBA ], x_1, y_1, z_1, w   )))),
+					lerp( c, lerp( b, lerp( a,	gradient( table->hash[ AAAB ], x  , y  , z  , w_1 ), 
+												gradient( table->hash[ BAAB ], x_1, y  , z  , w_1 )),
+									  lerp( a,	gradient( table->hash[ ABAB ], x  , y_1, z  , w_1 ), 
+												gradient( table->hash[ BBAB ], x_1, y_1, z  , w_1 ))),
+							 lerp( b, lerp( a,	gradient( table->hash[ AABB ], x  , y  , z_1, w_1 ), 
+												gradient( table->hash[ BABB ], x_1, y  , z_1, w_1 )),
+									  lerp( a,	gradient( table->hash[ ABBB ], x  , y_1, z_1, w_1 ),
+												gradient( table->hash[ BBBB ], x_1, y_1, z_1, w_1 )))));
 }
 
 
@@ -793,181 +834,917 @@ float Noise::improvedPerlin4dU(float x, float y, float z, float w)
 
 
 //************************************************************************************************
-// voronoi / worley noise
+// batched improved perlin noise
 //
+// the samples are processed in blocks: a first pass does the floors and the permutation table
+// lookups one sample at a time and keeps the corner hashes, a second pass does the arithmetic
+// as straight line code over the whole block. the gradients are picked by arithmetic on the
+// hash bits instead of the switch statements, which keeps the second pass free of branches.
+// the gradient terms are summed in the same order as in the switch statements and lerp and
+// fade are the same, so the results match the single sample calls
 
-// distance metrics for voronoi, e parameter only used in Minkovsky
-
-// distance squared
-static float voronoiDistanceSquared(float x, float y, float z, float e) 
-{ 
-    return (x*x + y*y + z*z); 
-}
-
-// real distance
-static float voronoiDistanceReal(float x, float y, float z, float e) 
-{ 
-    return sqrt(x*x + y*y + z*z); 
-}
+#define NOISE_BATCH_SIZE 64
 
-// manhattan/taxicab/cityblock distance
-static float voronoiDistanceManhattan(float x, float y, float z, float e) 
-{ 
-    return (fabs(x) + fabs(y) + fabs(z)); 
-}
+// branch free versions of the gradient functions above
+#define gradientSign(h, bit) (float((((h) >> (bit)) & 1) << 1) - 1.0f)
 
-// Chebychev 
-static float voronoiDistanceChebychev(float x, float y, float z, float e)
+static inline float batchGradient( const int h, const float x )
 {
-	float t;
-	x = fabs(x);
-	y = fabs(y);
-	z = fabs(z);
-	t = (x>y)?x:y;
-	return ((z>t)?z:t);
+	return gradientSign(h, 0) * x;
 }
 
-// minkovsky preset exponent
-static float voronoiDistanceMinkovskyH(float x, float y, float z, float e)
+static inline float batchGradient( const int h, const float x, const float y )
 {
-	float d = sqrt(fabs(x)) + sqrt(fabs(y)) + sqrt(fabs(z));
-	return (d*d);
+	// 0-3: (+-x) + (+-y), 4-5: +-x, 6-7: +-y
+	static const float gx[8] = { 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 0.0f, 0.0f };
+	static const float gy[8] = { 1.0f, -1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, -1.0f };
+	return gx[h] * x + gy[h] * y;
 }
 
-// minkovsky preset exponent 4
-static float voronoiDistanceMinkovsky4(float x, float y, float z, float e)
+static inline float batchGradient( const int h, const float x, const float y, const float z, const float w )
 {
-	x *= x;
-	y *= y;
-	z *= z;
-	return sqrt(sqrt(x*x + y*y + z*z));
+	// h >> 3 picks the three components (x,y,z), (w,x,y), (z,w,x) or (y,z,w), bits 2,1,0 their signs
+	const float p[4] = { x, y, z, w };
+	const int a = (4 - (h >> 3)) & 3;
+	return gradientSign(h, 2) * p[a] + gradientSign(h, 1) * p[(a + 1) & 3] + gradientSign(h, 0) * p[(a + 2) & 3];
 }
 
-// Minkovsky, general case, slow, maybe too slow to be useful 
-static float voronoiDistanceMinkovsky(float x, float y, float z, float e)
-{
-    return pow(pow(fabs(x), e) + pow(fabs(y), e) + pow(fabs(z), e), 1.0/e);
-}
 
+//************************************************************************************************
+// lattices of the batched noise, they give the two permutation table indices X0 and X1 of the cell
+// corners along an axis for the integer part X of the sample coordinate
 
-//  Not 'pure' Worley, but the results are virtually the same.
-//	Returns distances in da and point coords in pa */
-void Noise::voronoi(float x, float y, float z, float* da, float* pa, float me, int dtype)
+// the unbounded lattice, it repeats every 256 cells with the permutation table
+struct PerlinLattice
 {
-	int xx, yy, zz, xi, yi, zi;
-	float xd, yd, zd, d, *p;
+	inline void corners( const int, const int X, int &X0, int &X1 ) const
+	{
+		X0 = X & 255;
+		X1 = (X + 1) & 255;
+	}
+};
 
-	float (*distfunc)(float, float, float, float);
-	switch (dtype) 
-    {
-		case VORONOI_DIST_SQUARED   : distfunc = voronoiDistanceSquared; break;
-		case VORONOI_DIST_MANHATTAN : distfunc = voronoiDistanceManhattan; break;
-		case VORONOI_DIST_CHEBYCHEV : distfunc = voronoiDistanceChebychev; break;
-		case VORONOI_DIST_MINKOVSKYH:	distfunc = voronoiDistanceMinkovskyH; break;
-		case VORONOI_DIST_MINKOVSKY4: distfunc = voronoiDistanceMinkovsky4; break;
-		case VORONOI_DIST_MINKOVSKY : distfunc = voronoiDistanceMinkovsky; break;
-		case VORONOI_DIST_REAL:
-        default: distfunc = voronoiDistanceReal;
+// a lattice that wraps every period cells along the axes with a period > 0, which makes the noise tile
+// with that period, the other axes are unbounded. where the lattice doesn't wrap, the corners are the
+// ones of the unbounded lattice
+struct PerlinPeriodicLattice
+{
+	PerlinPeriodicLattice( const int *p, const int dimensions )
+	{
+		for (int d = 0; d < 4; d++)
+			period[d] = (d < dimensions) ? p[d] : 0;
 	}
 
-	xi = (int)(floor(x));
-	yi = (int)(floor(y));
-	zi = (int)(floor(z));
-	da[0] = da[1] = da[2] = da[3] = 1e10f;
-	for (xx=xi-1;xx<=xi+1;xx++) 
-    {
-		for (yy=yi-1;yy<=yi+1;yy++) 
-        {
-			for (zz=zi-1;zz<=zi+1;zz++) 
-            {
-				p = HASHPNT(xx, yy, zz);
-				xd = x - (p[0] + xx);
-				yd = y - (p[1] + yy);
-				zd = z - (p[2] + zz);
-				d = distfunc(xd, yd, zd, me);
-				if (d<da[0]) 
-                {
-					da[3]=da[2];  da[2]=da[1];  da[1]=da[0];  da[0]=d;
-					pa[9]=pa[6];  pa[10]=pa[7];  pa[11]=pa[8];
-					pa[6]=pa[3];  pa[7]=pa[4];  pa[8]=pa[5];
-					pa[3]=pa[0];  pa[4]=pa[1];  pa[5]=pa[2];
-					pa[0]=p[0]+xx;  pa[1]=p[1]+yy;  pa[2]=p[2]+zz;
-				}
-				else if (d<da[1]) 
-                {
-					da[3]=da[2];  da[2]=da[1];  da[1]=d;
-					pa[9]=pa[6];  pa[10]=pa[7];  pa[11]=pa[8];
-					pa[6]=pa[3];  pa[7]=pa[4];  pa[8]=pa[5];
-					pa[3]=p[0]+xx;  pa[4]=p[1]+yy;  pa[5]=p[2]+zz;
-				}
-				else if (d<da[2]) 
-                {
-					da[3]=da[2];  da[2]=d;
-					pa[9]=pa[6];  pa[10]=pa[7];  pa[11]=pa[8];
-					pa[6]=p[0]+xx;  pa[7]=p[1]+yy;  pa[8]=p[2]+zz;
-				}
-				else if (d<da[3]) 
-                {
-					da[3]=d;
-					pa[9]=p[0]+xx;  pa[10]=p[1]+yy;  pa[11]=p[2]+zz;
-				}
-			}
+	inline void corners( const int axis, int X, int &X0, int &X1 ) const
+	{
+		const int p = period[axis];
+		if (p > 0)
+		{
+			X %= p;
+			if (X < 0)
+				X += p;
+			X0 = X & 255;
+			X1 = ((X + 1 < p) ? X + 1 : 0) & 255;
+		}
+		else
+		{
+			X0 = X & 255;
+			X1 = (X + 1) & 255;
 		}
 	}
-}
 
+	int period[4];
+};
 
-/**************/
-// wrapper to retrieve different aspect of worley noise
-float Noise::voronoiF1U(float x, float y, float z)
-{
-	float da[4], pa[12];
-	voronoi(x, y, z, da, pa, 1,VORONOI_DIST_REAL);
-	return da[0];
-}
 
-float Noise::voronoiF1S(float x, float y, float z)
+//************************************************************************************************
+template <class Lattice>
+static void improvedPerlin1dBatch(const NoiseTable &table, const Lattice &lattice, const float* x, float* out, size_t n)
 {
-    return unsignedToSignedNoiseValue(voronoiF1U(x,y,z));
-}
+	const unsigned char *hash = table.hash;
+	int h[2][NOISE_BATCH_SIZE];
+	float fx[NOISE_BATCH_SIZE];
 
-/**************/
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *bx = x + start;
+		float *bo = out + start;
 
-float Noise::voronoiF2U(float x, float y, float z)
-{
-	float da[4], pa[12];
-	voronoi(x, y, z, da, pa, 1,VORONOI_DIST_REAL);
-	return da[1];
-}
+		// hashes
+		for (int i = 0; i < m; i++)
+		{
+			const int X = noiseFloor( bx[i] );
+			fx[i] = bx[i] - X;
 
-float Noise::voronoiF2S(float x, float y, float z)
-{
-    return unsignedToSignedNoiseValue(voronoiF2U(x,y,z));
-}
+			int X0, X1;
+			lattice.corners( 0, X, X0, X1 );
 
-/**************/
+			h[0][i] = hash[ X0 ] & 1;
+			h[1][i] = hash[ X1 ] & 1;
+		}
 
-float Noise::voronoiF3U(float x, float y, float z)
-{
-	float da[4], pa[12];
-	voronoi(x, y, z, da, pa, 1, VORONOI_DIST_REAL);
-	return da[2];
+		// gradients and lerps
+		for (int i = 0; i < m; i++)
+		{
+			const float x0 = fx[i];
+			bo[i] = lerp( fade( x0 ), batchGradient( h[0][i], x0 ),
+									  batchGradient( h[1][i], x0 - 1 ));
+		}
+	}
 }
 
-float Noise::voronoiF3S(float x, float y, float z)
+void Noise::improvedPerlin1dS(const float* x, float* out, size_t n)
 {
-    return unsignedToSignedNoiseValue(voronoiF3U(x,y,z));
+	improvedPerlin1dBatch( *table, PerlinLattice(), x, out, n );
 }
 
-/**************/
-float Noise::voronoiF4U(float x, float y, float z)
+void Noise::improvedPerlin1dS(const float* x, float* out, size_t n, const int period[1])
 {
-	float da[4], pa[12];
-	voronoi(x, y, z, da, pa, 1, VORONOI_DIST_REAL);
-	return da[3];
+	improvedPerlin1dBatch( *table, PerlinPeriodicLattice( period, 1 ), x, out, n );
 }
 
-float Noise::voronoiF4S(float x, float y, float z)
+//************************************************************************************************
+template <class Lattice>
+static void improvedPerlin2dBatch(const NoiseTable &table, const Lattice &lattice, const float* x, const float* y, float* out, size_t n)
+{
+	const unsigned char *hash = table.hash;
+	int h[4][NOISE_BATCH_SIZE];
+	float fx[NOISE_BATCH_SIZE], fy[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *bx = x + start;
+		const float *by = y + start;
+		float *bo = out + start;
+
+		// hashes of the 4 corners
+		for (int i = 0; i < m; i++)
+		{
+			const int X = noiseFloor( bx[i] );
+			const int Y = noiseFloor( by[i] );
+
+			fx[i] = bx[i] - X;
+			fy[i] = by[i] - Y;
+
+			int X0, X1, Y0, Y1;
+			lattice.corners( 0, X, X0, X1 );
+			lattice.corners( 1, Y, Y0, Y1 );
+
+			const int A = hash[ X0 ];
+			const int B = hash[ X1 ];
+
+			h[0][i] = hash[ A + Y0 ] & 7;
+			h[1][i] = hash[ B + Y0 ] & 7;
+			h[2][i] = hash[ A + Y1 ] & 7;
+			h[3][i] = hash[ B + Y1 ] & 7;
+		}
+
+		// gradients and lerps
+		for (int i = 0; i < m; i++)
+		{
+			const float x0 = fx[i];
+			const float y0 = fy[i];
+			const float x_1 = x0 - 1.0f;
+			const float y_1 = y0 - 1.0f;
+
+			const float a = fade( x0 );
+			const float b = fade( y0 );
+
+			bo[i] = lerp( b, lerp( a, batchGradient( h[0][i], x0 , y0  ),
+									  batchGradient( h[1][i], x_1, y0  )),
+							 lerp( a, batchGradient( h[2][i], x0 , y_1 ),
+									  batchGradient( h[3][i], x_1, y_1 )));
+		}
+	}
+}
+
+void Noise::improvedPerlin2dS(const float* x, const float* y, float* out, size_t n)
+{
+	improvedPerlin2dBatch( *table, PerlinLattice(), x, y, out, n );
+}
+
+void Noise::improvedPerlin2dS(const float* x, const float* y, float* out, size_t n, const int period[2])
+{
+	improvedPerlin2dBatch( *table, PerlinPeriodicLattice( period, 2 ), x, y, out, n );
+}
+
+//************************************************************************************************
+template <class Lattice>
+static void improvedPerlin3dBatch(const NoiseTable &table, const Lattice &lattice, const float* x, const float* y, const float* z, float* out, size_t n)
+{
+	const unsigned char *hash = table.hash;
+	int h[8][NOISE_BATCH_SIZE];
+	float fx[NOISE_BATCH_SIZE], fy[NOISE_BATCH_SIZE], fz[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *bx = x + start;
+		const float *by = y + start;
+		const float *bz = z + start;
+		float *bo = out + start;
+
+		// hashes of the 8 corners
+		for (int i = 0; i < m; i++)
+		{
+			const int X = noiseFloor( bx[i] );
+			const int Y = noiseFloor( by[i] );
+			const int Z = noiseFloor( bz[i] );
+
+			fx[i] = bx[i] - X;
+			fy[i] = by[i] - Y;
+			fz[i] = bz[i] - Z;
+
+			int X0, X1, Y0, Y1, Z0, Z1;
+			lattice.corners( 0, X, X0, X1 );
+			lattice.corners( 1, Y, Y0, Y1 );
+			lattice.corners( 2, Z, Z0, Z1 );
+
+			const int A = hash[ X0 ];
+			const int B = hash[ X1 ];
+
+			const int xy[4] = { hash[ A + Y0 ], hash[ B + Y0 ], hash[ A + Y1 ], hash[ B + Y1 ] };
+
+			// the last permutation step is folded into table.gradient
+			for (int k = 0; k < 4; k++)
+			{
+				h[k    ][i] = xy[k] + Z0;
+				h[k + 4][i] = xy[k] + Z1;
+			}
+		}
+
+		// gradients and lerps
+		for (int i = 0; i < m; i++)
+		{
+			const float x0 = fx[i];
+			const float y0 = fy[i];
+			const float z0 = fz[i];
+			const float x_1 = x0 - 1.0f;
+			const float y_1 = y0 - 1.0f;
+			const float z_1 = z0 - 1.0f;
+
+			const float a = fade( x0 );
+			const float b = fade( y0 );
+			const float c = fade( z0 );
+
+			bo[i] = lerp( c, lerp( b, lerp( a, tableGradient( table.gradient[ h[0][i] ], x0 , y0 , z0  ),
+											   tableGradient( table.gradient[ h[1][i] ], x_1, y0 , z0  )),
+									  lerp( a, tableGradient( table.gradient[ h[2][i] ], x0 , y_1, z0  ),
+											   tableGradient( table.gradient[ h[3][i] ], x_1, y_1, z0  ))),
+							 lerp( b, lerp( a, tableGradient( table.gradient[ h[4][i] ], x0 , y0 , z_1 ),
+											   tableGradient( table.gradient[ h[5][i] ], x_1, y0 , z_1 )),
+									  lerp( a, tableGradient( table.gradient[ h[6][i] ], x0 , y_1, z_1 ),
+											   tableGradient( table.gradient[ h[7][i] ], x_1, y_1, z_1 ))));
+		}
+	}
+}
+
+void Noise::improvedPerlin3dS(const float* x, const float* y, const float* z, float* out, size_t n)
+{
+	improvedPerlin3dBatch( *table, PerlinLattice(), x, y, z, out, n );
+}
+
+void Noise::improvedPerlin3dS(const float* x, const float* y, const float* z, float* out, size_t n, const int period[3])
+{
+	improvedPerlin3dBatch( *table, PerlinPeriodicLattice( period, 3 ), x, y, z, out, n );
+}
+
+//************************************************************************************************
+template <class Lattice>
+static void improvedPerlin4dBatch(const NoiseTable &table, const Lattice &lattice, const float* x, const float* y, const float* z, const float* w,
+								  float* out, size_t n)
+{
+	const unsigned char *hash = table.hash;
+	int h[16][NOISE_BATCH_SIZE];
+	float fx[NOISE_BATCH_SIZE], fy[NOISE_BATCH_SIZE], fz[NOISE_BATCH_SIZE], fw[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *bx = x + start;
+		const float *by = y + start;
+		const float *bz = z + start;
+		const float *bw = w + start;
+		float *bo = out + start;
+
+		// hashes of the 16 corners, corner k is offset by bit 0 in x, bit 1 in y, bit 2 in z, bit 3 in w
+		for (int i = 0; i < m; i++)
+		{
+			const int X = noiseFloor( bx[i] );
+			const int Y = noiseFloor( by[i] );
+			const int Z = noiseFloor( bz[i] );
+			const int W = noiseFloor( bw[i] );
+
+			fx[i] = bx[i] - X;
+			fy[i] = by[i] - Y;
+			fz[i] = bz[i] - Z;
+			fw[i] = bw[i] - W;
+
+			int X0, X1, Y0, Y1, Z0, Z1, W0, W1;
+			lattice.corners( 0, X, X0, X1 );
+			lattice.corners( 1, Y, Y0, Y1 );
+			lattice.corners( 2, Z, Z0, Z1 );
+			lattice.corners( 3, W, W0, W1 );
+
+			const int A = hash[ X0 ];
+			const int B = hash[ X1 ];
+
+			const int xy[4] = { hash[ A + Y0 ], hash[ B + Y0 ], hash[ A + Y1 ], hash[ B + Y1 ] };
+
+			for (int k = 0; k < 4; k++)
+			{
+				const int xyz0 = hash[ xy[k] + Z0 ];
+				const int xyz1 = hash[ xy[k] + Z1 ];
+				h[k     ][i] = hash[ xyz0 + W0 ] & 31;
+				h[k +  4][i] = hash[ xyz1 + W0 ] & 31;
+				h[k +  8][i] = hash[ xyz0 + W1 ] & 31;
+				h[k + 12][i] = hash[ xyz1 + W1 ] & 31;
+			}
+		}
+
+		// gradients and lerps
+		for (int i = 0; i < m; i++)
+		{
+			const float x0 = fx[i];
+			const float y0 = fy[i];
+			const float z0 = fz[i];
+			const float w0 = fw[i];
+			const float x_1 = x0 - 1.0f;
+			const float y_1 = y0 - 1.0f;
+			const float z_1 = z0 - 1.0f;
+			const float w_1 = w0 - 1.0f;
+
+			const float a = fade( x0 );
+			const float b = fade( y0 );
+			const float c = fade( z0 );
+			const float d = fade( w0 );
+
+			bo[i] = lerp( d, lerp( c, lerp( b, lerp( a, batchGradient( h[ 0][i], x0 , y0 , z0 , w0  ),
+														batchGradient( h[ 1][i], x_1, y0 , z0 , w0  )),
+											   lerp( a, batchGradient( h[ 2][i], x0 , y_1, z0 , w0  ),
+														batchGradient( h[ 3][i], x_1, y_1, z0 , w0  ))),
+									  lerp( b, lerp( a, batchGradient( h[ 4][i], x0 , y0 , z_1, w0  ),
+														batchGradient( h[ 5][i], x_1, y0 , z_1, w0  )),
+											   lerp( a, batchGradient( h[ 6][i], x0 , y_1, z_1, w0  ),
+														batchGradient( h[ 7][i], x_1, y_1, z_1, w0  )))),
+							 lerp( c, lerp( b, lerp( a, batchGradient( h[ 8][i], x0 , y0 , z0 , w_1 ),
+														batchGradient( h[ 9][i], x_1, y0 , z0 , w_1 )),
+											   lerp( a, batchGradient( h[10][i], x0 , y_1, z0 , w_1 ),
+														batchGradient( h[11][i], x_1, y_1, z0 , w_1 ))),
+									  lerp( b, lerp( a, batchGradient( h[12][i], x0 , y0 , z_1, w_1 ),
+														batchGradient( h[13][i], x_1, y0 , z_1, w_1 )),
+											   lerp( a, batchGradient( h[14][i], x0 , y_1, z_1, w_1 ),
+														batchGradient( h[15][i], x_1, y_1, z_1, w_1 )))));
+		}
+	}
+}
+
+void Noise::improvedPerlin4dS(const float* x, const float* y, const float* z, const float* w, float* out, size_t n)
+{
+	improvedPerlin4dBatch( *table, PerlinLattice(), x, y, z, w, out, n );
+}
+
+void Noise::improvedPerlin4dS(const float* x, const float* y, const float* z, const float* w, float* out, size_t n, const int period[4])
+{
+	improvedPerlin4dBatch( *table, PerlinPeriodicLattice( period, 4 ), x, y, z, w, out, n );
+}
+
+
+//************************************************************************************************
+// improved perlin along a scanline, the samples x + i * dx for i < n at the same y and z
+//
+// the cell along y and z, its fade weights and the first level of the corner hashes are the same for
+// the whole line, and the 8 corner hashes only change when a sample enters the next cell, so they are
+// looked up once per cell instead of once per sample
+
+void Noise::improvedPerlin3dRowS(float x, float dx, float y, float z, float* out, size_t n)
+{
+	int h[8][NOISE_BATCH_SIZE];
+	float fx[NOISE_BATCH_SIZE];
+
+	const int Y = noiseFloor( y );
+	const int Z = noiseFloor( z );
+
+	const float y0 = y - Y;
+	const float z0 = z - Z;
+	const float y_1 = y0 - 1.0f;
+	const float z_1 = z0 - 1.0f;
+	const float b = fade( y0 );
+	const float c = fade( z0 );
+
+	int Y0, Y1, Z0, Z1;
+	PerlinLattice lattice;
+	lattice.corners( 1, Y, Y0, Y1 );
+	lattice.corners( 2, Z, Z0, Z1 );
+
+	// the corner hashes of the current cell
+	int cell = 0;
+	int ch[8];
+	bool valid = false;
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		float *bo = out + start;
+
+		// hashes, only looked up when the cell changes
+		for (int i = 0; i < m; i++)
+		{
+			const float xs = x + float(start + i) * dx;
+			const int X = noiseFloor( xs );
+			fx[i] = xs - X;
+
+			if (!valid || (X != cell))
+			{
+				int X0, X1;
+				lattice.corners( 0, X, X0, X1 );
+
+				const int A = table->hash[ X0 ];
+				const int B = table->hash[ X1 ];
+
+				const int xy[4] = { table->hash[ A + Y0 ], table->hash[ B + Y0 ], table->hash[ A + Y1 ], table->hash[ B + Y1 ] };
+
+				for (int k = 0; k < 4; k++)
+				{
+					ch[k    ] = xy[k] + Z0;
+					ch[k + 4] = xy[k] + Z1;
+				}
+
+				cell = X;
+				valid = true;
+			}
+
+			for (int k = 0; k < 8; k++)
+				h[k][i] = ch[k];
+		}
+
+		// gradients and lerps
+		for (int i = 0; i < m; i++)
+		{
+			const float x0 = fx[i];
+			const float x_1 = x0 - 1.0f;
+			const float a = fade( x0 );
+
+			bo[i] = lerp( c, lerp( b, lerp( a, tableGradient( table->gradient[ h[0][i] ], x0 , y0 , z0  ),
+											   tableGradient( table->gradient[ h[1][i] ], x_1, y0 , z0  )),
+									  lerp( a, tableGradient( table->gradient[ h[2][i] ], x0 , y_1, z0  ),
+											   tableGradient( table->gradient[ h[3][i] ], x_1, y_1, z0  ))),
+							 lerp( b, lerp( a, tableGradient( table->gradient[ h[4][i] ], x0 , y0 , z_1 ),
+											   tableGradient( table->gradient[ h[5][i] ], x_1, y0 , z_1 )),
+									  lerp( a, tableGradient( table->gradient[ h[6][i] ], x0 , y_1, z_1 ),
+											   tableGradient( table->gradient[ h[7][i] ], x_1, y_1, z_1 ))));
+		}
+	}
+}
+
+
+//************************************************************************************************
+// improved perlin with its analytic gradient
+//
+// the noise is the trilinear blend (through the fade curves) of the 8 corner values, so its derivative
+// along an axis is the same blend of the corner gradient components plus the derivative of the fade
+// curve times the difference of the two faces across that axis
+
+// derivative of the fade curve
+#define dfade(t) (30.0f*(t)*(t)*((t)*((t)-2.0f)+1.0f))
+
+// value and gradient of the lattice cell with the 8 corner gradients table.gradient[h[k]] (corner k is
+// offset by bit 0 in x, bit 1 in y and bit 2 in z) at the fractional position x, y, z
+static inline float perlinGradient3d( const NoiseTable &table, const int h[8], const float x, const float y, const float z, float grad[3] )
+{
+	const float *g0 = table.gradient[ h[0] ];
+	const float *g1 = table.gradient[ h[1] ];
+	const float *g2 = table.gradient[ h[2] ];
+	const float *g3 = table.gradient[ h[3] ];
+	const float *g4 = table.gradient[ h[4] ];
+	const float *g5 = table.gradient[ h[5] ];
+	const float *g6 = table.gradient[ h[6] ];
+	const float *g7 = table.gradient[ h[7] ];
+
+	const float x_1 = x - 1.0f;
+	const float y_1 = y - 1.0f;
+	const float z_1 = z - 1.0f;
+
+	const float a = fade( x );
+	const float b = fade( y );
+	const float c = fade( z );
+
+	const float v0 = tableGradient( g0, x  , y  , z   );
+	const float v1 = tableGradient( g1, x_1, y  , z   );
+	const float v2 = tableGradient( g2, x  , y_1, z   );
+	const float v3 = tableGradient( g3, x_1, y_1, z   );
+	const float v4 = tableGradient( g4, x  , y  , z_1 );
+	const float v5 = tableGradient( g5, x_1, y  , z_1 );
+	const float v6 = tableGradient( g6, x  , y_1, z_1 );
+	const float v7 = tableGradient( g7, x_1, y_1, z_1 );
+
+	// the edges along x, the faces along y and the volume along z, as in improvedPerlin3dS
+	const float e0 = lerp( a, v0, v1 );
+	const float e1 = lerp( a, v2, v3 );
+	const float e2 = lerp( a, v4, v5 );
+	const float e3 = lerp( a, v6, v7 );
+	const float f0 = lerp( b, e0, e1 );
+	const float f1 = lerp( b, e2, e3 );
+
+	const float da = dfade( x );
+	const float db = dfade( y );
+	const float dc = dfade( z );
+
+	grad[0] = lerp( c, lerp( b, lerp( a, g0[0], g1[0] ), lerp( a, g2[0], g3[0] ) ),
+					   lerp( b, lerp( a, g4[0], g5[0] ), lerp( a, g6[0], g7[0] ) ) )
+			+ da * lerp( c, lerp( b, v1 - v0, v3 - v2 ), lerp( b, v5 - v4, v7 - v6 ) );
+	grad[1] = lerp( c, lerp( b, lerp( a, g0[1], g1[1] ), lerp( a, g2[1], g3[1] ) ),
+					   lerp( b, lerp( a, g4[1], g5[1] ), lerp( a, g6[1], g7[1] ) ) )
+			+ db * lerp( c, e1 - e0, e3 - e2 );
+	grad[2] = lerp( c, lerp( b, lerp( a, g0[2], g1[2] ), lerp( a, g2[2], g3[2] ) ),
+					   lerp( b, lerp( a, g4[2], g5[2] ), lerp( a, g6[2], g7[2] ) ) )
+			+ dc * ( f1 - f0 );
+
+	return lerp( c, f0, f1 );
+}
+
+float Noise::improvedPerlin3dS(float x, float y, float z, float grad[3])
+{
+	int X = floor( x );
+	int Y = floor( y );
+	int Z = floor( z );
+
+	x -= X;
+	y -= Y;
+	z -= Z;
+
+	X &= 255;
+	Y &= 255;
+	Z &= 255;
+
+	const int AA = table->hash[ X     ] + Y;
+	const int BA = table->hash[ X + 1 ] + Y;
+
+	const int AAA = table->hash[ AA     ] + Z;
+	const int BAA = table->hash[ BA     ] + Z;
+	const int ABA = table->hash[ AA + 1 ] + Z;
+	const int BBA = table->hash[ BA + 1 ] + Z;
+
+	const int h[8] = { AAA, BAA, ABA, BBA, AAA + 1, BAA + 1, ABA + 1, BBA + 1 };
+
+	return perlinGradient3d( *table, h, x, y, z, grad );
+}
+
+//************************************************************************************************
+void Noise::improvedPerlin3dS(const float* x, const float* y, const float* z, float* out,
+							  float* gx, float* gy, float* gz, size_t n)
+{
+	int h[NOISE_BATCH_SIZE][8];
+	float fx[NOISE_BATCH_SIZE], fy[NOISE_BATCH_SIZE], fz[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *bx = x + start;
+		const float *by = y + start;
+		const float *bz = z + start;
+
+		// hashes of the 8 corners
+		for (int i = 0; i < m; i++)
+		{
+			int X = floor( bx[i] );
+			int Y = floor( by[i] );
+			int Z = floor( bz[i] );
+
+			fx[i] = bx[i] - X;
+			fy[i] = by[i] - Y;
+			fz[i] = bz[i] - Z;
+
+			X &= 255;
+			Y &= 255;
+			Z &= 255;
+
+			const int AA = table->hash[ X     ] + Y;
+			const int BA = table->hash[ X + 1 ] + Y;
+
+			const int AAA = table->hash[ AA     ] + Z;
+			const int BAA = table->hash[ BA     ] + Z;
+			const int ABA = table->hash[ AA + 1 ] + Z;
+			const int BBA = table->hash[ BA + 1 ] + Z;
+
+			h[i][0] = AAA;
+			h[i][1] = BAA;
+			h[i][2] = ABA;
+			h[i][3] = BBA;
+			h[i][4] = AAA + 1;
+			h[i][5] = BAA + 1;
+			h[i][6] = ABA + 1;
+			h[i][7] = BBA + 1;
+		}
+
+		// values and gradients
+		for (int i = 0; i < m; i++)
+		{
+			float grad[3];
+			out[start + i] = perlinGradient3d( *table, h[i], fx[i], fy[i], fz[i], grad );
+			gx[start + i] = grad[0];
+			gy[start + i] = grad[1];
+			gz[start + i] = grad[2];
+		}
+	}
+}
+
+
+//************************************************************************************************
+// voronoi / worley noise
+//
+
+// distance metrics for voronoi, e parameter only used in Minkovsky
+// they are functors so voronoiCells can be instantiated per metric with the distance inlined
+
+// distance squared
+struct VoronoiDistanceSquared
+{
+	static inline float distance(float x, float y, float z, float) 
+	{ 
+		return (x*x + y*y + z*z); 
+	}
+};
+
+// real distance
+struct VoronoiDistanceReal
+{
+	static inline float distance(float x, float y, float z, float) 
+	{ 
+		return sqrt(x*x + y*y + z*z); 
+	}
+};
+
+// manhattan/taxicab/cityblock distance
+struct VoronoiDistanceManhattan
+{
+	static inline float distance(float x, float y, float z, float) 
+	{ 
+		return (fabs(x) + fabs(y) + fabs(z)); 
+	}
+};
+
+// Chebychev 
+struct VoronoiDistanceChebychev
+{
+	static inline float distance(float x, float y, float z, float)
+	{
+		float t;
+		x = fabs(x);
+		y = fabs(y);
+		z = fabs(z);
+		t = (x>y)?x:y;
+		return ((z>t)?z:t);
+	}
+};
+
+// minkovsky preset exponent
+struct VoronoiDistanceMinkovskyH
+{
+	static inline float distance(float x, float y, float z, float)
+	{
+		float d = sqrt(fabs(x)) + sqrt(fabs(y)) + sqrt(fabs(z));
+		return (d*d);
+	}
+};
+
+// minkovsky preset exponent 4
+struct VoronoiDistanceMinkovsky4
+{
+	static inline float distance(float x, float y, float z, float)
+	{
+		x *= x;
+		y *= y;
+		z *= z;
+		return sqrt(sqrt(x*x + y*y + z*z));
+	}
+};
+
+// Minkovsky, general case, slow, maybe too slow to be useful 
+struct VoronoiDistanceMinkovsky
+{
+	static inline float distance(float x, float y, float z, float e)
+	{
+		return pow(pow(fabs(x), e) + pow(fabs(y), e) + pow(fabs(z), e), 1.0/e);
+	}
+};
+
+
+//  Not 'pure' Worley, but the results are virtually the same.
+//	Returns distances in da and point coords in pa, using the permutation table */
+template <class Distance>
+static void voronoiCells(const NoiseTable &table, float x, float y, float z, float* da, float* pa, float me)
+{
+	const unsigned char *hash = table.hash;
+	int xx, yy, zz, xi, yi, zi;
+	float xd, yd, zd, d;
+	const float *p;
+
+	xi = noiseFloor(x);
+	yi = noiseFloor(y);
+	zi = noiseFloor(z);
+	da[0] = da[1] = da[2] = da[3] = 1e10f;
+	for (xx=xi-1;xx<=xi+1;xx++) 
+    {
+		for (yy=yi-1;yy<=yi+1;yy++) 
+        {
+			for (zz=zi-1;zz<=zi+1;zz++) 
+            {
+				p = HASHPNT(xx, yy, zz);
+				xd = x - (p[0] + xx);
+				yd = y - (p[1] + yy);
+				zd = z - (p[2] + zz);
+				d = Distance::distance(xd, yd, zd, me);
+				if (d<da[0]) 
+                {
+					da[3]=da[2];  da[2]=da[1];  da[1]=da[0];  da[0]=d;
+					pa[9]=pa[6];  pa[10]=pa[7];  pa[11]=pa[8];
+					pa[6]=pa[3];  pa[7]=pa[4];  pa[8]=pa[5];
+					pa[3]=pa[0];  pa[4]=pa[1];  pa[5]=pa[2];
+					pa[0]=p[0]+xx;  pa[1]=p[1]+yy;  pa[2]=p[2]+zz;
+				}
+				else if (d<da[1]) 
+                {
+					da[3]=da[2];  da[2]=da[1];  da[1]=d;
+					pa[9]=pa[6];  pa[10]=pa[7];  pa[11]=pa[8];
+					pa[6]=pa[3];  pa[7]=pa[4];  pa[8]=pa[5];
+					pa[3]=p[0]+xx;  pa[4]=p[1]+yy;  pa[5]=p[2]+zz;
+				}
+				else if (d<da[2]) 
+                {
+					da[3]=da[2];  da[2]=d;
+					pa[9]=pa[6];  pa[10]=pa[7];  pa[11]=pa[8];
+					pa[6]=p[0]+xx;  pa[7]=p[1]+yy;  pa[8]=p[2]+zz;
+				}
+				else if (d<da[3]) 
+                {
+					da[3]=d;
+					pa[9]=p[0]+xx;  pa[10]=p[1]+yy;  pa[11]=p[2]+zz;
+				}
+			}
+		}
+	}
+}
+
+
+// the distances only, for the features that don't need the point coords. the permutation lookups
+// of the z and y rows are shared by the 27 cells, the four nearest distances are kept sorted with
+// a chain of compare exchanges instead of shifting the points along
+#define voronoiInsert(da0, da1, da2, da3, d) \
+	{ \
+		float c = d, t; \
+		t = (da0 < c) ? da0 : c;  c = (da0 < c) ? c : da0;  da0 = t; \
+		t = (da1 < c) ? da1 : c;  c = (da1 < c) ? c : da1;  da1 = t; \
+		t = (da2 < c) ? da2 : c;  c = (da2 < c) ? c : da2;  da2 = t; \
+		da3 = (da3 < c) ? da3 : c; \
+	}
+
+template <class Distance>
+static void voronoiDistances(const NoiseTable &table, float x, float y, float z, float* da, float me)
+{
+	const unsigned char *hash = table.hash;
+	int xx, yy, zz, xi, yi, zi, hz, hyz;
+	float d;
+	const float *p;
+
+	xi = noiseFloor(x);
+	yi = noiseFloor(y);
+	zi = noiseFloor(z);
+	da[0] = da[1] = da[2] = da[3] = 1e10f;
+	for (zz=zi-1;zz<=zi+1;zz++) 
+	{
+		hz = hash[zz & 255];
+		for (yy=yi-1;yy<=yi+1;yy++) 
+		{
+			hyz = hash[(hz + yy) & 255];
+			for (xx=xi-1;xx<=xi+1;xx++) 
+			{
+				p = table.point[(hyz + xx) & 255];
+				d = Distance::distance(x - (p[0] + xx), y - (p[1] + yy), z - (p[2] + zz), me);
+				if (d < da[3]) voronoiInsert(da[0], da[1], da[2], da[3], d);
+			}
+		}
+	}
+}
+
+// the same for a block of m <= NOISE_BATCH_SIZE samples, the distances come back in da[feature][sample].
+// the feature points of all 27 cells are looked up first and kept per cell in structure of arrays
+// layout, the distances and the compare exchanges then run over the samples of the block without
+// branches, so the compiler can vectorize them
+template <class Distance>
+static void voronoiDistances(const NoiseTable &table, const float* x, const float* y, const float* z, float da[4][NOISE_BATCH_SIZE], int m, float me)
+{
+	const unsigned char *hash = table.hash;
+	float px[27][NOISE_BATCH_SIZE], py[27][NOISE_BATCH_SIZE], pz[27][NOISE_BATCH_SIZE];
+
+	for (int i = 0; i < m; i++)
+	{
+		const int xi = noiseFloor(x[i]);
+		const int yi = noiseFloor(y[i]);
+		const int zi = noiseFloor(z[i]);
+		int c = 0;
+
+		for (int zz=zi-1;zz<=zi+1;zz++) 
+		{
+			const int hz = hash[zz & 255];
+			for (int yy=yi-1;yy<=yi+1;yy++) 
+			{
+				const int hyz = hash[(hz + yy) & 255];
+				for (int xx=xi-1;xx<=xi+1;xx++, c++) 
+				{
+					const float *p = table.point[(hyz + xx) & 255];
+					px[c][i] = p[0] + xx;
+					py[c][i] = p[1] + yy;
+					pz[c][i] = p[2] + zz;
+				}
+			}
+		}
+	}
+
+	float *da0 = da[0], *da1 = da[1], *da2 = da[2], *da3 = da[3];
+	for (int i = 0; i < m; i++)
+		da0[i] = da1[i] = da2[i] = da3[i] = 1e10f;
+
+	for (int c = 0; c < 27; c++)
+	{
+		const float *cx = px[c], *cy = py[c], *cz = pz[c];
+		for (int i = 0; i < m; i++)
+		{
+			const float d = Distance::distance(x[i] - cx[i], y[i] - cy[i], z[i] - cz[i], me);
+			voronoiInsert(da0[i], da1[i], da2[i], da3[i], d);
+		}
+	}
+}
+
+void Noise::voronoi(float x, float y, float z, float* da, float* pa, float me, int dtype)
+{
+	switch (dtype) 
+    {
+		case VORONOI_DIST_SQUARED   : voronoiCells<VoronoiDistanceSquared>(*table, x, y, z, da, pa, me); break;
+		case VORONOI_DIST_MANHATTAN : voronoiCells<VoronoiDistanceManhattan>(*table, x, y, z, da, pa, me); break;
+		case VORONOI_DIST_CHEBYCHEV : voronoiCells<VoronoiDistanceChebychev>(*table, x, y, z, da, pa, me); break;
+		case VORONOI_DIST_MINKOVSKYH:	voronoiCells<VoronoiDistanceMinkovskyH>(*table, x, y, z, da, pa, me); break;
+		case VORONOI_DIST_MINKOVSKY4: voronoiCells<VoronoiDistanceMinkovsky4>(*table, x, y, z, da, pa, me); break;
+		case VORONOI_DIST_MINKOVSKY : voronoiCells<VoronoiDistanceMinkovsky>(*table, x, y, z, da, pa, me); break;
+		case VORONOI_DIST_REAL:
+        default: voronoiCells<VoronoiDistanceReal>(*table, x, y, z, da, pa, me);
+	}
+}
+
+
+/**************/
+// wrapper to retrieve different aspect of worley noise
+float Noise::voronoiF1U(float x, float y, float z)
+{
+	float da[4];
+	voronoiDistances<VoronoiDistanceReal>(*table, x, y, z, da, 1);
+	return da[0];
+}
+
+float Noise::voronoiF1S(float x, float y, float z)
+{
+    return unsignedToSignedNoiseValue(voronoiF1U(x,y,z));
+}
+
+/**************/
+
+float Noise::voronoiF2U(float x, float y, float z)
+{
+	float da[4];
+	voronoiDistances<VoronoiDistanceReal>(*table, x, y, z, da, 1);
+	return da[1];
+}
+
+float Noise::voronoiF2S(float x, float y, float z)
+{
+    return unsignedToSignedNoiseValue(voronoiF2U(x,y,z));
+}
+
+/**************/
+
+float Noise::voronoiF3U(float x, float y, float z)
+{
+	float da[4];
+	voronoiDistances<VoronoiDistanceReal>(*table, x, y, z, da, 1);
+	return da[2];
+}
+
+float Noise::voronoiF3S(float x, float y, float z)
+{
+    return unsignedToSignedNoiseValue(voronoiF3U(x,y,z));
+}
+
+/**************/
+float Noise::voronoiF4U(float x, float y, float z)
+{
+	float da[4];
+	voronoiDistances<VoronoiDistanceReal>(*table, x, y, z, da, 1);
+	return da[3];
+}
+
+float Noise::voronoiF4S(float x, float y, float z)
 {
     return unsignedToSignedNoiseValue(voronoiF4U(x,y,z));
 }
@@ -976,8 +1753,8 @@ float Noise::voronoiF4S(float x, float y, float z)
 /**************/
 float Noise::voronoiF1F2U(float x, float y, float z)
 {
-	float da[4], pa[12];
-	voronoi(x, y, z, da, pa, 1, VORONOI_DIST_REAL);
+	float da[4];
+	voronoiDistances<VoronoiDistanceReal>(*table, x, y, z, da, 1);
 	return (da[1]-da[0]);
 }
 
@@ -1000,7 +1777,6 @@ float Noise::voronoiCrackleS(float x, float y, float z)
     return unsignedToSignedNoiseValue(voronoiCrackleU(x,y,z));
 }
 
-
 //************************************************************************************************
 // cell noise
 float Noise::cellNoiseU(float x, float y, float z)
@@ -1008,7 +1784,7 @@ float Noise::cellNoiseU(float x, float y, float z)
   int xi = (int)(floor(x));
   int yi = (int)(floor(y));
   int zi = (int)(floor(z));
-  unsigned int n = xi + yi*1301 + zi*314159;
+  unsigned int n = (xi + yi*1301 + zi*314159) ^ cellSeed;
   n ^= (n<<13);
   return ((float)(n*(n*n*15731 + 789221) + 1376312589) / 4294967296.0);
 }
@@ -1047,58 +1823,320 @@ float Noise::blenderNoiseU(float x, float y, float z)
 	cn5= 1.0-3.0*cn5-2.0*cn5*jy;
 	cn6= 1.0-3.0*cn6-2.0*cn6*jz;
 
-	b00= hash[ hash[ix & 255]+(iy & 255)];
-	b10= hash[ hash[(ix+1) & 255]+(iy & 255)];
-	b01= hash[ hash[ix & 255]+((iy+1) & 255)];
-	b11= hash[ hash[(ix+1) & 255]+((iy+1) & 255)];
+	b00= table->hash[ table->hash[ix & 255]+(iy & 255)];
+	b10= table->hash[ table->hash[(ix+1) & 255]+(iy & 255)];
+	b01= table->hash[ table->hash[ix & 255]+((iy+1) & 255)];
+	b11= table->hash[ table->hash[(ix+1) & 255]+((iy+1) & 255)];
 
 	b20=iz & 255; b21= (iz+1) & 255;
 
 		/* 0 */
 	i= (cn1*cn2*cn3);
-		h=hashvectf+ 3*hash[b20+b00];
+		h=hashvectf+ 3*table->hash[b20+b00];
 		n+= i*(h[0]*ox+h[1]*oy+h[2]*oz);
 		/* 1 */
 	i= (cn1*cn2*cn6);
-		h=hashvectf+ 3*hash[b21+b00];
+		h=hashvectf+ 3*table->hash[b21+b00];
 		n+= i*(h[0]*ox+h[1]*oy+h[2]*jz);
 		/* 2 */
 	i= (cn1*cn5*cn3);
-		h=hashvectf+ 3*hash[b20+b01];
+		h=hashvectf+ 3*table->hash[b20+b01];
 		n+= i*(h[0]*ox+h[1]*jy+h[2]*oz);
 		/* 3 */
 	i= (cn1*cn5*cn6);
-		h=hashvectf+ 3*hash[b21+b01];
+		h=hashvectf+ 3*table->hash[b21+b01];
 		n+= i*(h[0]*ox+h[1]*jy+h[2]*jz);
 		/* 4 */
 	i= cn4*cn2*cn3;
-		h=hashvectf+ 3*hash[b20+b10];
+		h=hashvectf+ 3*table->hash[b20+b10];
 		n+= i*(h[0]*jx+h[1]*oy+h[2]*oz);
 		/* 5 */
 	i= cn4*cn2*cn6;
-		h=hashvectf+ 3*hash[b21+b10];
+		h=hashvectf+ 3*table->hash[b21+b10];
 		n+= i*(h[0]*jx+h[1]*oy+h[2]*jz);
 		/* 6 */
 	i= cn4*cn5*cn3;
-		h=hashvectf+ 3*hash[b20+b11];
+		h=hashvectf+ 3*table->hash[b20+b11];
 		n+=  i*(h[0]*jx+h[1]*jy+h[2]*oz);
 		/* 7 */
 	i= (cn4*cn5*cn6);
-		h=hashvectf+ 3*hash[b21+b11];
+		h=hashvectf+ 3*table->hash[b21+b11];
 		n+= i*(h[0]*jx+h[1]*jy+h[2]*jz);
 
 	if(n<0.0) n=0.0; else if(n>1.0) n=1.0;
 	return n;
 }
 
-
-float Noise::blenderNoiseS(float x, float y, float z)
+
+float Noise::blenderNoiseS(float x, float y, float z)
+{
+    return unsignedToSignedNoiseValue(blenderNoiseU(x,y,z));
+}            
+            
+
+
+
+
+//************************************************************************************************
+//************************************************************************************************
+// noise basis functors
+//
+// the generic noise, turbulence and fractal functions are templates over the noise basis, so the
+// basis (and for voronoi the distance metric) is known at compile time and inlined into their loops.
+// NOISE_DISPATCH switches once on the runtime basis and distance metric, declares the matching
+// functor under the given name and runs CALL with it. every functor evaluates single samples as
+// well as batches of n samples
+
+// improved perlin
+struct PerlinBasis
+{
+	PerlinBasis(Noise &n) : noise(n) {}
+
+	float operator()(float x, float y, float z) const { return noise.improvedPerlin3dS(x, y, z); }
+	void operator()(const float* x, const float* y, const float* z, float* out, size_t n) const { noise.improvedPerlin3dS(x, y, z, out, n); }
+
+	Noise &noise;
+};
+
+// cell noise
+struct CellBasis
+{
+	CellBasis(Noise &n) : noise(n) {}
+
+	float operator()(float x, float y, float z) const { return noise.cellNoiseS(x, y, z); }
+	void operator()(const float* x, const float* y, const float* z, float* out, size_t n) const
+	{
+		for (size_t i = 0; i < n; i++)
+			out[i] = noise.cellNoiseS(x[i], y[i], z[i]);
+	}
+
+	Noise &noise;
+};
+
+// blender noise
+struct BlenderBasis
+{
+	BlenderBasis(Noise &n) : noise(n) {}
+
+	float operator()(float x, float y, float z) const { return noise.blenderNoiseS(x, y, z); }
+	void operator()(const float* x, const float* y, const float* z, float* out, size_t n) const
+	{
+		for (size_t i = 0; i < n; i++)
+			out[i] = noise.blenderNoiseS(x[i], y[i], z[i]);
+	}
+
+	Noise &noise;
+};
+
+// voronoi, the noise basis picks the feature
+template <class Distance>
+struct VoronoiBasis
+{
+	VoronoiBasis(const NoiseTable &t, const int f, const float e) : table(t), feature(f), exponent(e) {}
+
+	float operator()(float x, float y, float z) const
+	{
+		float da[4], t;
+		voronoiDistances<Distance>(table, x, y, z, da, exponent);
+
+		switch (feature)
+		{
+			case NOISE_VORONOI_F2      : t = da[1]; break;
+			case NOISE_VORONOI_F3      : t = da[2]; break;
+			case NOISE_VORONOI_F4      : t = da[3]; break;
+			case NOISE_VORONOI_F2F1    : t = da[1] - da[0]; break;
+			case NOISE_VORONOI_CRACKLE :
+				t = 10 * (da[1] - da[0]);
+				if (t > 1.f) t = 1.f;
+				break;
+			case NOISE_VORONOI_F1      :
+			default                    : t = da[0];
+		}
+
+		return noiseToSigned(t);
+	}
+
+	// the feature is picked once per block
+	void operator()(const float* x, const float* y, const float* z, float* out, size_t n) const
+	{
+		float d[4][NOISE_BATCH_SIZE];
+
+		for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+		{
+			const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+			float *bo = out + start;
+
+			voronoiDistances<Distance>(table, x + start, y + start, z + start, d, m, exponent);
+
+			switch (feature)
+			{
+				case NOISE_VORONOI_F2      :
+				case NOISE_VORONOI_F3      :
+				case NOISE_VORONOI_F4      :
+				{
+					const float *df = d[feature - NOISE_VORONOI_F1];
+					for (int i = 0; i < m; i++)
+						bo[i] = noiseToSigned(df[i]);
+					break;
+				}
+				case NOISE_VORONOI_F2F1    :
+					for (int i = 0; i < m; i++)
+						bo[i] = noiseToSigned(d[1][i] - d[0][i]);
+					break;
+				case NOISE_VORONOI_CRACKLE :
+					for (int i = 0; i < m; i++)
+					{
+						float t = 10 * (d[1][i] - d[0][i]);
+						if (t > 1.f) t = 1.f;
+						bo[i] = noiseToSigned(t);
+					}
+					break;
+				case NOISE_VORONOI_F1      :
+				default                    :
+					for (int i = 0; i < m; i++)
+						bo[i] = noiseToSigned(d[0][i]);
+			}
+		}
+	}
+
+	const NoiseTable &table;
+	int feature;
+	float exponent;
+};
+
+#define NOISE_DISPATCH_VORONOI(basis, noiseBasis, distanceMetric, exponent, CALL) \
+	switch (distanceMetric) \
+	{ \
+		case VORONOI_DIST_SQUARED   : { VoronoiBasis<VoronoiDistanceSquared> basis(*table, noiseBasis, exponent); CALL; } break; \
+		case VORONOI_DIST_MANHATTAN : { VoronoiBasis<VoronoiDistanceManhattan> basis(*table, noiseBasis, exponent); CALL; } break; \
+		case VORONOI_DIST_CHEBYCHEV : { VoronoiBasis<VoronoiDistanceChebychev> basis(*table, noiseBasis, exponent); CALL; } break; \
+		case VORONOI_DIST_MINKOVSKYH: { VoronoiBasis<VoronoiDistanceMinkovskyH> basis(*table, noiseBasis, exponent); CALL; } break; \
+		case VORONOI_DIST_MINKOVSKY4: { VoronoiBasis<VoronoiDistanceMinkovsky4> basis(*table, noiseBasis, exponent); CALL; } break; \
+		case VORONOI_DIST_MINKOVSKY : { VoronoiBasis<VoronoiDistanceMinkovsky> basis(*table, noiseBasis, exponent); CALL; } break; \
+		case VORONOI_DIST_REAL      : \
+		default                     : { VoronoiBasis<VoronoiDistanceReal> basis(*table, noiseBasis, exponent); CALL; } \
+	}
+
+// only to be used in Noise members
+#define NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, CALL) \
+	switch (noiseBasis) \
+	{ \
+		case NOISE_VORONOI_F1       : \
+		case NOISE_VORONOI_F2       : \
+		case NOISE_VORONOI_F3       : \
+		case NOISE_VORONOI_F4       : \
+		case NOISE_VORONOI_F2F1     : \
+		case NOISE_VORONOI_CRACKLE  : \
+			NOISE_DISPATCH_VORONOI(basis, noiseBasis, distanceMetric, exponent, CALL) \
+			break; \
+		case NOISE_CELL             : { CellBasis basis(*this); CALL; } break; \
+		case NOISE_BLENDER          : { BlenderBasis basis(*this); CALL; } break; \
+		case NOISE_IMPROVED_PERLIN  : \
+		default                     : { PerlinBasis basis(*this); CALL; } \
+	}
+
+
+//*************************************************************************************************
+// generic noise function, call noise based on basis function
+float Noise::noise3dS(float x, float y, float z, int noiseBasis)
+{
+	float value = 0.f;
+	NOISE_DISPATCH(basis, noiseBasis, VORONOI_DIST_REAL, 1.f, value = basis(x, y, z));
+	return value;
+}
+
+/* General Vector noise */
+template <class Basis>
+static void vectorNoise( const Basis &noise, float x, float y, float z, float v[3] )
+{
+	/* Simply evaluate noise at 3 different positions */
+	v[0] = (float)( noise(x + 9.321f, y - 1.531f,  z - 7.951f));
+	v[1] = (float)( noise(x,          y,           z        ) );
+	v[2] = (float)( noise(x + 6.327f, y + 0.1671f, z - 2.672f));
+}
+
+void Noise::noiseVector( float x, float y, float z, int nb, float v[3] )
+{   
+	NOISE_DISPATCH(basis, nb, VORONOI_DIST_REAL, 1.f, vectorNoise(basis, x, y, z, v));
+}
+
+//************************************************************************************************
+// turbulence
+
+template <class Basis>
+static float turbulence(const Basis &noise, float x, float y, float z, int oct, bool hard)
+{
+    // todo: maybe make frequency scale and amp scale visible to the outside
+    
+	float sum, t, amp=1, fscale =1;
+	int i;
+	
+	sum = 0;
+	for (i=0;i<=oct;i++, amp*=0.5, fscale*=2) 
+    {
+		t = noise(fscale*x, fscale*y, fscale*z);
+		if (hard) t = fabs(2.0*t-1.0);
+		sum += t * amp;
+	}
+	
+	sum *= ((float)(1<<oct)/(float)((1<<(oct+1))-1));
+
+	return sum;
+
+}
+
+float Noise::turbulence3dS(float x, float y, float z, int oct, bool hard, int noiseBasis)
+{
+	float value = 0.f;
+	NOISE_DISPATCH(basis, noiseBasis, VORONOI_DIST_REAL, 1.f, value = turbulence(basis, x, y, z, oct, hard));
+	return value;
+}
+
+
+/* Turbulence Vector */
+
+template <class Basis>
+static void vectorTurbulence( const Basis &noise, float x, float y, float z, int oct, bool hard, float v[3] )
+{
+	float t[3];
+	int i;
+	float amp = 1.f;
+	float ampScale = 0.5f;    
+    float freqscale = 1.f;
+    
+	vectorNoise( noise, x, y, z, v );
+	if( hard ) 
+    {
+		v[0] = (float)fabs( v[0] );
+		v[1] = (float)fabs( v[1] );
+		v[2] = (float)fabs( v[2] );
+	}
+    
+	for( i = 1; i < oct; i++ ) 
+    {
+		amp *= ampScale;
+        freqscale *= 2;
+		x *= freqscale;
+		y *= freqscale;
+		z *= freqscale;
+		vectorNoise( noise, x, y, z, t );
+        
+		if( hard ) 
+        {
+			t[0] = (float)fabs( t[0] );
+			t[1] = (float)fabs( t[1] );
+			t[2] = (float)fabs( t[2] );
+		}
+		v[0] += amp * t[0];
+		v[1] += amp * t[1];
+		v[2] += amp * t[2];
+	}
+}
+
+void Noise::turbulenceVector( float x, float y, float z, int oct, bool hard, int noiseBasis, float v[3] )
 {
-    return unsignedToSignedNoiseValue(blenderNoiseU(x,y,z));
-}            
-            
-
-
+	NOISE_DISPATCH(basis, noiseBasis, VORONOI_DIST_REAL, 1.f, vectorTurbulence(basis, x, y, z, oct, hard, v));
+}
 
 
 //************************************************************************************************
@@ -1110,32 +2148,35 @@ float Noise::blenderNoiseS(float x, float y, float z)
  *    ``lacunarity''  is the gap between successive frequencies
  *    ``octaves''  is the number of frequencies in the fBm
  */
-float Noise::musgraveFBmS(float x, float y, float z, float H, float lacunarity, float octaves, int noiseBasis)
+template <class Basis>
+static float musgraveFBm(const Basis &noise, float x, float y, float z, float H, float lacunarity, float octaves)
 {
 	float	rmd, value=0.0, pwr=1.0, pwHL=pow(lacunarity, -H);
 	int	i;
 
-
-	float (Noise::*noisefunc)(float, float, float) ;
-    noisefunc = getNoiseFunctionPtrS(noiseBasis);
-    
-	
 	for (i=0; i<(int)octaves; i++) 
     {
-		value += (*this.*noisefunc)(x, y, z) * pwr;
+		value += noise(x, y, z) * pwr;
 		pwr *= pwHL;
 		x *= lacunarity;
 		y *= lacunarity;
 		z *= lacunarity;
 	}
 
-	rmd = octaves - floor(octaves);
-	if (rmd!=0.f) value += rmd * (*this.*noisefunc)(x, y, z) * pwr;
+	rmd = octaves - noiseFloor(octaves);
+	if (rmd!=0.f) value += rmd * noise(x, y, z) * pwr;
 
 	return value;
 
 } /* fBm() */
 
+float Noise::musgraveFBmS(float x, float y, float z, float H, float lacunarity, float octaves, int noiseBasis)
+{
+	float value = 0.f;
+	NOISE_DISPATCH(basis, noiseBasis, VORONOI_DIST_REAL, 1.f, value = musgraveFBm(basis, x, y, z, H, lacunarity, octaves));
+	return value;
+}
+
 
 /******************************************************/
 
@@ -1155,48 +2196,58 @@ float Noise::musgraveFBmS(float x, float y, float z, float H, float lacunarity,
  	* there seem to be errors in the original source code (in all three versions of proc.text&mod),
 	* I modified it to something that made sense to me, so it might be wrong... */
 
-float Noise::musgraveMultiFractalS(float x, float y, float z, float H, float lacunarity, float octaves, int noiseBasis)
+template <class Basis>
+static float musgraveMultiFractal(const Basis &noise, float x, float y, float z, float H, float lacunarity, float octaves)
 {
 	float	rmd, value=1.0, pwr=1.0, pwHL=pow(lacunarity, -H);
 	int i;
-	
-	float (Noise::*noisefunc)(float, float, float) ;
-    noisefunc = getNoiseFunctionPtrS(noiseBasis);
- 
+
 	for (i=0; i<(int)octaves; i++) {
-		value *= (pwr * (*this.*noisefunc)(x, y, z) + 1.0);
+		value *= (pwr * noise(x, y, z) + 1.0);
 		pwr *= pwHL;
 		x *= lacunarity;
 		y *= lacunarity;
 		z *= lacunarity;
 	}
-	rmd = octaves - floor(octaves);
-	if (rmd!=0.0) value *= (rmd * (*this.*noisefunc)(x, y, z) * pwr + 1.0);
+	rmd = octaves - noiseFloor(octaves);
+	if (rmd!=0.0) value *= (rmd * noise(x, y, z) * pwr + 1.0);
 
 	return value;
 
 } /* multifractal() */
 
+float Noise::musgraveMultiFractalS(float x, float y, float z, float H, float lacunarity, float octaves, int noiseBasis)
+{
+	float value = 0.f;
+	NOISE_DISPATCH(basis, noiseBasis, VORONOI_DIST_REAL, 1.f, value = musgraveMultiFractal(basis, x, y, z, H, lacunarity, octaves));
+	return value;
+}
+
 /******************************************************/
 
 /* "Variable Lacunarity Noise"
  * A distorted variety of Perlin noise.
  *
  * Copyright 1994 F. Kenton Musgrave*/
-float Noise::musgraveVLNoiseS(float x, float y, float z, float distortion, int noiseBasis1, int noiseBasis2)
+template <class Basis1, class Basis2>
+static float musgraveVLNoise(const Basis1 &noise1, const Basis2 &noise2, float x, float y, float z, float distortion)
 {
 	float rv[3];
-	float (Noise::*noisefunc1)(float, float, float);
-	float (Noise::*noisefunc2)(float, float, float);
     
-    noisefunc1 = getNoiseFunctionPtrS(noiseBasis1);
-    noisefunc2 = getNoiseFunctionPtrS(noiseBasis2);    
 
 	/* get a random vector and scale the randomization */
-	rv[0] = (*this.*noisefunc1)(x+13.5, y+13.5, z+13.5) * distortion;
-	rv[1] = (*this.*noisefunc1)(x, y, z) * distortion;
-	rv[2] = (*this.*noisefunc1)(x-13.5, y-13.5, z-13.5) * distortion;
-	return (*this.*noisefunc2)(x+rv[0], y+rv[1], z+rv[2]);	/* distorted-domain noise */
+	rv[0] = noise1(x+13.5, y+13.5, z+13.5) * distortion;
+	rv[1] = noise1(x, y, z) * distortion;
+	rv[2] = noise1(x-13.5, y-13.5, z-13.5) * distortion;
+	return noise2(x+rv[0], y+rv[1], z+rv[2]);	/* distorted-domain noise */
+}
+
+float Noise::musgraveVLNoiseS(float x, float y, float z, float distortion, int noiseBasis1, int noiseBasis2)
+{
+	float value = 0.f;
+	NOISE_DISPATCH(basis1, noiseBasis1, VORONOI_DIST_REAL, 1.f,
+		NOISE_DISPATCH(basis2, noiseBasis2, VORONOI_DIST_REAL, 1.f, value = musgraveVLNoise(basis1, basis2, x, y, z, distortion)));
+	return value;
 }
 
 /******************************************************/
@@ -1213,27 +2264,23 @@ float Noise::musgraveVLNoiseS(float x, float y, float z, float distortion, int n
  *       ``octaves''  is the number of frequencies in the fBm
  *       ``offset''  raises the terrain from `sea level'
  */
-float Noise::musgraveHeteroTerrainS(float x, float y, float z, float H, float lacunarity, float octaves, float offset, int noiseBasis)
+template <class Basis>
+static float musgraveHeteroTerrain(const Basis &noise, float x, float y, float z, float H, float lacunarity, float octaves, float offset)
 {
 	float	value, increment, rmd;
 	int i;
 	float pwHL = pow(lacunarity, -H);
 	float pwr = pwHL;	/* starts with i=1 instead of 0 */
 
-
-	float (Noise::*noisefunc)(float, float, float) ;
-    noisefunc = getNoiseFunctionPtrS(noiseBasis);
-
-    
 	/* first unscaled octave of function; later octaves are scaled */
-	value = offset + (*this.*noisefunc)(x, y, z);
+	value = offset + noise(x, y, z);
 	x *= lacunarity;
 	y *= lacunarity;
 	z *= lacunarity;
 
 	for (i=1; i<(int)octaves; i++) 
     {
-		increment = ((*this.*noisefunc)(x, y, z) + offset) * pwr * value;
+		increment = (noise(x, y, z) + offset) * pwr * value;
 		value += increment;
 		pwr *= pwHL;
 		x *= lacunarity;
@@ -1241,15 +2288,22 @@ float Noise::musgraveHeteroTerrainS(float x, float y, float z, float H, float la
 		z *= lacunarity;
 	}
 
-	rmd = octaves - floor(octaves);
+	rmd = octaves - noiseFloor(octaves);
 	if (rmd!=0.0) 
     {
-		increment = ((*this.*noisefunc)(x, y, z) + offset) * pwr * value;
+		increment = (noise(x, y, z) + offset) * pwr * value;
 		value += rmd * increment;
 	}
 	return value;
 }
 
+float Noise::musgraveHeteroTerrainS(float x, float y, float z, float H, float lacunarity, float octaves, float offset, int noiseBasis)
+{
+	float value = 0.f;
+	NOISE_DISPATCH(basis, noiseBasis, VORONOI_DIST_REAL, 1.f, value = musgraveHeteroTerrain(basis, x, y, z, H, lacunarity, octaves, offset));
+	return value;
+}
+
 
 /******************************************************/
 
@@ -1262,17 +2316,15 @@ float Noise::musgraveHeteroTerrainS(float x, float y, float z, float H, float la
  *      H:           0.25
  *      offset:      0.7
  */
-float Noise::musgraveHybridMultiFractalS(float x, float y, float z, float H, float lacunarity, float octaves, float offset, float gain, int noiseBasis)
+template <class Basis>
+static float musgraveHybridMultiFractal(const Basis &noise, float x, float y, float z, float H, float lacunarity, float octaves, float offset, float gain)
 {
 	float result, signal, weight, rmd;
 	int i;
 	float pwHL = pow(lacunarity, -H);
 	float pwr = pwHL;	/* starts with i=1 instead of 0 */
 
-    float (Noise::*noisefunc)(float, float, float) ;
-    noisefunc = getNoiseFunctionPtrS(noiseBasis);
-
-	result = (*this.*noisefunc)(x, y, z) + offset;
+	result = noise(x, y, z) + offset;
 	weight = gain * result;
 	x *= lacunarity;
 	y *= lacunarity;
@@ -1281,7 +2333,7 @@ float Noise::musgraveHybridMultiFractalS(float x, float y, float z, float H, flo
 	for (i=1; (weight>0.001) && (i<(int)octaves); i++) 
     {
 		if (weight>1.0)  weight=1.0;
-		signal = ((*this.*noisefunc)(x, y, z) + offset) * pwr;
+		signal = (noise(x, y, z) + offset) * pwr;
 		pwr *= pwHL;
 		result += weight * signal;
 		weight *= gain * signal;
@@ -1290,13 +2342,20 @@ float Noise::musgraveHybridMultiFractalS(float x, float y, float z, float H, flo
 		z *= lacunarity;
 	}
 
-	rmd = octaves - floor(octaves);
-	if (rmd!=0.f) result += rmd * (((*this.*noisefunc)(x, y, z) + offset) * pwr);
+	rmd = octaves - noiseFloor(octaves);
+	if (rmd!=0.f) result += rmd * ((noise(x, y, z) + offset) * pwr);
 
 	return result;
 
 } /* HybridMultifractal() */
 
+float Noise::musgraveHybridMultiFractalS(float x, float y, float z, float H, float lacunarity, float octaves, float offset, float gain, int noiseBasis)
+{
+	float value = 0.f;
+	NOISE_DISPATCH(basis, noiseBasis, VORONOI_DIST_REAL, 1.f, value = musgraveHybridMultiFractal(basis, x, y, z, H, lacunarity, octaves, offset, gain));
+	return value;
+}
+
 
 /******************************************************/
 
@@ -1310,17 +2369,15 @@ float Noise::musgraveHybridMultiFractalS(float x, float y, float z, float H, flo
  *      offset:      1.0
  *      gain:        2.0
  */
-float Noise::musgraveRidgedMultiFractalS(float x, float y, float z, float H, float lacunarity, float octaves, float offset, float gain, int noiseBasis)
+template <class Basis>
+static float musgraveRidgedMultiFractal(const Basis &noise, float x, float y, float z, float H, float lacunarity, float octaves, float offset, float gain)
 {
 	float result, signal, weight;
 	int	i;
 	float pwHL = pow(lacunarity, -H);
 	float pwr = pwHL;	/* starts with i=1 instead of 0 */
-	
-	float (Noise::*noisefunc)(float, float, float) ;
-    noisefunc = getNoiseFunctionPtrS(noiseBasis);
 
-	signal = offset - fabs((*this.*noisefunc)(x, y, z));
+	signal = offset - fabs(noise(x, y, z));
 	signal *= signal;
 	result = signal;
 	weight = 1.f;
@@ -1331,7 +2388,7 @@ float Noise::musgraveRidgedMultiFractalS(float x, float y, float z, float H, flo
 		z *= lacunarity;
 		weight = signal * gain;
 		if (weight>1.0) weight=1.0; else if (weight<0.0) weight=0.0;
-		signal = offset - fabs((*this.*noisefunc)(x, y, z));
+		signal = offset - fabs(noise(x, y, z));
 		signal *= signal;
 		signal *= weight;
 		result += signal * pwr;
@@ -1341,6 +2398,13 @@ float Noise::musgraveRidgedMultiFractalS(float x, float y, float z, float H, flo
 	return result;
 } /* RidgedMultifractal() */
 
+float Noise::musgraveRidgedMultiFractalS(float x, float y, float z, float H, float lacunarity, float octaves, float offset, float gain, int noiseBasis)
+{
+	float value = 0.f;
+	NOISE_DISPATCH(basis, noiseBasis, VORONOI_DIST_REAL, 1.f, value = musgraveRidgedMultiFractal(basis, x, y, z, H, lacunarity, octaves, offset, gain));
+	return value;
+}
+
 
 /******************************************************/
 // musgrave functions for unsigned values
@@ -1376,6 +2440,689 @@ float Noise::musgraveRidgedMultiFractalU(float x, float y, float z, float H, flo
 }
 
 
+//************************************************************************************************
+//************************************************************************************************
+//                                 BATCHED NOISE AND FRACTALS
+//************************************************************************************************
+//************************************************************************************************
+
+// the fractals work through blocks of samples with the octave loop on the outside: every octave
+// evaluates the basis for all samples of the block that still need it in one batched call, the
+// samples drop out of the lane list as they run out of octaves (or weight for the hybrid fractal).
+// per sample the arithmetic is the same as in the single sample functions above
+
+//************************************************************************************************
+void Noise::noise3dS(const float* x, const float* y, const float* z, float* out, size_t n, int noiseBasis, int distanceMetric, float exponent)
+{
+	NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, basis(x, y, z, out, n));
+}
+
+//************************************************************************************************
+// batched basis noise for the lanes of a fractal, lane lists the m samples to evaluate
+template <class Basis>
+static void basisLanes(const Basis &noise, const int* lane, int m, const float* x, const float* y, const float* z, float* out)
+{
+	float lx[NOISE_BATCH_SIZE], ly[NOISE_BATCH_SIZE], lz[NOISE_BATCH_SIZE];
+
+	for (int k = 0; k < m; k++)
+	{
+		lx[k] = x[lane[k]];
+		ly[k] = y[lane[k]];
+		lz[k] = z[lane[k]];
+	}
+
+	noise(lx, ly, lz, out, m);
+}
+
+//************************************************************************************************
+template <class Basis>
+static void musgraveFBm(const Basis &noise, const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves,
+						 float* out, size_t n)
+{
+	float px[NOISE_BATCH_SIZE], py[NOISE_BATCH_SIZE], pz[NOISE_BATCH_SIZE];
+	float pwr[NOISE_BATCH_SIZE], pwHL[NOISE_BATCH_SIZE], t[NOISE_BATCH_SIZE];
+	int lane[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *lac = lacunarity + start;
+		const float *oct = octaves + start;
+		float *value = out + start;
+
+		int active = 0;
+		for (int i = 0; i < m; i++)
+		{
+			px[i] = x[start + i];
+			py[i] = y[start + i];
+			pz[i] = z[start + i];
+			value[i] = 0.0;
+			pwr[i] = 1.0;
+			pwHL[i] = pow(lac[i], -H[start + i]);
+			if ((int)oct[i] > 0) lane[active++] = i;
+		}
+
+		for (int o = 0; active; o++)
+		{
+			basisLanes(noise, lane, active, px, py, pz, t);
+
+			int next = 0;
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				value[i] += t[k] * pwr[i];
+				pwr[i] *= pwHL[i];
+				px[i] *= lac[i];
+				py[i] *= lac[i];
+				pz[i] *= lac[i];
+				if (o + 1 < (int)oct[i]) lane[next++] = i;
+			}
+			active = next;
+		}
+
+		// fractional part of the octaves
+		active = 0;
+		for (int i = 0; i < m; i++)
+			if (oct[i] - noiseFloor(oct[i]) != 0.f) lane[active++] = i;
+
+		if (active)
+		{
+			basisLanes(noise, lane, active, px, py, pz, t);
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				const float rmd = oct[i] - noiseFloor(oct[i]);
+				value[i] += rmd * t[k] * pwr[i];
+			}
+		}
+	}
+}
+
+void Noise::musgraveFBmS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves,
+						 float* out, size_t n, int noiseBasis, int distanceMetric, float exponent)
+{
+	NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, musgraveFBm(basis, x, y, z, H, lacunarity, octaves, out, n));
+}
+
+//************************************************************************************************
+template <class Basis>
+static void musgraveMultiFractal(const Basis &noise, const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves,
+								  float* out, size_t n)
+{
+	float px[NOISE_BATCH_SIZE], py[NOISE_BATCH_SIZE], pz[NOISE_BATCH_SIZE];
+	float pwr[NOISE_BATCH_SIZE], pwHL[NOISE_BATCH_SIZE], t[NOISE_BATCH_SIZE];
+	int lane[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *lac = lacunarity + start;
+		const float *oct = octaves + start;
+		float *value = out + start;
+
+		int active = 0;
+		for (int i = 0; i < m; i++)
+		{
+			px[i] = x[start + i];
+			py[i] = y[start + i];
+			pz[i] = z[start + i];
+			value[i] = 1.0;
+			pwr[i] = 1.0;
+			pwHL[i] = pow(lac[i], -H[start + i]);
+			if ((int)oct[i] > 0) lane[active++] = i;
+		}
+
+		for (int o = 0; active; o++)
+		{
+			basisLanes(noise, lane, active, px, py, pz, t);
+
+			int next = 0;
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				value[i] *= (pwr[i] * t[k] + 1.0);
+				pwr[i] *= pwHL[i];
+				px[i] *= lac[i];
+				py[i] *= lac[i];
+				pz[i] *= lac[i];
+				if (o + 1 < (int)oct[i]) lane[next++] = i;
+			}
+			active = next;
+		}
+
+		// fractional part of the octaves
+		active = 0;
+		for (int i = 0; i < m; i++)
+			if (oct[i] - noiseFloor(oct[i]) != 0.0) lane[active++] = i;
+
+		if (active)
+		{
+			basisLanes(noise, lane, active, px, py, pz, t);
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				const float rmd = oct[i] - noiseFloor(oct[i]);
+				value[i] *= (rmd * t[k] * pwr[i] + 1.0);
+			}
+		}
+	}
+}
+
+void Noise::musgraveMultiFractalS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves,
+								  float* out, size_t n, int noiseBasis, int distanceMetric, float exponent)
+{
+	NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, musgraveMultiFractal(basis, x, y, z, H, lacunarity, octaves, out, n));
+}
+
+//************************************************************************************************
+// the distorted domain of a block of m samples, the variable lacunarity noise evaluates basis 2 on it
+template <class Basis>
+static void musgraveVLDomain(const Basis &noise, const float* x, const float* y, const float* z, const float* distortion,
+							 float* qx, float* qy, float* qz, int m)
+{
+	float rv[3][NOISE_BATCH_SIZE];
+
+	// random vector
+	for (int i = 0; i < m; i++)
+	{
+		qx[i] = x[i] + 13.5;
+		qy[i] = y[i] + 13.5;
+		qz[i] = z[i] + 13.5;
+	}
+	noise(qx, qy, qz, rv[0], m);
+	noise(x, y, z, rv[1], m);
+
+	for (int i = 0; i < m; i++)
+	{
+		qx[i] = x[i] - 13.5;
+		qy[i] = y[i] - 13.5;
+		qz[i] = z[i] - 13.5;
+	}
+	noise(qx, qy, qz, rv[2], m);
+
+	for (int i = 0; i < m; i++)
+	{
+		qx[i] = x[i] + rv[0][i] * distortion[i];
+		qy[i] = y[i] + rv[1][i] * distortion[i];
+		qz[i] = z[i] + rv[2][i] * distortion[i];
+	}
+}
+
+void Noise::musgraveVLNoiseS(const float* x, const float* y, const float* z, const float* distortion,
+							 float* out, size_t n, int noiseBasis1, int noiseBasis2, int distanceMetric, float exponent)
+{
+	float qx[NOISE_BATCH_SIZE], qy[NOISE_BATCH_SIZE], qz[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+
+		NOISE_DISPATCH(basis1, noiseBasis1, distanceMetric, exponent,
+			musgraveVLDomain(basis1, x + start, y + start, z + start, distortion + start, qx, qy, qz, m));
+
+		// distorted domain noise
+		NOISE_DISPATCH(basis2, noiseBasis2, distanceMetric, exponent, basis2(qx, qy, qz, out + start, m));
+	}
+}
+
+//************************************************************************************************
+template <class Basis>
+static void musgraveHeteroTerrain(const Basis &noise, const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset,
+								   float* out, size_t n)
+{
+	float px[NOISE_BATCH_SIZE], py[NOISE_BATCH_SIZE], pz[NOISE_BATCH_SIZE];
+	float pwr[NOISE_BATCH_SIZE], pwHL[NOISE_BATCH_SIZE], t[NOISE_BATCH_SIZE];
+	int lane[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *lac = lacunarity + start;
+		const float *oct = octaves + start;
+		const float *off = offset + start;
+		float *value = out + start;
+
+		// first unscaled octave for all samples
+		for (int i = 0; i < m; i++)
+		{
+			px[i] = x[start + i];
+			py[i] = y[start + i];
+			pz[i] = z[start + i];
+			pwHL[i] = pow(lac[i], -H[start + i]);
+			pwr[i] = pwHL[i];
+		}
+
+		noise(px, py, pz, t, m);
+
+		int active = 0;
+		for (int i = 0; i < m; i++)
+		{
+			value[i] = off[i] + t[i];
+			px[i] *= lac[i];
+			py[i] *= lac[i];
+			pz[i] *= lac[i];
+			if (1 < (int)oct[i]) lane[active++] = i;
+		}
+
+		for (int o = 1; active; o++)
+		{
+			basisLanes(noise, lane, active, px, py, pz, t);
+
+			int next = 0;
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				const float increment = (t[k] + off[i]) * pwr[i] * value[i];
+				value[i] += increment;
+				pwr[i] *= pwHL[i];
+				px[i] *= lac[i];
+				py[i] *= lac[i];
+				pz[i] *= lac[i];
+				if (o + 1 < (int)oct[i]) lane[next++] = i;
+			}
+			active = next;
+		}
+
+		// fractional part of the octaves
+		active = 0;
+		for (int i = 0; i < m; i++)
+			if (oct[i] - noiseFloor(oct[i]) != 0.0) lane[active++] = i;
+
+		if (active)
+		{
+			basisLanes(noise, lane, active, px, py, pz, t);
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				const float rmd = oct[i] - noiseFloor(oct[i]);
+				const float increment = (t[k] + off[i]) * pwr[i] * value[i];
+				value[i] += rmd * increment;
+			}
+		}
+	}
+}
+
+void Noise::musgraveHeteroTerrainS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset,
+								   float* out, size_t n, int noiseBasis, int distanceMetric, float exponent)
+{
+	NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, musgraveHeteroTerrain(basis, x, y, z, H, lacunarity, octaves, offset, out, n));
+}
+
+//************************************************************************************************
+template <class Basis>
+static void musgraveHybridMultiFractal(const Basis &noise, const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset, const float* gain,
+										float* out, size_t n)
+{
+	float px[NOISE_BATCH_SIZE], py[NOISE_BATCH_SIZE], pz[NOISE_BATCH_SIZE];
+	float pwr[NOISE_BATCH_SIZE], pwHL[NOISE_BATCH_SIZE], weight[NOISE_BATCH_SIZE], t[NOISE_BATCH_SIZE];
+	int lane[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *lac = lacunarity + start;
+		const float *oct = octaves + start;
+		const float *off = offset + start;
+		const float *g = gain + start;
+		float *result = out + start;
+
+		// first unscaled octave for all samples
+		for (int i = 0; i < m; i++)
+		{
+			px[i] = x[start + i];
+			py[i] = y[start + i];
+			pz[i] = z[start + i];
+			pwHL[i] = pow(lac[i], -H[start + i]);
+			pwr[i] = pwHL[i];
+		}
+
+		noise(px, py, pz, t, m);
+
+		int active = 0;
+		for (int i = 0; i < m; i++)
+		{
+			result[i] = t[i] + off[i];
+			weight[i] = g[i] * result[i];
+			px[i] *= lac[i];
+			py[i] *= lac[i];
+			pz[i] *= lac[i];
+			if ((weight[i] > 0.001) && (1 < (int)oct[i])) lane[active++] = i;
+		}
+
+		for (int o = 1; active; o++)
+		{
+			basisLanes(noise, lane, active, px, py, pz, t);
+
+			int next = 0;
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				if (weight[i] > 1.0) weight[i] = 1.0;
+				const float signal = (t[k] + off[i]) * pwr[i];
+				pwr[i] *= pwHL[i];
+				result[i] += weight[i] * signal;
+				weight[i] *= g[i] * signal;
+				px[i] *= lac[i];
+				py[i] *= lac[i];
+				pz[i] *= lac[i];
+				if ((weight[i] > 0.001) && (o + 1 < (int)oct[i])) lane[next++] = i;
+			}
+			active = next;
+		}
+
+		// fractional part of the octaves
+		active = 0;
+		for (int i = 0; i < m; i++)
+			if (oct[i] - noiseFloor(oct[i]) != 0.f) lane[active++] = i;
+
+		if (active)
+		{
+			basisLanes(noise, lane, active, px, py, pz, t);
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				const float rmd = oct[i] - noiseFloor(oct[i]);
+				result[i] += rmd * ((t[k] + off[i]) * pwr[i]);
+			}
+		}
+	}
+}
+
+void Noise::musgraveHybridMultiFractalS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset, const float* gain,
+										float* out, size_t n, int noiseBasis, int distanceMetric, float exponent)
+{
+	NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, musgraveHybridMultiFractal(basis, x, y, z, H, lacunarity, octaves, offset, gain, out, n));
+}
+
+//************************************************************************************************
+template <class Basis>
+static void musgraveRidgedMultiFractal(const Basis &noise, const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset, const float* gain,
+										float* out, size_t n)
+{
+	float px[NOISE_BATCH_SIZE], py[NOISE_BATCH_SIZE], pz[NOISE_BATCH_SIZE];
+	float pwr[NOISE_BATCH_SIZE], pwHL[NOISE_BATCH_SIZE], signal[NOISE_BATCH_SIZE], weight[NOISE_BATCH_SIZE], t[NOISE_BATCH_SIZE];
+	int lane[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+		const float *lac = lacunarity + start;
+		const float *oct = octaves + start;
+		const float *off = offset + start;
+		const float *g = gain + start;
+		float *result = out + start;
+
+		// first unscaled octave for all samples
+		for (int i = 0; i < m; i++)
+		{
+			px[i] = x[start + i];
+			py[i] = y[start + i];
+			pz[i] = z[start + i];
+			pwHL[i] = pow(lac[i], -H[start + i]);
+			pwr[i] = pwHL[i];
+		}
+
+		noise(px, py, pz, t, m);
+
+		int active = 0;
+		for (int i = 0; i < m; i++)
+		{
+			signal[i] = off[i] - fabs(t[i]);
+			signal[i] *= signal[i];
+			result[i] = signal[i];
+			if (1 < (int)oct[i]) lane[active++] = i;
+		}
+
+		for (int o = 1; active; o++)
+		{
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				px[i] *= lac[i];
+				py[i] *= lac[i];
+				pz[i] *= lac[i];
+				weight[i] = signal[i] * g[i];
+				if (weight[i] > 1.0) weight[i] = 1.0; else if (weight[i] < 0.0) weight[i] = 0.0;
+			}
+
+			basisLanes(noise, lane, active, px, py, pz, t);
+
+			int next = 0;
+			for (int k = 0; k < active; k++)
+			{
+				const int i = lane[k];
+				signal[i] = off[i] - fabs(t[k]);
+				signal[i] *= signal[i];
+				signal[i] *= weight[i];
+				result[i] += signal[i] * pwr[i];
+				pwr[i] *= pwHL[i];
+				if (o + 1 < (int)oct[i]) lane[next++] = i;
+			}
+			active = next;
+		}
+	}
+}
+
+void Noise::musgraveRidgedMultiFractalS(const float* x, const float* y, const float* z, const float* H, const float* lacunarity, const float* octaves, const float* offset, const float* gain,
+										float* out, size_t n, int noiseBasis, int distanceMetric, float exponent)
+{
+	NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, musgraveRidgedMultiFractal(basis, x, y, z, H, lacunarity, octaves, offset, gain, out, n));
+}
+
+//************************************************************************************************
+// batched turbulence
+//
+// the samples of a block are put in order of descending octave count, so the ones still needing
+// octave o are always the first ones of the block. every octave is then a single batched basis call
+// on the leading samples and the per octave arithmetic runs over contiguous arrays, a block with
+// mixed octave counts just gets shorter from octave to octave instead of falling back to one
+// sample at a time
+
+// stable order of the m samples of a block by descending octave count, a counting sort for the usual
+// small range of counts, an insertion sort otherwise
+static void orderByOctaves(const int* oct, int* order, const int m)
+{
+	int lo = oct[0], hi = oct[0];
+	for (int i = 1; i < m; i++)
+	{
+		lo = (oct[i] < lo) ? oct[i] : lo;
+		hi = (oct[i] > hi) ? oct[i] : hi;
+	}
+
+	// the differences are taken unsigned, in int they overflow for counts of opposite sign far apart
+	const unsigned int range = (unsigned int)hi - (unsigned int)lo;
+	if (range < NOISE_BATCH_SIZE)
+	{
+		int first[NOISE_BATCH_SIZE + 1];
+		for (unsigned int c = 0; c <= range + 1; c++)
+			first[c] = 0;
+		for (int i = 0; i < m; i++)
+			first[(unsigned int)hi - (unsigned int)oct[i] + 1]++;
+		for (unsigned int c = 1; c <= range; c++)
+			first[c] += first[c-1];
+		for (int i = 0; i < m; i++)
+			order[first[(unsigned int)hi - (unsigned int)oct[i]]++] = i;
+		return;
+	}
+
+	for (int i = 0; i < m; i++)
+	{
+		int j = i;
+		while ((j > 0) && (oct[order[j-1]] < oct[i]))
+		{
+			order[j] = order[j-1];
+			j--;
+		}
+		order[j] = i;
+	}
+}
+
+// the result is divided by the sum of the octave amplitudes, with the default lacunarity of 2 and
+// gain of 0.5 this is the same factor as in turbulence and the results match the single sample calls
+template <class Basis>
+static void turbulence(const Basis &noise, const float* x, const float* y, const float* z, const float* octaves,
+					   const float* lacunarity, const float* gain, float* out, size_t n, bool hard)
+{
+	float sx[NOISE_BATCH_SIZE], sy[NOISE_BATCH_SIZE], sz[NOISE_BATCH_SIZE], lac[NOISE_BATCH_SIZE], g[NOISE_BATCH_SIZE];
+	float px[NOISE_BATCH_SIZE], py[NOISE_BATCH_SIZE], pz[NOISE_BATCH_SIZE], t[NOISE_BATCH_SIZE];
+	float sum[NOISE_BATCH_SIZE], amp[NOISE_BATCH_SIZE], fscale[NOISE_BATCH_SIZE], norm[NOISE_BATCH_SIZE];
+	int oct[NOISE_BATCH_SIZE], soct[NOISE_BATCH_SIZE], order[NOISE_BATCH_SIZE];
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+
+		for (int i = 0; i < m; i++)
+			oct[i] = (int)octaves[start + i];
+		orderByOctaves(oct, order, m);
+
+		for (int k = 0; k < m; k++)
+		{
+			const size_t i = start + order[k];
+			sx[k] = x[i];
+			sy[k] = y[i];
+			sz[k] = z[i];
+			lac[k] = lacunarity[i];
+			g[k] = gain[i];
+			soct[k] = oct[order[k]];
+			sum[k] = 0.f;
+			amp[k] = 1.f;
+			fscale[k] = 1.f;
+			norm[k] = 0.f;
+		}
+
+		// octaves 0 to oct, none for a negative count
+		int active = m;
+		while (active && (soct[active-1] < 0))
+			active--;
+
+		for (int o = 0; active; o++)
+		{
+			for (int k = 0; k < active; k++)
+			{
+				px[k] = fscale[k] * sx[k];
+				py[k] = fscale[k] * sy[k];
+				pz[k] = fscale[k] * sz[k];
+			}
+
+			noise(px, py, pz, t, active);
+
+			if (hard)
+				for (int k = 0; k < active; k++)
+					t[k] = fabs(2.0*t[k]-1.0);
+
+			for (int k = 0; k < active; k++)
+			{
+				sum[k] += t[k] * amp[k];
+				norm[k] += amp[k];
+				amp[k] *= g[k];
+				fscale[k] *= lac[k];
+			}
+
+			while (active && (soct[active-1] <= o))
+				active--;
+		}
+
+		for (int k = 0; k < m; k++)
+			out[start + order[k]] = (norm[k] != 0.f) ? sum[k] * (1.f / norm[k]) : sum[k];
+	}
+}
+
+void Noise::turbulence3dS(const float* x, const float* y, const float* z, const float* octaves, const float* lacunarity, const float* gain,
+						  float* out, size_t n, bool hard, int noiseBasis, int distanceMetric, float exponent)
+{
+	NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, turbulence(basis, x, y, z, octaves, lacunarity, gain, out, n, hard));
+}
+
+// the same for the turbulence vector: the first octave is always there, the sample position is
+// scaled by the running frequency scale after every octave and the vector noise of an octave is
+// three batched basis calls at the offset positions of vectorNoise
+template <class Basis>
+static void vectorTurbulence(const Basis &noise, const float* x, const float* y, const float* z, const float* octaves,
+							 const float* lacunarity, const float* gain, float* vx, float* vy, float* vz, size_t n, bool hard)
+{
+	static const float offset[3][3] = { { 9.321f, -1.531f, -7.951f }, { 0.0f, 0.0f, 0.0f }, { 6.327f, 0.1671f, -2.672f } };
+
+	float px[NOISE_BATCH_SIZE], py[NOISE_BATCH_SIZE], pz[NOISE_BATCH_SIZE], lac[NOISE_BATCH_SIZE], g[NOISE_BATCH_SIZE];
+	float qx[NOISE_BATCH_SIZE], qy[NOISE_BATCH_SIZE], qz[NOISE_BATCH_SIZE], t[NOISE_BATCH_SIZE];
+	float v[3][NOISE_BATCH_SIZE], amp[NOISE_BATCH_SIZE], freqscale[NOISE_BATCH_SIZE];
+	int oct[NOISE_BATCH_SIZE], soct[NOISE_BATCH_SIZE], order[NOISE_BATCH_SIZE];
+	float *out[3] = { vx, vy, vz };
+
+	for (size_t start = 0; start < n; start += NOISE_BATCH_SIZE)
+	{
+		const int m = (n - start < NOISE_BATCH_SIZE) ? int(n - start) : NOISE_BATCH_SIZE;
+
+		for (int i = 0; i < m; i++)
+			oct[i] = (int)octaves[start + i];
+		orderByOctaves(oct, order, m);
+
+		for (int k = 0; k < m; k++)
+		{
+			const size_t i = start + order[k];
+			px[k] = x[i];
+			py[k] = y[i];
+			pz[k] = z[i];
+			lac[k] = lacunarity[i];
+			g[k] = gain[i];
+			soct[k] = oct[order[k]];
+			amp[k] = 1.f;
+			freqscale[k] = 1.f;
+			v[0][k] = v[1][k] = v[2][k] = 0.f;
+		}
+
+		int active = m;
+		for (int o = 0; active; o++)
+		{
+			if (o > 0)
+			{
+				for (int k = 0; k < active; k++)
+				{
+					amp[k] *= g[k];
+					freqscale[k] *= lac[k];
+					px[k] *= freqscale[k];
+					py[k] *= freqscale[k];
+					pz[k] *= freqscale[k];
+				}
+			}
+
+			for (int c = 0; c < 3; c++)
+			{
+				for (int k = 0; k < active; k++)
+				{
+					qx[k] = px[k] + offset[c][0];
+					qy[k] = py[k] + offset[c][1];
+					qz[k] = pz[k] + offset[c][2];
+				}
+
+				noise(qx, qy, qz, t, active);
+
+				if (hard)
+					for (int k = 0; k < active; k++)
+						t[k] = (float)fabs(t[k]);
+
+				float *vc = v[c];
+				for (int k = 0; k < active; k++)
+					vc[k] += amp[k] * t[k];
+			}
+
+			while (active && (soct[active-1] <= o + 1))
+				active--;
+		}
+
+		for (int c = 0; c < 3; c++)
+			for (int k = 0; k < m; k++)
+				out[c][start + order[k]] = v[c][k];
+	}
+}
+
+void Noise::turbulenceVector(const float* x, const float* y, const float* z, const float* octaves, const float* lacunarity, const float* gain,
+							 float* vx, float* vy, float* vz, size_t n, bool hard, int noiseBasis, int distanceMetric, float exponent)
+{
+	NOISE_DISPATCH(basis, noiseBasis, distanceMetric, exponent, vectorTurbulence(basis, x, y, z, octaves, lacunarity, gain, vx, vy, vz, n, hard));
+}
+
+
 //*******************************************************************************************
 // helper functions
 
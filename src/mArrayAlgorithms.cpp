@@ -0,0 +1,977 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "../include/mArrayAlgorithms.h"
+#include "../include/mThreadPool.h"
+
+namespace melfunctions
+{
+
+//************************************************************************************************
+//************************************************************************************************
+//                                       SUMS
+//************************************************************************************************
+//************************************************************************************************
+
+// elements summed straight up before the pairwise recursion kicks in
+#define PAIRWISE_BLOCK 64
+
+
+// pairwise summation, error grows with log(n) instead of n
+// the single component case keeps 4 independent accumulators so the compiler can vectorize it
+static void pairwiseSum(const double *d, const unsigned int n, const unsigned int e, double *s)
+{
+	if (n <= PAIRWISE_BLOCK)
+	{
+		if (e == 1)
+		{
+			double a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0;
+			unsigned int i = 0;
+			for (; i + 4 <= n; i += 4)
+			{
+				a0 += d[i];
+				a1 += d[i+1];
+				a2 += d[i+2];
+				a3 += d[i+3];
+			}
+			for (; i < n; i++)
+				a0 += d[i];
+
+			s[0] = (a0 + a1) + (a2 + a3);
+		}
+		else
+		{
+			for (unsigned int c = 0; c < e; c++)
+				s[c] = 0.0;
+			for (unsigned int i = 0; i < n; i++, d += e)
+				for (unsigned int c = 0; c < e; c++)
+					s[c] += d[c];
+		}
+		return;
+	}
+
+	double l[REDUCE_MAX_ELEMENTS], r[REDUCE_MAX_ELEMENTS];
+	unsigned int h = n / 2;
+	pairwiseSum(d, h, e, l);
+	pairwiseSum(d + h * e, n - h, e, r);
+
+	for (unsigned int c = 0; c < e; c++)
+		s[c] = l[c] + r[c];
+}
+
+// Kahan-Babuska (Neumaier) compensated summation
+// the volatile temporary keeps --fast-math from optimizing the compensation away
+static void compensatedSum(const double *d, const unsigned int n, const unsigned int e, double *s)
+{
+	for (unsigned int c = 0; c < e; c++)
+	{
+		double sum = 0.0, comp = 0.0;
+		for (unsigned int i = 0; i < n; i++)
+		{
+			double x = d[i * e + c];
+			volatile double t = sum + x;
+
+			if (fabs(sum) >= fabs(x))
+				comp += (sum - t) + x;
+			else
+				comp += (x - t) + sum;
+
+			sum = t;
+		}
+		s[c] = sum + comp;
+	}
+}
+
+
+// one partial sum per chunk
+struct mSumKernel
+{
+	const double *data;
+	const double *weights;
+	unsigned int weightStride;
+	unsigned int count, elements, grain;
+	bool compensated;
+
+	// elements+1 values per chunk, the last one is the weight sum
+	double *partial;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		std::vector<double> weighted, gathered;
+		double w;
+
+		for (unsigned int b = begin; b < end; b += grain)
+		{
+			unsigned int n = (b + grain < end) ? grain : end - b;
+			double *p = partial + (b / grain) * (elements + 1);
+			const double *d = data + b * elements;
+
+			if (weights)
+			{
+				weighted.resize(n * elements);
+				const double *wt = weights + b * weightStride;
+				for (unsigned int i = 0; i < n; i++)
+					for (unsigned int c = 0; c < elements; c++)
+						weighted[i * elements + c] = wt[i * weightStride] * d[i * elements + c];
+
+				d = &weighted[0];
+
+				if (weightStride)
+				{
+					// only every weightStride-th value is a weight, gather them so the sums see one component
+					if (weightStride > 1)
+					{
+						gathered.resize(n);
+						for (unsigned int i = 0; i < n; i++)
+							gathered[i] = wt[i * weightStride];
+						wt = &gathered[0];
+					}
+
+					if (compensated)
+						compensatedSum(wt, n, 1, &w);
+					else
+						pairwiseSum(wt, n, 1, &w);
+				}
+				else
+					w = n * wt[0];
+
+				p[elements] = w;
+			}
+
+			if (compensated)
+				compensatedSum(d, n, elements, p);
+			else
+				pairwiseSum(d, n, elements, p);
+		}
+	}
+};
+
+static void runSum(mSumKernel &kernel, double *sum, double *weightSum)
+{
+	unsigned int stride = kernel.elements + 1;
+	unsigned int chunks = parallelChunkCount(kernel.count, kernel.grain);
+	std::vector<double> partial(chunks * stride, 0.0);
+
+	kernel.partial = &partial[0];
+	parallelFor(kernel.count, kernel.grain, kernel);
+
+	// combine the chunks in order
+	double s[REDUCE_MAX_ELEMENTS + 1];
+	if (kernel.compensated)
+		compensatedSum(&partial[0], chunks, stride, s);
+	else
+		pairwiseSum(&partial[0], chunks, stride, s);
+
+	for (unsigned int c = 0; c < kernel.elements; c++)
+		sum[c] = s[c];
+	if (weightSum)
+		*weightSum = s[kernel.elements];
+}
+
+void reduceSum(const double *data, const unsigned int count, const unsigned int elements, const bool compensated, double *sum)
+{
+	for (unsigned int c = 0; c < elements; c++)
+		sum[c] = 0.0;
+	if (count == 0)
+		return;
+
+	mSumKernel kernel;
+	kernel.data = data;
+	kernel.weights = 0;
+	kernel.weightStride = 0;
+	kernel.count = count;
+	kernel.elements = elements;
+	kernel.grain = PARALLEL_GRAIN_LIGHT / elements;
+	kernel.compensated = compensated;
+
+	runSum(kernel, sum, 0);
+}
+
+void reduceWeightedSum(const double *data, const unsigned int count, const unsigned int elements,
+					   const double *weights, const unsigned int weightStride, const bool compensated,
+					   double *sum, double &weightSum)
+{
+	for (unsigned int c = 0; c < elements; c++)
+		sum[c] = 0.0;
+	weightSum = 0.0;
+	if (count == 0)
+		return;
+
+	mSumKernel kernel;
+	kernel.data = data;
+	kernel.weights = weights;
+	kernel.weightStride = weightStride;
+	kernel.count = count;
+	kernel.elements = elements;
+	kernel.grain = PARALLEL_GRAIN_LIGHT / elements;
+	kernel.compensated = compensated;
+
+	runSum(kernel, sum, &weightSum);
+}
+
+
+//************************************************************************************************
+//************************************************************************************************
+//                                       MIN / MAX
+//************************************************************************************************
+//************************************************************************************************
+
+struct mMinMaxKernel
+{
+	const double *data;
+	unsigned int elements, grain;
+
+	// 2*elements values per chunk, min then max
+	double *partial;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b += grain)
+		{
+			unsigned int n = (b + grain < end) ? grain : end - b;
+			double *mn = partial + (b / grain) * 2 * elements;
+			double *mx = mn + elements;
+			const double *d = data + b * elements;
+
+			for (unsigned int c = 0; c < elements; c++)
+				mn[c] = mx[c] = d[c];
+
+			for (unsigned int i = 1; i < n; i++)
+			{
+				d += elements;
+				for (unsigned int c = 0; c < elements; c++)
+				{
+					mn[c] = (d[c] < mn[c]) ? d[c] : mn[c];
+					mx[c] = (d[c] > mx[c]) ? d[c] : mx[c];
+				}
+			}
+		}
+	}
+};
+
+void reduceMinMax(const double *data, const unsigned int count, const unsigned int elements, double *min, double *max)
+{
+	mMinMaxKernel kernel;
+	kernel.data = data;
+	kernel.elements = elements;
+	kernel.grain = PARALLEL_GRAIN_LIGHT / elements;
+
+	unsigned int chunks = parallelChunkCount(count, kernel.grain);
+	std::vector<double> partial(chunks * 2 * elements);
+	kernel.partial = &partial[0];
+	parallelFor(count, kernel.grain, kernel);
+
+	for (unsigned int c = 0; c < elements; c++)
+	{
+		min[c] = partial[c];
+		max[c] = partial[elements + c];
+	}
+
+	for (unsigned int k = 1; k < chunks; k++)
+	{
+		const double *mn = &partial[k * 2 * elements];
+		const double *mx = mn + elements;
+		for (unsigned int c = 0; c < elements; c++)
+		{
+			if (mn[c] < min[c]) min[c] = mn[c];
+			if (mx[c] > max[c]) max[c] = mx[c];
+		}
+	}
+}
+
+
+//************************************************************************************************
+//************************************************************************************************
+//                                       VARIANCE
+//************************************************************************************************
+//************************************************************************************************
+
+// exact two pass mean and sum of squared deviations per chunk (the chunk is still in cache for the
+// second pass), chunks are merged with Chan's parallel update
+struct mVarianceKernel
+{
+	const double *data;
+	unsigned int grain;
+
+	// mean and squared deviation sum per chunk
+	double *partial;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b += grain)
+		{
+			unsigned int n = (b + grain < end) ? grain : end - b;
+			const double *d = data + b;
+			double *p = partial + (b / grain) * 2;
+
+			double mean;
+			pairwiseSum(d, n, 1, &mean);
+			mean /= n;
+
+			double s0 = 0.0, s1 = 0.0;
+			unsigned int i = 0;
+			for (; i + 2 <= n; i += 2)
+			{
+				double x0 = d[i] - mean;
+				double x1 = d[i+1] - mean;
+				s0 += x0 * x0;
+				s1 += x1 * x1;
+			}
+			for (; i < n; i++)
+				s0 += (d[i] - mean) * (d[i] - mean);
+
+			p[0] = mean;
+			p[1] = s0 + s1;
+		}
+	}
+};
+
+void reduceMeanVariance(const double *data, const unsigned int count, double &mean, double &variance)
+{
+	mVarianceKernel kernel;
+	kernel.data = data;
+	kernel.grain = PARALLEL_GRAIN_LIGHT;
+
+	unsigned int chunks = parallelChunkCount(count, kernel.grain);
+	std::vector<double> partial(chunks * 2);
+	kernel.partial = &partial[0];
+	parallelFor(count, kernel.grain, kernel);
+
+	double n = 0.0, m = 0.0, m2 = 0.0;
+	for (unsigned int k = 0; k < chunks; k++)
+	{
+		double nb = (k + 1 < chunks) ? kernel.grain : count - k * kernel.grain;
+		double delta = partial[k * 2] - m;
+		double nt = n + nb;
+
+		m += delta * nb / nt;
+		m2 += partial[k * 2 + 1] + delta * delta * n * nb / nt;
+		n = nt;
+	}
+
+	mean = m;
+	variance = m2 / count;
+}
+
+
+//************************************************************************************************
+//************************************************************************************************
+//                                       RADIX SORT
+//************************************************************************************************
+//************************************************************************************************
+
+// least significant digit radix sort on the bit patterns of the doubles, 11 bit digits (6 passes)
+// every pass builds one histogram per chunk, the chunk offsets are laid out digit by digit and chunk by
+// chunk, so scattering the chunks in parallel keeps equal keys in their original order (stable)
+
+typedef unsigned long long mSortKey;
+
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES ((64 + RADIX_BITS - 1) / RADIX_BITS)
+// elements per chunk, bigger than usual to keep the per chunk histograms small in comparison
+#define RADIX_GRAIN 16384
+// below this a comparison sort is quicker than touching the histograms
+#define RADIX_MIN_COUNT 512
+
+static const mSortKey SIGN_BIT = 0x8000000000000000ULL;
+
+// map the double bit pattern to an unsigned int with the same ordering
+// positive values get the sign bit set, negative values get all bits flipped
+inline mSortKey doubleToKey(const double d)
+{
+	mSortKey k;
+	memcpy(&k, &d, sizeof(k));
+	return (k & SIGN_BIT) ? ~k : (k | SIGN_BIT);
+}
+
+inline double keyToDouble(mSortKey k)
+{
+	k = (k & SIGN_BIT) ? (k & ~SIGN_BIT) : ~k;
+	double d;
+	memcpy(&d, &k, sizeof(d));
+	return d;
+}
+
+struct mSortKeyKernel
+{
+	const double *data;
+	mSortKey *keys;
+	unsigned int *index;
+	bool descending;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			keys[i] = descending ? ~doubleToKey(data[i]) : doubleToKey(data[i]);
+			if (index)
+				index[i] = i;
+		}
+	}
+};
+
+struct mRadixHistogramKernel
+{
+	const mSortKey *keys;
+	unsigned int shift;
+	unsigned int *histogram;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b += RADIX_GRAIN)
+		{
+			unsigned int e = (b + RADIX_GRAIN < end) ? b + RADIX_GRAIN : end;
+			unsigned int *h = histogram + (b / RADIX_GRAIN) * RADIX_SIZE;
+
+			memset(h, 0, RADIX_SIZE * sizeof(unsigned int));
+			for (unsigned int i = b; i < e; i++)
+				h[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+		}
+	}
+};
+
+struct mRadixScatterKernel
+{
+	const mSortKey *keys;
+	const unsigned int *index;
+	mSortKey *keysOut;
+	unsigned int *indexOut;
+	unsigned int shift;
+	// per chunk write positions, advanced while scattering
+	unsigned int *offsets;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b += RADIX_GRAIN)
+		{
+			unsigned int e = (b + RADIX_GRAIN < end) ? b + RADIX_GRAIN : end;
+			unsigned int *o = offsets + (b / RADIX_GRAIN) * RADIX_SIZE;
+
+			if (index)
+			{
+				for (unsigned int i = b; i < e; i++)
+				{
+					unsigned int pos = o[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+					keysOut[pos] = keys[i];
+					indexOut[pos] = index[i];
+				}
+			}
+			else
+			{
+				for (unsigned int i = b; i < e; i++)
+					keysOut[o[(keys[i] >> shift) & (RADIX_SIZE - 1)]++] = keys[i];
+			}
+		}
+	}
+};
+
+struct mSortKeyIndexLess
+{
+	const mSortKey *keys;
+	bool operator()(const unsigned int a, const unsigned int b) const { return keys[a] < keys[b]; }
+};
+
+void radixSortDoubles(const double *data, const unsigned int count, const bool descending, double *sorted, unsigned int *order)
+{
+	if (count == 0)
+		return;
+
+	// carry the original indices along if they are asked for
+	bool withIndex = (order != 0);
+
+	std::vector<mSortKey> keys(count), keysTmp;
+	std::vector<unsigned int> index, indexTmp;
+	if (withIndex || (count < RADIX_MIN_COUNT))
+		index.resize(count);
+
+	mSortKeyKernel keyKernel;
+	keyKernel.data = data;
+	keyKernel.keys = &keys[0];
+	keyKernel.index = index.size() ? &index[0] : 0;
+	keyKernel.descending = descending;
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, keyKernel);
+
+	if (count < RADIX_MIN_COUNT)
+	{
+		// small array, sort the indices by key
+		mSortKeyIndexLess less;
+		less.keys = &keys[0];
+		std::stable_sort(index.begin(), index.end(), less);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (sorted)
+				sorted[i] = data[index[i]];
+			if (order)
+				order[i] = index[i];
+		}
+		return;
+	}
+
+	keysTmp.resize(count);
+	if (withIndex)
+		indexTmp.resize(count);
+
+	unsigned int chunks = parallelChunkCount(count, RADIX_GRAIN);
+	std::vector<unsigned int> histogram(chunks * RADIX_SIZE);
+
+	mSortKey *src = &keys[0], *dst = &keysTmp[0];
+	unsigned int *srcIndex = withIndex ? &index[0] : 0;
+	unsigned int *dstIndex = withIndex ? &indexTmp[0] : 0;
+
+	for (unsigned int pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		unsigned int shift = pass * RADIX_BITS;
+
+		mRadixHistogramKernel histogramKernel;
+		histogramKernel.keys = src;
+		histogramKernel.shift = shift;
+		histogramKernel.histogram = &histogram[0];
+		parallelFor(count, RADIX_GRAIN, histogramKernel);
+
+		// turn the counts into write offsets: digit major, chunk minor
+		// if every key has the same digit the pass wouldn't change anything
+		bool trivial = false;
+		unsigned int sum = 0;
+		for (unsigned int d = 0; d < RADIX_SIZE; d++)
+		{
+			unsigned int digitStart = sum;
+			for (unsigned int c = 0; c < chunks; c++)
+			{
+				unsigned int n = histogram[c * RADIX_SIZE + d];
+				histogram[c * RADIX_SIZE + d] = sum;
+				sum += n;
+			}
+			if (sum - digitStart == count)
+				trivial = true;
+		}
+		if (trivial)
+			continue;
+
+		mRadixScatterKernel scatterKernel;
+		scatterKernel.keys = src;
+		scatterKernel.index = srcIndex;
+		scatterKernel.keysOut = dst;
+		scatterKernel.indexOut = dstIndex;
+		scatterKernel.shift = shift;
+		scatterKernel.offsets = &histogram[0];
+		parallelFor(count, RADIX_GRAIN, scatterKernel);
+
+		std::swap(src, dst);
+		std::swap(srcIndex, dstIndex);
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (sorted)
+			sorted[i] = keyToDouble(descending ? ~src[i] : src[i]);
+		if (order)
+			order[i] = srcIndex[i];
+	}
+}
+
+
+//************************************************************************************************
+//************************************************************************************************
+//                                       SCAN / COMPACTION
+//************************************************************************************************
+//************************************************************************************************
+
+// both are two pass algorithms: the first pass reduces every chunk to a single value (sum, number of
+// kept elements), a short serial scan over those gives each chunk its starting value and the second
+// pass runs the chunks independently from there
+
+struct mChunkSumKernel
+{
+	const double *data;
+	double *partial;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b += PARALLEL_GRAIN_LIGHT)
+		{
+			unsigned int n = (b + PARALLEL_GRAIN_LIGHT < end) ? PARALLEL_GRAIN_LIGHT : end - b;
+			pairwiseSum(data + b, n, 1, &partial[b / PARALLEL_GRAIN_LIGHT]);
+		}
+	}
+};
+
+struct mScanKernel
+{
+	const double *data;
+	const double *offsets;
+	double *out;
+	bool inclusive;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b += PARALLEL_GRAIN_LIGHT)
+		{
+			unsigned int e = (b + PARALLEL_GRAIN_LIGHT < end) ? b + PARALLEL_GRAIN_LIGHT : end;
+			double sum = offsets[b / PARALLEL_GRAIN_LIGHT];
+
+			if (inclusive)
+			{
+				for (unsigned int i = b; i < e; i++)
+				{
+					sum += data[i];
+					out[i] = sum;
+				}
+			}
+			else
+			{
+				for (unsigned int i = b; i < e; i++)
+				{
+					double x = data[i];
+					out[i] = sum;
+					sum += x;
+				}
+			}
+		}
+	}
+};
+
+void scanSum(const double *data, const unsigned int count, const bool inclusive, double *out)
+{
+	if (count == 0)
+		return;
+
+	unsigned int chunks = parallelChunkCount(count, PARALLEL_GRAIN_LIGHT);
+	std::vector<double> offsets(chunks);
+
+	if (chunks > 1)
+	{
+		mChunkSumKernel sumKernel;
+		sumKernel.data = data;
+		sumKernel.partial = &offsets[0];
+		parallelFor(count, PARALLEL_GRAIN_LIGHT, sumKernel);
+	}
+
+	// exclusive scan of the chunk sums
+	double sum = 0.0;
+	for (unsigned int c = 0; c < chunks; c++)
+	{
+		double x = offsets[c];
+		offsets[c] = sum;
+		sum += x;
+	}
+
+	mScanKernel scanKernel;
+	scanKernel.data = data;
+	scanKernel.offsets = &offsets[0];
+	scanKernel.out = out;
+	scanKernel.inclusive = inclusive;
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, scanKernel);
+}
+
+
+struct mMaskCountKernel
+{
+	const double *mask;
+	unsigned int *partial;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b += PARALLEL_GRAIN_LIGHT)
+		{
+			unsigned int e = (b + PARALLEL_GRAIN_LIGHT < end) ? b + PARALLEL_GRAIN_LIGHT : end;
+			unsigned int n = 0;
+			for (unsigned int i = b; i < e; i++)
+				n += (mask[i] != 0.0);
+
+			partial[b / PARALLEL_GRAIN_LIGHT] = n;
+		}
+	}
+};
+
+unsigned int compactOffsets(const double *mask, const unsigned int count, std::vector<unsigned int> &offsets)
+{
+	unsigned int chunks = parallelChunkCount(count, PARALLEL_GRAIN_LIGHT);
+	offsets.resize(chunks);
+	if (count == 0)
+		return 0;
+
+	mMaskCountKernel countKernel;
+	countKernel.mask = mask;
+	countKernel.partial = &offsets[0];
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, countKernel);
+
+	unsigned int sum = 0;
+	for (unsigned int c = 0; c < chunks; c++)
+	{
+		unsigned int n = offsets[c];
+		offsets[c] = sum;
+		sum += n;
+	}
+	return sum;
+}
+
+struct mCompactKernel
+{
+	const double *data;
+	const double *mask;
+	const unsigned int *offsets;
+	unsigned int elements;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b += PARALLEL_GRAIN_LIGHT)
+		{
+			unsigned int e = (b + PARALLEL_GRAIN_LIGHT < end) ? b + PARALLEL_GRAIN_LIGHT : end;
+			unsigned int pos = offsets[b / PARALLEL_GRAIN_LIGHT];
+
+			if (data == 0)
+			{
+				for (unsigned int i = b; i < e; i++)
+					if (mask[i] != 0.0)
+						out[pos++] = i;
+			}
+			else if (elements == 1)
+			{
+				for (unsigned int i = b; i < e; i++)
+					if (mask[i] != 0.0)
+						out[pos++] = data[i];
+			}
+			else
+			{
+				for (unsigned int i = b; i < e; i++)
+				{
+					if (mask[i] != 0.0)
+					{
+						memcpy(out + pos * elements, data + i * elements, elements * sizeof(double));
+						pos++;
+					}
+				}
+			}
+		}
+	}
+};
+
+void compactByMask(const double *data, const unsigned int count, const unsigned int elements, const double *mask,
+				   const std::vector<unsigned int> &offsets, double *out)
+{
+	if (count == 0)
+		return;
+
+	mCompactKernel kernel;
+	kernel.data = data;
+	kernel.mask = mask;
+	kernel.offsets = &offsets[0];
+	kernel.elements = elements;
+	kernel.out = out;
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+}
+
+
+//************************************************************************************************
+//************************************************************************************************
+//                                       HISTOGRAM
+//************************************************************************************************
+//************************************************************************************************
+
+// values whose bins are computed in one go before the counts are incremented
+#define HISTOGRAM_BLOCK 256
+// chunks per thread, every chunk fills its own private histogram
+#define HISTOGRAM_CHUNKS_PER_THREAD 4
+// up to this number of edges digitize compares against all of them instead of a binary search
+#define DIGITIZE_LINEAR_EDGES 16
+
+
+// bins are computed for a whole block first, into an extra "outside" bin for the values that don't count.
+// This loop is free of branches and data dependencies, so the compiler can vectorize it,
+// the increments are then done in a second, short loop
+struct mHistogramKernel
+{
+	const double *data, *min, *max;
+	unsigned int dataStride, minStride, maxStride;
+	unsigned int bins;
+	unsigned int grain;
+	// (bins + 1) private counts per chunk
+	unsigned int *counts;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		unsigned int bin[HISTOGRAM_BLOCK];
+		const double binCount = bins;
+
+		for (unsigned int c = begin; c < end; c += grain)
+		{
+			unsigned int e = (c + grain < end) ? c + grain : end;
+			unsigned int *h = counts + (c / grain) * (bins + 1);
+			memset(h, 0, (bins + 1) * sizeof(unsigned int));
+
+			for (unsigned int b = c; b < e; b += HISTOGRAM_BLOCK)
+			{
+				unsigned int n = (b + HISTOGRAM_BLOCK < e) ? HISTOGRAM_BLOCK : e - b;
+
+				if ((dataStride == 1) && (minStride == 0) && (maxStride == 0))
+				{
+					// one range for all values, the common case
+					const double *d = data + b;
+					const double lo = min[0];
+					const double scale = binCount / (max[0] - lo);
+					for (unsigned int i = 0; i < n; i++)
+					{
+						double t = (d[i] - lo) * scale;
+						bool inside = (t >= 0.0) && (t <= binCount);
+						unsigned int k = (unsigned int)(inside ? t : 0.0);
+						k = (k < bins) ? k : bins - 1;
+						bin[i] = inside ? k : bins;
+					}
+				}
+				else
+				{
+					for (unsigned int i = 0; i < n; i++)
+					{
+						unsigned int j = b + i;
+						double lo = min[j * minStride];
+						double range = max[j * maxStride] - lo;
+						double t = (range > 0.0) ? (data[j * dataStride] - lo) * (binCount / range) : -1.0;
+						bool inside = (t >= 0.0) && (t <= binCount);
+						unsigned int k = (unsigned int)(inside ? t : 0.0);
+						k = (k < bins) ? k : bins - 1;
+						bin[i] = inside ? k : bins;
+					}
+				}
+
+				for (unsigned int i = 0; i < n; i++)
+					h[bin[i]]++;
+			}
+		}
+	}
+};
+
+// sums the private histograms up, per bin
+struct mHistogramMergeKernel
+{
+	const unsigned int *partial;
+	unsigned int chunks;
+	unsigned int stride;
+	unsigned int *counts;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int k = begin; k < end; k++)
+		{
+			unsigned int n = 0;
+			for (unsigned int c = 0; c < chunks; c++)
+				n += partial[c * stride + k];
+			counts[k] = n;
+		}
+	}
+};
+
+void histogramCounts(const double *data, const unsigned int dataStride,
+					 const double *min, const unsigned int minStride,
+					 const double *max, const unsigned int maxStride,
+					 const unsigned int count, const unsigned int bins, unsigned int *counts)
+{
+	memset(counts, 0, bins * sizeof(unsigned int));
+	if ((count == 0) || (bins == 0))
+		return;
+
+	// only a few big chunks, so there are not many private histograms to merge
+	unsigned int grain = count / (mThreadPool::threadCount() * HISTOGRAM_CHUNKS_PER_THREAD) + 1;
+	if (grain < PARALLEL_GRAIN_LIGHT)
+		grain = PARALLEL_GRAIN_LIGHT;
+	unsigned int chunks = parallelChunkCount(count, grain);
+
+	std::vector<unsigned int> partial(chunks * (bins + 1));
+
+	mHistogramKernel kernel;
+	kernel.data = data;
+	kernel.min = min;
+	kernel.max = max;
+	kernel.dataStride = dataStride;
+	kernel.minStride = minStride;
+	kernel.maxStride = maxStride;
+	kernel.bins = bins;
+	kernel.grain = grain;
+	kernel.counts = &partial[0];
+	parallelFor(count, grain, kernel);
+
+	mHistogramMergeKernel merge;
+	merge.partial = &partial[0];
+	merge.chunks = chunks;
+	merge.stride = bins + 1;
+	merge.counts = counts;
+	parallelFor(bins, PARALLEL_GRAIN_LIGHT, merge);
+}
+
+
+struct mDigitizeKernel
+{
+	const double *data;
+	const double *edges;
+	unsigned int edgeCount;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		if (edgeCount <= DIGITIZE_LINEAR_EDGES)
+		{
+			// count the edges that are not bigger, no branches
+			for (unsigned int i = begin; i < end; i++)
+			{
+				double x = data[i];
+				unsigned int k = 0;
+				for (unsigned int j = 0; j < edgeCount; j++)
+					k += !(x < edges[j]);
+				out[i] = k;
+			}
+		}
+		else
+		{
+			// branch free binary search, the loop runs the same number of times for every value
+			for (unsigned int i = begin; i < end; i++)
+			{
+				double x = data[i];
+				const double *base = edges;
+				unsigned int n = edgeCount;
+				while (n > 1)
+				{
+					unsigned int half = n / 2;
+					base = (x < base[half]) ? base : base + half;
+					n -= half;
+				}
+				out[i] = (unsigned int)(base - edges) + !(x < *base);
+			}
+		}
+	}
+};
+
+void digitize(const double *data, const unsigned int count, const double *edges, const unsigned int edgeCount, double *out)
+{
+	if (edgeCount == 0)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			out[i] = 0.0;
+		return;
+	}
+
+	mDigitizeKernel kernel;
+	kernel.data = data;
+	kernel.edges = edges;
+	kernel.edgeCount = edgeCount;
+	kernel.out = out;
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
+}
+
+}// namespace
@@ -0,0 +1,1110 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// Title: Array Store Commands
+//
+// About:
+// Large arrays that go through several commands in a row don't have to travel through mel every time,
+// mArrayStore keeps them on the plugin side under a name and the mStore commands work on them directly.
+// A store can opt in to single precision storage, which halves the memory and bandwidth
+// of big vector and matrix arrays, the values are only converted to double when they are handed back to mel.
+//
+// Important conventions:
+// All values of a store have one type (dbl, uv, vec, quat or mat) in the usual flat layout.
+// The mStore commands take the name of the result store as first argument, it is created if it doesn't exist
+// (an empty string creates a new one) and its name is returned. All operands of a command have to have the same precision,
+// which is also the precision of the result.
+// The Set commands (mDblSet, mVecSet, mVecSetX, mMatSetComponent ...) change a store in place when they get its name
+// instead of an array, so sparse updates only cost the number of changed elements.
+
+
+#include <maya/MArgList.h>
+#include <maya/MStringArray.h>
+
+#include "../include/mHelperMacros.h"
+#include "../include/mArrayStoreCmd.h"
+#include "../include/mHelperFunctions.h"
+#include "../include/mNoiseCmd.h"
+#include "../include/mThreadPool.h"
+#include "../include/Noise.h"
+
+
+/*
+   Function: mArrayStore
+
+This Command allows you to create, edit and query array store objects which keep a flat array on the plugin side,
+optionally in single precision. The mStore commands use these objects as their in- and output.
+
+USAGE: mArrayStore
+   -v|-values          -  [CEQ]   Specify the values of the store (doubleArray), upon query return them as a doubleArray.
+   -t|-type            -  [CQ]    Specify the type of the values (string, one of dbl, uv, vec, quat, mat, default dbl),
+                                  upon query return it.
+   -s|-single          -  [CQ]    Store the values in single precision, upon query return if the store is single precision.
+   -c|-count           -  [Q]     Return the number of elements (values / values per element) in the store.
+   -l|-list            -  [C]     Returns all mArrayStore object names (as a stringArray)
+   -d|-delete          -  [E]     Delete the specified mArrayStore object.
+  -da|-deleteAll       -  [C]     Delete all mArrayStore objects.
+   -h|-help            -  [C]     Displays this help.
+
+Example:
+
+   (start code)
+   // keep a big matrix array in single precision on the plugin side
+   string $mats = `mArrayStore -type "mat" -single -values $matrices`;
+   // Result:mArrayStoreObject0//
+
+   // transform the points, the result stays a single precision store
+   string $pts = `mArrayStore -type "vec" -single -values $points`;
+   mStoreVecMatMult $pts $pts $mats;
+
+   // back to mel
+   float $result[] = `mArrayStore -q -values $pts`;
+
+   mArrayStore -e -delete $pts;
+   mArrayStore -e -delete $mats;
+   (end)
+*/
+
+
+namespace melfunctions
+{
+
+mArrayStoreMapType mArrayStore::mASMap;
+int mArrayStore::mArrayStoreIndex =0;
+
+void* mArrayStore::creator()
+{
+	return new mArrayStore;
+}
+
+//************************************************************************//
+// init vars
+mArrayStore::mArrayStore()
+{
+	mCmdAction = MAS_CMD_ACTION_CREATE;
+	mCreateAction = MAS_CMD_CREATE_CREATE;
+	mEditAction = MAS_CMD_EDIT_VALUES;
+	mQueryAction = MAS_CMD_QUERY_VALUES;
+
+	mHelpFlagSet = false;
+	mSingle = false;
+	mElements = 1;
+	mValuesFlagSet = false;
+}
+
+//************************************************************************//
+
+void mArrayStore::help() const
+{
+    MString help( "mArrayStore, melfunctions, (c) Carsten Kolve, 2006\n" );
+    help += "This Command allows you to create, edit and query mArrayStore objects which keep a flat array on the plugin side,\n";
+    help += "optionally in single precision. The mStore commands use these objects as their in- and output.\n\n";
+    help += "USAGE: mArrayStore\n";
+    help += "//\t   -v|-values         [CEQ]   Specify the values of the store (doubleArray), upon query return them as a doubleArray.\n";
+    help += "//\t   -t|-type           [CQ]    Specify the type of the values (string, one of dbl, uv, vec, quat, mat, default dbl),\n";
+    help += "//\t                              upon query return it.\n";
+    help += "//\t   -s|-single         [CQ]    Store the values in single precision, upon query return if the store is single precision.\n";
+    help += "//\t   -c|-count          [Q]     Return the number of elements (values / values per element) in the store.\n";
+    help += "//\t   -l|-list           [C]     Returns all mArrayStore object names (as a stringArray)\n";
+    help += "//\t   -d|-delete         [E]     Delete the specified mArrayStore object.\n";
+    help += "//\t  -da|-deleteAll      [C]     Delete all mArrayStore objects.\n";
+    help += "//\t   -h|-help           [C]     Displays this help.\n";
+
+    MGlobal::displayInfo( help );
+}
+
+//************************************************************************//
+// we can't use the arg parser as it doesn't support arrays
+
+bool mArrayStore::argParseIsFlagSet( const MArgList& args,
+                        const char *shortFlag, const char *longFlag,
+                        int &flagIndex)
+{
+    flagIndex = args.flagIndex( shortFlag, longFlag);
+    return ( MArgList::kInvalidArgIndex != flagIndex );
+}
+
+
+MStatus mArrayStore::argParseGetObjectStringArg (const MArgList& args,MString& name)
+{
+	MStatus status = MS::kSuccess;
+	int argIndex = args.length() -1;
+
+	name = args.asString(argIndex,&status);
+	USER_ERROR_CHECK(status,("mArrayStore: can't get name of mArrayStore object"));
+
+	return status;
+}
+
+// number of values per element for a type name, 0 if there is no such type
+static unsigned int storeTypeElements(const MString &type)
+{
+	if (type == "dbl")	return 1;
+	if (type == "uv")	return ELEMENTS_UV;
+	if (type == "vec")	return ELEMENTS_VEC;
+	if (type == "quat")	return ELEMENTS_QUAT;
+	if (type == "mat")	return ELEMENTS_MAT;
+	return 0;
+}
+
+static MString storeTypeName(const unsigned int elements)
+{
+	switch (elements)
+	{
+		case ELEMENTS_UV:	return "uv";
+		case ELEMENTS_VEC:	return "vec";
+		case ELEMENTS_QUAT:	return "quat";
+		case ELEMENTS_MAT:	return "mat";
+	}
+	return "dbl";
+}
+
+MStatus mArrayStore::parseArgs( const MArgList& args )
+{
+	MStatus status = MS::kSuccess;
+	int flagNum = args.length(); // number of flags that still need to be processed
+	int index;
+
+	///////////////////////////////////////////////
+	// do we want help?
+	if (argParseIsFlagSet(args,MAS_HELP_FLAG,MAS_HELP_FLAG_LONG,index))
+	{
+	     mHelpFlagSet = true;
+	     return status;
+	}
+
+	//////////////////////////////////////////////
+	// in which mode are we? create, query or edit
+	if (argParseIsFlagSet(args,"q","query",index))
+	{
+		flagNum--;
+		mCmdAction = MAS_CMD_ACTION_QUERY;
+	}
+
+	if (argParseIsFlagSet(args,"e","edit",index))
+	{
+		if ( mCmdAction == MAS_CMD_ACTION_QUERY)
+		{
+			USER_ERROR_CHECK(MS::kFailure,"mArrayStore: can't use -edit (-e) and -query (-q) flag at the same time!");
+		}
+		mCmdAction = MAS_CMD_ACTION_EDIT;
+		flagNum--;
+	}
+
+	// the values are needed upon create and edit, just a flag upon query
+	bool valuesFlagSet = argParseIsFlagSet(args,MAS_VALUES_FLAG,MAS_VALUES_FLAG_LONG,index);
+	if (valuesFlagSet && mCmdAction != MAS_CMD_ACTION_QUERY)
+	{
+		status = getDoubleArrayArg(args, (index+1), mValues);
+		USER_ERROR_CHECK(status,("mArrayStore: can't get doubleArray argument for argument "+(index+1)));
+		mValuesFlagSet = true;
+		flagNum -=2;
+	}
+
+	////////////////////////////////////////////
+    // parse based on mode
+	if ( mCmdAction == MAS_CMD_ACTION_CREATE)
+	{
+		if (argParseIsFlagSet(args,MAS_DELETE_ALL_FLAG,MAS_DELETE_ALL_FLAG_LONG,index))
+		{
+			mCreateAction = MAS_CMD_CREATE_DELETE_ALL;
+			flagNum--;
+		}
+		else if (argParseIsFlagSet(args,MAS_LIST_FLAG,MAS_LIST_FLAG_LONG,index))
+		{
+			mCreateAction = MAS_CMD_CREATE_LIST;
+			flagNum--;
+		}
+		else
+		{
+			if (!mValuesFlagSet)
+			{
+				USER_ERROR_CHECK(MS::kFailure,"mArrayStore: when creating an mArrayStore object you have to provide its values using the -v|-values flag!");
+			}
+
+			if (argParseIsFlagSet(args,MAS_TYPE_FLAG,MAS_TYPE_FLAG_LONG,index))
+			{
+				MString type = args.asString((index+1),&status);
+				USER_ERROR_CHECK(status,("mArrayStore: can't get string argument for argument "+(index+1)));
+				mElements = storeTypeElements(type);
+				if (!mElements)
+				{
+					USER_ERROR_CHECK(MS::kFailure,"mArrayStore: unknown type '"+type+"', use one of dbl, uv, vec, quat, mat!");
+				}
+				flagNum -=2;
+			}
+
+			if (argParseIsFlagSet(args,MAS_SINGLE_FLAG,MAS_SINGLE_FLAG_LONG,index))
+			{
+				mSingle = true;
+				flagNum--;
+			}
+
+			if (mValues.length() % mElements)
+			{
+				USER_ERROR_CHECK(MS::kFailure,"mArrayStore: the number of values doesn't match the type of the store!");
+			}
+		}
+	}
+	else
+	{
+		if ( mCmdAction == MAS_CMD_ACTION_EDIT)
+		{
+			if (argParseIsFlagSet(args,MAS_DELETE_FLAG,MAS_DELETE_FLAG_LONG,index))
+			{
+				mEditAction = MAS_CMD_EDIT_DELETE;
+				flagNum--;
+			}
+			else if (!mValuesFlagSet)
+			{
+				USER_ERROR_CHECK(MS::kFailure,"mArrayStore: nothing to edit, provide new values using the -v|-values flag or use the -d|-delete flag!");
+			}
+		}
+		else // QUERY
+		{
+			// only one of the query flags should be set
+			if (valuesFlagSet)
+				mQueryAction = MAS_CMD_QUERY_VALUES;
+			else if (argParseIsFlagSet(args,MAS_COUNT_FLAG,MAS_COUNT_FLAG_LONG,index))
+				mQueryAction = MAS_CMD_QUERY_COUNT;
+			else if (argParseIsFlagSet(args,MAS_TYPE_FLAG,MAS_TYPE_FLAG_LONG,index))
+				mQueryAction = MAS_CMD_QUERY_TYPE;
+			else if (argParseIsFlagSet(args,MAS_SINGLE_FLAG,MAS_SINGLE_FLAG_LONG,index))
+				mQueryAction = MAS_CMD_QUERY_SINGLE;
+			else
+			{
+				USER_ERROR_CHECK(MS::kFailure,"mArrayStore: no matching query flag provided!");
+			}
+			flagNum--;
+		}
+
+		// need a store object
+		status = argParseGetObjectStringArg(args,mStoreName);
+		if (status.error())
+			return status;
+		flagNum--;
+	}
+
+    if (flagNum != 0)
+    {
+   		USER_ERROR_CHECK(MS::kFailure,"mArrayStore: wrong number of arguments!");
+    }
+
+    return status;
+}
+
+
+//************************************************************************//
+// conversion between the mel side doubles and the store precision
+
+template <class S, class D>
+struct mArrayConvertKernel
+{
+	const S *src;
+	D *dst;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+			dst[i] = D(src[i]);
+	}
+};
+
+template <class S, class D>
+static void convertArray(const S *src, D *dst, const unsigned int length)
+{
+	mArrayConvertKernel<S,D> kernel;
+	kernel.src = src;
+	kernel.dst = dst;
+	parallelFor(length, PARALLEL_GRAIN_LIGHT, kernel);
+}
+
+// pointer to the first value of a store vector, NULL if it is empty
+template <class T>
+inline T* storePtr(std::vector<T> &v)
+{
+	return v.empty() ? NULL : &v[0];
+}
+
+template <class T>
+inline const T* storePtr(const std::vector<T> &v)
+{
+	return v.empty() ? NULL : &v[0];
+}
+
+void arrayStoreSetValues(mArrayStoreStruct &store, MDoubleArray &values)
+{
+	const unsigned int length = values.length();
+	const double *src = arrayPtr(values);
+
+	// only keep the storage of the precision in use
+	if (store.single)
+	{
+		std::vector<double>().swap(store.dbl);
+		store.flt.resize(length);
+		convertArray(src, storePtr(store.flt), length);
+	}
+	else
+	{
+		std::vector<float>().swap(store.flt);
+		store.dbl.resize(length);
+		convertArray(src, storePtr(store.dbl), length);
+	}
+}
+
+void arrayStoreGetValues(const mArrayStoreStruct &store, MDoubleArray &values)
+{
+	const unsigned int length = store.length();
+	values.setLength(length);
+	if (store.single)
+		convertArray(storePtr(store.flt), arrayPtr(values), length);
+	else
+		convertArray(storePtr(store.dbl), arrayPtr(values), length);
+}
+
+
+//************************************************************************//
+// store object access
+
+MStatus mArrayStore::getStore(const MString &name, mArrayStoreStruct *&store)
+{
+	mArrayStoreIterType iter = mASMap.find(std::string(name.asChar()));
+	if (iter == mASMap.end())
+	{
+		MString error = "mArrayStore: specified mArrayStoreObject '";
+		error += name +"' does not exist!";
+		USER_ERROR_CHECK(MS::kFailure,error);
+	}
+
+	store = &(iter->second);
+	return MS::kSuccess;
+}
+
+mArrayStoreStruct& mArrayStore::getOrCreateStore(MString &name)
+{
+	if (name.length() == 0)
+		name = MString(generateStoreName().c_str());
+
+	return mASMap[std::string(name.asChar())];
+}
+
+std::string	mArrayStore::generateStoreName()
+{
+	// don't hand out the name of a store that was created with an explicit name
+	std::string name;
+	do
+	{
+		MString newName = "mArrayStoreObject";
+		newName += mArrayStoreIndex;
+		mArrayStoreIndex++;
+		name = newName.asChar();
+	}
+	while (mASMap.find(name) != mASMap.end());
+
+	return name;
+}
+
+MStatus mArrayStore::listAllStores()
+{
+	MStringArray list;
+
+	for (mArrayStoreIterType iter = mASMap.begin(); iter != mASMap.end(); iter++)
+		list.append(MString( (*iter).first.c_str() ));
+
+	setResult(list);
+	return MS::kSuccess;
+}
+
+MStatus mArrayStore::deleteStore()
+{
+	mArrayStoreIterType iter = mASMap.find(std::string(mStoreName.asChar()));
+	if (iter == mASMap.end())
+	{
+		MString error = "mArrayStore: specified mArrayStoreObject '";
+		error += mStoreName +"' does not exist!";
+		USER_ERROR_CHECK(MS::kFailure,error);
+	}
+
+	mASMap.erase(iter);
+	return MS::kSuccess;
+}
+
+//************************************************************************//
+
+MStatus mArrayStore::doCreate()
+{
+	switch (mCreateAction)
+	{
+		case MAS_CMD_CREATE_DELETE_ALL:
+			mASMap.clear();
+			mArrayStoreIndex = 0;
+			return MS::kSuccess;
+
+		case MAS_CMD_CREATE_LIST:
+			return listAllStores();
+	}
+
+	MString name;
+	mArrayStoreStruct &store = getOrCreateStore(name);
+	store.elements = mElements;
+	store.single = mSingle;
+	arrayStoreSetValues(store, mValues);
+
+	setResult(name);
+	return MS::kSuccess;
+}
+
+MStatus mArrayStore::doEdit()
+{
+	if (mEditAction == MAS_CMD_EDIT_DELETE)
+		return deleteStore();
+
+	mArrayStoreStruct *store;
+	MStatus status = getStore(mStoreName, store);
+	if (status.error()) return status;
+
+	// the type and precision of a store stay the same
+	if (mValues.length() % store->elements)
+	{
+		USER_ERROR_CHECK(MS::kFailure,"mArrayStore: the number of values doesn't match the type of the store!");
+	}
+
+	arrayStoreSetValues(*store, mValues);
+	return MS::kSuccess;
+}
+
+MStatus mArrayStore::doQuery()
+{
+	mArrayStoreStruct *store;
+	MStatus status = getStore(mStoreName, store);
+	if (status.error()) return status;
+
+	switch (mQueryAction)
+	{
+		case MAS_CMD_QUERY_COUNT:
+			setResult(int(store->count()));
+			break;
+
+		case MAS_CMD_QUERY_TYPE:
+			setResult(storeTypeName(store->elements));
+			break;
+
+		case MAS_CMD_QUERY_SINGLE:
+			setResult(store->single);
+			break;
+
+		default:
+		{
+			MDoubleArray values;
+			arrayStoreGetValues(*store, values);
+			setResult(values);
+		}
+	}
+
+	return MS::kSuccess;
+}
+
+MStatus mArrayStore::doIt( const MArgList& args )
+{
+	MStatus status = parseArgs(args);
+	if (status.error())
+		return status;
+
+	if (mHelpFlagSet)
+	{
+		help();
+		return MS::kSuccess;
+	}
+
+	switch (mCmdAction)
+	{
+		case MAS_CMD_ACTION_EDIT:
+			return doEdit();
+		case MAS_CMD_ACTION_QUERY:
+			return doQuery();
+	}
+
+	return doCreate();
+}
+
+
+//************************************************************************************************//
+// threaded kernels for the store commands, templated on the precision of the stores
+// they are plain straight line loops the compiler can vectorise, in single precision that
+// moves half the data of the double commands
+
+// point (with translation) times matrix, for projective matrices the result is divided by w like
+// the MPoint based mVecMatMult does
+template <class T>
+struct mStoreVecMatMultKernel
+{
+	const T *vec;
+	const T *mat;
+	unsigned int incV, incM;
+	T *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const T *v = vec + i * incV * ELEMENTS_VEC;
+			const T *m = mat + i * incM * ELEMENTS_MAT;
+			T *r = out + i * ELEMENTS_VEC;
+
+			const T x = v[0], y = v[1], z = v[2];
+			r[0] = x * m[0] + y * m[4] + z * m[8]  + m[12];
+			r[1] = x * m[1] + y * m[5] + z * m[9]  + m[13];
+			r[2] = x * m[2] + y * m[6] + z * m[10] + m[14];
+
+			const T w = x * m[3] + y * m[7] + z * m[11] + m[15];
+			if (w != T(1))
+			{
+				r[0] /= w;
+				r[1] /= w;
+				r[2] /= w;
+			}
+		}
+	}
+};
+
+template <class T>
+struct mStoreMatMultKernel
+{
+	const T *a;
+	const T *b;
+	unsigned int incA, incB;
+	T *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const T *ma = a + i * incA * ELEMENTS_MAT;
+			const T *mb = b + i * incB * ELEMENTS_MAT;
+			T *r = out + i * ELEMENTS_MAT;
+
+			for (unsigned int row=0;row<4;row++)
+			{
+				const T a0 = ma[row*4], a1 = ma[row*4+1], a2 = ma[row*4+2], a3 = ma[row*4+3];
+				for (unsigned int col=0;col<4;col++)
+					r[row*4+col] = a0 * mb[col] + a1 * mb[4+col] + a2 * mb[8+col] + a3 * mb[12+col];
+			}
+		}
+	}
+};
+
+// every chunk uses its own Noise instance with the permutation table of the seed set by mSeed,
+// the chunk is split into its components in blocks for the batched noise call
+#define STORE_NOISE_BLOCK 256
+
+template <class T>
+struct mStore3dNoiseKernel
+{
+	const T *vec;
+	unsigned int seed;
+	T *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		Noise noiseGen(seed);
+		float p[3][STORE_NOISE_BLOCK];
+		float res[STORE_NOISE_BLOCK];
+
+		for (unsigned int start=begin;start<end;start+=STORE_NOISE_BLOCK)
+		{
+			const unsigned int n = (end - start < STORE_NOISE_BLOCK) ? end - start : STORE_NOISE_BLOCK;
+			const T *v = vec + start * ELEMENTS_VEC;
+
+			for (unsigned int i=0;i<n;i++)
+			{
+				p[0][i] = float(v[ELEMENTS_VEC*i]);
+				p[1][i] = float(v[ELEMENTS_VEC*i+1]);
+				p[2][i] = float(v[ELEMENTS_VEC*i+2]);
+			}
+
+			noiseGen.improvedPerlin3dS(p[0], p[1], p[2], res, n);
+
+			for (unsigned int i=0;i<n;i++)
+				out[start+i] = T(res[i]);
+		}
+	}
+};
+
+
+template <class T>
+static void storeVecMatMult(const std::vector<T> &vec, const unsigned int incV, const std::vector<T> &mat, const unsigned int incM,
+							const unsigned int count, std::vector<T> &out)
+{
+	out.resize(count * ELEMENTS_VEC);
+	mStoreVecMatMultKernel<T> kernel;
+	kernel.vec = storePtr(vec);
+	kernel.mat = storePtr(mat);
+	kernel.incV = incV;
+	kernel.incM = incM;
+	kernel.out = storePtr(out);
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+}
+
+template <class T>
+static void storeMatMult(const std::vector<T> &a, const unsigned int incA, const std::vector<T> &b, const unsigned int incB,
+						 const unsigned int count, std::vector<T> &out)
+{
+	out.resize(count * ELEMENTS_MAT);
+	mStoreMatMultKernel<T> kernel;
+	kernel.a = storePtr(a);
+	kernel.b = storePtr(b);
+	kernel.incA = incA;
+	kernel.incB = incB;
+	kernel.out = storePtr(out);
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
+}
+
+template <class T>
+static void store3dNoise(const std::vector<T> &vec, const unsigned int count, std::vector<T> &out)
+{
+	out.resize(count);
+	mStore3dNoiseKernel<T> kernel;
+	kernel.vec = storePtr(vec);
+	kernel.seed = mfSeed;
+	kernel.out = storePtr(out);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
+}
+
+
+// get the store named by argument argIndex, it has to hold values of the given type
+static MStatus getStoreArg(const MArgList& args, const unsigned int argIndex, const unsigned int elements, mArrayStoreStruct *&store)
+{
+	MString name;
+	MStatus stat = getStringArg(args, argIndex, name);
+	ERROR_FAIL(stat);
+
+	stat = mArrayStore::getStore(name, store);
+	ERROR_FAIL(stat);
+
+	if (store->elements != elements)
+	{
+		USER_ERROR_CHECK(MS::kFailure,"mArrayStore: mArrayStoreObject '"+name+"' doesn't hold "+storeTypeName(elements)+" values!");
+	}
+
+	return MS::kSuccess;
+}
+
+static MStatus samePrecision(const mArrayStoreStruct &a, const mArrayStoreStruct &b)
+{
+	if (a.single != b.single)
+	{
+		USER_ERROR_CHECK(MS::kFailure,"mArrayStore: can't mix single and double precision stores!");
+	}
+	return MS::kSuccess;
+}
+
+// the storage of a store for the precision T
+inline std::vector<float>& storeValues(mArrayStoreStruct &store, const float *) { return store.flt; }
+inline std::vector<double>& storeValues(mArrayStoreStruct &store, const double *) { return store.dbl; }
+
+// move a computed result into the named result store, which may be one of the operands
+template <class T>
+static void storeResult(MString &name, const unsigned int elements, std::vector<T> &values)
+{
+	mArrayStoreStruct &result = mArrayStore::getOrCreateStore(name);
+	result.elements = elements;
+	result.single = (sizeof(T) == sizeof(float));
+	std::vector<float>().swap(result.flt);
+	std::vector<double>().swap(result.dbl);
+	storeValues(result, (const T*)NULL).swap(values);
+}
+
+
+//************************************************************************************************//
+/*
+   Function: mStoreVecMatMult
+
+   Transform the points of a vector store by the matrices of a matrix store, both stores keep the standard broadcast rules
+   (one element or as many as the other store). Like mVecMatMult the result is divided by the homogeneous w for
+   projective matrices.
+
+   Parameters:
+
+		$result - name of the store to hold the result (vec), created if it doesn't exist, "" creates a new one
+		$vecStore - name of the vector store
+		$matStore - name of the matrix store
+
+   Returns:
+
+      The name of the result store
+
+*/
+#define mel mStoreVecMatMult(string $result, string $vecStore, string $matStore);
+#undef mel
+
+CREATOR(mStoreVecMatMult)
+MStatus mStoreVecMatMult::doIt( const MArgList& args )
+{
+	MStatus stat = argCountCheck(args,3);
+	ERROR_FAIL(stat);
+
+	MString name;
+	stat = getStringArg(args, 0, name);
+	ERROR_ARG(stat,1);
+
+	mArrayStoreStruct *vecA, *matB;
+	stat = getStoreArg(args, 1, ELEMENTS_VEC, vecA);
+	ERROR_FAIL(stat);
+	stat = getStoreArg(args, 2, ELEMENTS_MAT, matB);
+	ERROR_FAIL(stat);
+	stat = samePrecision(*vecA, *matB);
+	ERROR_FAIL(stat);
+
+	unsigned int incA, incB, count;
+	stat = twoArgCountsValid(vecA->count(), matB->count(), incA, incB, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	if (vecA->single)
+	{
+		std::vector<float> result;
+		storeVecMatMult(vecA->flt, incA, matB->flt, incB, count, result);
+		storeResult(name, ELEMENTS_VEC, result);
+	}
+	else
+	{
+		std::vector<double> result;
+		storeVecMatMult(vecA->dbl, incA, matB->dbl, incB, count, result);
+		storeResult(name, ELEMENTS_VEC, result);
+	}
+
+	setResult(name);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mStoreMatMult
+
+   Multiply the matrices of two matrix stores, both stores keep the standard broadcast rules
+   (one element or as many as the other store)
+
+   Parameters:
+
+		$result - name of the store to hold the result (mat), created if it doesn't exist, "" creates a new one
+		$matStoreA - name of the first matrix store
+		$matStoreB - name of the second matrix store
+
+   Returns:
+
+      The name of the result store
+
+*/
+#define mel mStoreMatMult(string $result, string $matStoreA, string $matStoreB);
+#undef mel
+
+CREATOR(mStoreMatMult)
+MStatus mStoreMatMult::doIt( const MArgList& args )
+{
+	MStatus stat = argCountCheck(args,3);
+	ERROR_FAIL(stat);
+
+	MString name;
+	stat = getStringArg(args, 0, name);
+	ERROR_ARG(stat,1);
+
+	mArrayStoreStruct *matA, *matB;
+	stat = getStoreArg(args, 1, ELEMENTS_MAT, matA);
+	ERROR_FAIL(stat);
+	stat = getStoreArg(args, 2, ELEMENTS_MAT, matB);
+	ERROR_FAIL(stat);
+	stat = samePrecision(*matA, *matB);
+	ERROR_FAIL(stat);
+
+	unsigned int incA, incB, count;
+	stat = twoArgCountsValid(matA->count(), matB->count(), incA, incB, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	if (matA->single)
+	{
+		std::vector<float> result;
+		storeMatMult(matA->flt, incA, matB->flt, incB, count, result);
+		storeResult(name, ELEMENTS_MAT, result);
+	}
+	else
+	{
+		std::vector<double> result;
+		storeMatMult(matA->dbl, incA, matB->dbl, incB, count, result);
+		storeResult(name, ELEMENTS_MAT, result);
+	}
+
+	setResult(name);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mStore3dNoise
+
+   Sample Improved Perlin noise [-1 to 1] at the points of a vector store, with the seed set by mSeed
+
+   Parameters:
+
+		$result - name of the store to hold the result (dbl), created if it doesn't exist, "" creates a new one
+		$vecStore - name of the vector store
+
+   Returns:
+
+      The name of the result store
+
+*/
+#define mel mStore3dNoise(string $result, string $vecStore);
+#undef mel
+
+CREATOR(mStore3dNoise)
+MStatus mStore3dNoise::doIt( const MArgList& args )
+{
+	MStatus stat = argCountCheck(args,2);
+	ERROR_FAIL(stat);
+
+	MString name;
+	stat = getStringArg(args, 0, name);
+	ERROR_ARG(stat,1);
+
+	mArrayStoreStruct *vecA;
+	stat = getStoreArg(args, 1, ELEMENTS_VEC, vecA);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	const unsigned int count = vecA->count();
+	if (vecA->single)
+	{
+		std::vector<float> result;
+		store3dNoise(vecA->flt, count, result);
+		storeResult(name, 1, result);
+	}
+	else
+	{
+		std::vector<double> result;
+		store3dNoise(vecA->dbl, count, result);
+		storeResult(name, 1, result);
+	}
+
+	setResult(name);
+	return MS::kSuccess;
+}
+
+
+//************************************************************************************************//
+// in place versions of the Set commands
+// when the first argument of mDblSet, mVecSet ... is the name of a store instead of an array, the store is changed
+// in place: only the given elements are written, nothing gets copied. All ids / components are checked before
+// anything is changed, so a failing command leaves the store as it was.
+
+bool isStoreArg(const MArgList& args, const unsigned int argIndex)
+{
+	// arrays and numbers are used as they are, anything else has to be the name of a store
+	// the array versions of get take the index by reference
+	MStatus stat;
+	unsigned int index = argIndex;
+	MDoubleArray dblA;
+	if (args.get(index, dblA))
+		return false;
+
+	args.asDouble(argIndex, &stat);
+	if (stat)
+		return false;
+
+	index = argIndex;
+	MIntArray intA;
+	if (args.get(index, intA))
+		return false;
+
+	args.asString(argIndex, &stat);
+	return (stat == MS::kSuccess);
+}
+
+template <class T>
+static void storeSetElements(std::vector<T> &data, const unsigned int elements,
+							 const MDoubleArray &ids, const unsigned int incIds,
+							 const MDoubleArray &values, const unsigned int incValues, const unsigned int count)
+{
+	for (unsigned int i=0;i<count;i++)
+	{
+		T *d = &data[(unsigned int)ids[i * incIds] * elements];
+		const unsigned int v = i * incValues * elements;
+		for (unsigned int k=0;k<elements;k++)
+			d[k] = T(values[v + k]);
+	}
+}
+
+template <class T>
+struct mStoreSetComponentKernel
+{
+	T *data;
+	unsigned int elements;
+	mArgStream components;
+	mArgStream values;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+			data[i * elements + (unsigned int)components[i]] = T(values[i]);
+	}
+};
+
+template <class T>
+static void storeSetComponents(std::vector<T> &data, const unsigned int elements, const unsigned int count,
+							   MDoubleArray &components, const unsigned int incComponents,
+							   MDoubleArray &values, const unsigned int incValues)
+{
+	mStoreSetComponentKernel<T> kernel;
+	kernel.data = storePtr(data);
+	kernel.elements = elements;
+	kernel.components = mArgStream(components, incComponents);
+	kernel.values = mArgStream(values, incValues);
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+}
+
+MStatus arrayStoreSetCmd(const MArgList& args, const unsigned int elements, MString &name)
+{
+	MStatus stat = argCountCheck(args,3);
+	ERROR_FAIL(stat);
+
+	stat = getStringArg(args, 0, name);
+	ERROR_ARG(stat,1);
+
+	mArrayStoreStruct *store;
+	stat = getStoreArg(args, 0, elements, store);
+	ERROR_FAIL(stat);
+
+	MDoubleArray ids, values;
+	stat = getDoubleArrayArg(args, 1, ids);
+	ERROR_ARG(stat,2);
+	stat = getDoubleArrayArg(args, 2, values);
+	ERROR_ARG(stat,3);
+
+	if (values.length() % elements)
+	{
+		USER_ERROR_CHECK(MS::kFailure,"the values don't match the type of mArrayStoreObject '"+name+"'!");
+	}
+
+	unsigned int incIds, incValues, count;
+	stat = twoArgCountsValid(ids.length(), values.length() / elements, incIds, incValues, count);
+	ERROR_FAIL(stat);
+
+	// check all ids first
+	const int numA = (int)store->count();
+	for (unsigned int i=0;i<count;i++)
+	{
+		int id = int(ids[i * incIds]);
+		if ((id < 0) || (id >= numA))
+		{
+			MString err = "id array has an invalid index '";
+			err = err + id +"' at position '"+i+"'!";
+			USER_ERROR_CHECK(MS::kFailure,err)
+		}
+	}
+
+	// do the actual job
+	if (store->single)
+		storeSetElements(store->flt, elements, ids, incIds, values, incValues, count);
+	else
+		storeSetElements(store->dbl, elements, ids, incIds, values, incValues, count);
+
+	return MS::kSuccess;
+}
+
+MStatus arrayStoreSetComponentCmd(const MArgList& args, const unsigned int elements, const int component, MString &name)
+{
+	// the values are the last argument, before them either nothing (fixed component), the component
+	// or for matrices the row and the column
+	const unsigned int valueArg = (component >= 0) ? 1 : ((elements == ELEMENTS_MAT) ? 3 : 2);
+	MStatus stat = argCountCheck(args,valueArg + 1);
+	ERROR_FAIL(stat);
+
+	stat = getStringArg(args, 0, name);
+	ERROR_ARG(stat,1);
+
+	mArrayStoreStruct *store;
+	stat = getStoreArg(args, 0, elements, store);
+	ERROR_FAIL(stat);
+
+	MDoubleArray components, values;
+	stat = getDoubleArrayArg(args, valueArg, values);
+	ERROR_FAIL(stat);
+
+	if (component >= 0)
+		components = MDoubleArray(1, double(component));
+	else if (elements != ELEMENTS_MAT)
+	{
+		stat = getDoubleArrayArg(args, 1, components);
+		ERROR_ARG(stat,2);
+
+		for (unsigned int i=0;i<components.length();i++)
+		{
+			if ((components[i] < 0.0) || (int(components[i]) >= (int)elements))
+			{
+				MString err = "component id error at index ";
+				err = err + i + ", not in valid range [0-" + (elements - 1) + "]!";
+				USER_ERROR_CHECK(MS::kFailure,err);
+			}
+		}
+	}
+	else
+	{
+		// rows and columns are combined into the index of the value in the matrix
+		MDoubleArray rows, columns;
+		stat = getDoubleArrayArg(args, 1, rows);
+		ERROR_ARG(stat,2);
+		stat = getDoubleArrayArg(args, 2, columns);
+		ERROR_ARG(stat,3);
+
+		unsigned int incR, incC, count;
+		stat = twoArgCountsValid(rows.length(), columns.length(), incR, incC, count);
+		ERROR_FAIL(stat);
+
+		components.setLength(count);
+		for (unsigned int i=0;i<count;i++)
+		{
+			int r = int(rows[i * incR]);
+			int c = int(columns[i * incC]);
+			if ((rows[i * incR] < 0.0) || (columns[i * incC] < 0.0) || (r > 3) || (c > 3))
+			{
+				MString err = "matrix element id error at index ";
+				err = err + i + "!";
+				USER_ERROR_CHECK(MS::kFailure,err);
+			}
+			components[i] = r * 4 + c;
+		}
+	}
+
+	// the store doesn't grow, the components and values either broadcast or match it
+	unsigned int incComponents, incValues, count;
+	stat = twoArgCountsValid(components.length(), values.length(), incComponents, incValues, count);
+	ERROR_FAIL(stat);
+
+	const unsigned int storeCount = store->count();
+	if ((count != 1) && (count != storeCount))
+	{
+		MString err = "mArrayStoreObject '";
+		err = err + name + "' has " + storeCount + " elements, but " + count + " values are given!";
+		USER_ERROR_CHECK(MS::kFailure,err);
+	}
+
+	// do the actual job
+	if (store->single)
+		storeSetComponents(store->flt, elements, storeCount, components, incComponents, values, incValues);
+	else
+		storeSetComponents(store->dbl, elements, storeCount, components, incComponents, values, incValues);
+
+	return MS::kSuccess;
+}
+
+
+}//end namespace
@@ -12,7 +12,11 @@
 #include <math.h>
 
 #include "../include/mHelperFunctions.h"
+#include "../include/mArrayStoreCmd.h"
 #include "../include/mDoubleManagementCmd.h"
+#include "../include/mArrayAlgorithms.h"
+
+#include <vector>
 
 namespace melfunctions
 {
@@ -280,7 +284,7 @@ MStatus mDblGet::doIt( const MArgList& args )
    Set elements in a double array, this function will not grow the double array, but error when you try to set an invalid array element!
 
    Parameters:
-		doubleArrayA - base double array
+		doubleArrayA - base double array, or the name of an mArrayStore object to change in place (its name is returned then)
 		ids	- int array of ids defining where in A to insert B
 		doubleArrayB - double array of elements to be inserted into A, must be size 1 or same size than id array
    Returns:
@@ -294,6 +298,16 @@ MStatus mDblGet::doIt( const MArgList& args )
 CREATOR(mDblSet)
 MStatus mDblSet::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetCmd(args, 1, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	unsigned int count = 1;
 
 	MStatus stat = argCountCheck(args,3); 
@@ -351,4 +365,219 @@ MStatus mDblSet::doIt( const MArgList& args )
 }
 
 
+
+// get the array and the optional descending switch for the sort commands
+static MStatus getArgDblDescending(const MArgList& args, MDoubleArray &dblA, bool &descending)
+{
+	descending = false;
+
+	if ((args.length() != 1) && (args.length() != 2))
+	{
+		MGlobal::displayError("wrong number of arguments, expected a double array and an optional int!");
+		return MS::kFailure;
+	}
+
+	MStatus stat = getDoubleArrayArg(args,0,dblA);
+	ERROR_FAIL(stat);
+
+	if (args.length() == 2)
+	{
+		int d;
+		stat = getIntArg(args,1,d);
+		ERROR_FAIL(stat);
+		descending = (d != 0);
+	}
+
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblSort
+   Sort a double array. The sort is stable, equal elements keep their order.
+
+   Parameters:
+
+		dblArrayA - the double array to sort
+		descending - (optional) 1 to sort from the biggest to the smallest element, default 0
+
+   Returns:
+
+      The sorted double array
+
+*/
+#define mel mDblSort(float $dblArrayA[], int $descending);
+#undef mel
+
+CREATOR(mDblSort)
+MStatus mDblSort::doIt( const MArgList& args )
+{
+    MDoubleArray dblA;
+    bool descending;
+	MStatus stat = getArgDblDescending(args, dblA, descending);
+	ERROR_FAIL(stat);
+
+	MDoubleArray result(dblA.length());
+	radixSortDoubles(arrayPtr(dblA), dblA.length(), descending, arrayPtr(result), NULL);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblArgSort
+   Get the indices that would sort a double array. The sort is stable, equal elements keep their order.
+   Use the result with mDblGet, mVecGet, mVecGather ... to bring companion arrays into the same order.
+
+   Parameters:
+
+		dblArrayA - the double array to sort
+		descending - (optional) 1 to sort from the biggest to the smallest element, default 0
+
+   Returns:
+
+      The indices of the elements of dblArrayA in sorted order as a float array
+
+*/
+#define mel mDblArgSort(float $dblArrayA[], int $descending);
+#undef mel
+
+CREATOR(mDblArgSort)
+MStatus mDblArgSort::doIt( const MArgList& args )
+{
+    MDoubleArray dblA;
+    bool descending;
+	MStatus stat = getArgDblDescending(args, dblA, descending);
+	ERROR_FAIL(stat);
+
+	unsigned int count = dblA.length();
+	std::vector<unsigned int> order(count);
+	radixSortDoubles(arrayPtr(dblA), count, descending, NULL, count ? &order[0] : NULL);
+
+	MDoubleArray result(count);
+	for (unsigned int i=0;i<count;i++)
+		result[i] = order[i];
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+
+//************************************************************************************************//
+/*
+   Function: mDblScan
+   Get the running sum (prefix sum) of a double array.
+
+   Parameters:
+
+		dblArrayA - the double array
+		exclusive - (optional) 0 to include the element itself in its sum (default), 1 to only sum up the elements before it
+
+   Returns:
+
+      The running sum as a float array of the same size, eg. {1,2,3} gives {1,3,6} or exclusive {0,1,3}
+
+*/
+#define mel mDblScan(float $dblArrayA[], int $exclusive);
+#undef mel
+
+CREATOR(mDblScan)
+MStatus mDblScan::doIt( const MArgList& args )
+{
+	MStatus stat;
+	bool exclusive = false;
+
+	if ((args.length() != 1) && (args.length() != 2))
+	{
+		USER_ERROR_CHECK(MS::kFailure,"mDblScan: wrong number of arguments, expected a double array and an optional int!");
+	}
+
+    MDoubleArray dblA;
+	stat = getDoubleArrayArg(args,0,dblA);
+	ERROR_FAIL(stat);
+
+	if (args.length() == 2)
+	{
+		int e;
+		stat = getIntArg(args,1,e);
+		ERROR_FAIL(stat);
+		exclusive = (e != 0);
+	}
+
+	MDoubleArray result(dblA.length());
+	scanSum(arrayPtr(dblA), dblA.length(), !exclusive, arrayPtr(result));
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblCompact
+   Keep only the elements of a double array where a mask is not 0, eg. the result of mDblIsBigger.
+
+   Parameters:
+
+		dblArrayA - the double array
+		mask - the mask, one value per element or a single value
+
+   Returns:
+
+      The kept elements in their original order
+
+*/
+#define mel mDblCompact(float $dblArrayA[], float $mask[]);
+#undef mel
+
+CREATOR(mDblCompact)
+MStatus mDblCompact::doIt( const MArgList& args )
+{
+    MDoubleArray dblA, mask;
+    unsigned int count;
+	MStatus stat = getArgMask(args, 1, dblA, mask, count);
+	ERROR_FAIL(stat);
+
+	std::vector<unsigned int> offsets;
+	MDoubleArray result(compactOffsets(arrayPtr(mask), count, offsets));
+	compactByMask(arrayPtr(dblA), count, 1, arrayPtr(mask), offsets, arrayPtr(result));
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblWhere
+   Get the indices of all mask values that are not 0.
+
+   Parameters:
+
+		mask - the mask, eg. the result of mDblIsBigger
+
+   Returns:
+
+      The indices in ascending order as a float array, use them with mDblGet, mVecGather ...
+
+*/
+#define mel mDblWhere(float $mask[]);
+#undef mel
+
+CREATOR(mDblWhere)
+MStatus mDblWhere::doIt( const MArgList& args )
+{
+    MDoubleArray mask;
+    unsigned int count;
+	MStatus stat = getArgDbl(args, mask, count);
+	ERROR_FAIL(stat);
+
+	std::vector<unsigned int> offsets;
+	MDoubleArray result(compactOffsets(arrayPtr(mask), count, offsets));
+	compactByMask(NULL, count, 1, arrayPtr(mask), offsets, arrayPtr(result));
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+
 }// namespace
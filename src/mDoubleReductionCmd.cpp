@@ -0,0 +1,333 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// Title: Double Array Reduction Commands
+//
+// About:
+// These commands reduce a whole double array to a few values (sum, mean, range ...) without looping over it in MEL.
+// Big arrays are processed in chunks on several threads, the chunk results are always combined in the same order,
+// so the results don't change with the number of threads.
+//
+// Important conventions:
+// All commands don't change the actual data in place, but create a new output.
+
+
+#include <maya/MDoubleArray.h>
+#include <maya/MArgList.h>
+#include <math.h>
+#include <vector>
+
+#include "../include/mHelperFunctions.h"
+#include "../include/mDoubleReductionCmd.h"
+#include "../include/mArrayAlgorithms.h"
+
+namespace melfunctions
+{
+
+// get the array and the optional compensated summation switch
+static MStatus getArgDblCompensated(const MArgList& args, MDoubleArray &dblA, bool &compensated)
+{
+	compensated = false;
+
+	if ((args.length() != 1) && (args.length() != 2))
+	{
+		MGlobal::displayError("wrong number of arguments, expected a double array and an optional int!");
+		return MS::kFailure;
+	}
+
+	MStatus stat = getDoubleArrayArg(args,0,dblA);
+	ERROR_FAIL(stat);
+
+	if (args.length() == 2)
+	{
+		int c;
+		stat = getIntArg(args,1,c);
+		ERROR_FAIL(stat);
+		compensated = (c != 0);
+	}
+
+	return MS::kSuccess;
+}
+
+
+//************************************************************************************************//
+/*
+   Function: mDblSum
+
+   Sum up all elements of a double array. The sum is built pairwise which keeps the rounding error
+   small even for big arrays, for the highest precision use compensated (Kahan) summation.
+
+   Parameters:
+
+		$dblArrayA - the double array
+		$compensated - (optional) 1 to use compensated summation (slower), default 0
+
+   Returns:
+
+      the sum of all elements as a float[] with a single element
+
+*/
+#define mel mDblSum(float[] $dblArrayA, int $compensated);
+#undef mel
+
+CREATOR(mDblSum)
+MStatus mDblSum::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray dblA;
+    bool compensated;
+	MStatus stat = getArgDblCompensated(args, dblA, compensated);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	double sum;
+	reduceSum(arrayPtr(dblA), dblA.length(), 1, compensated, &sum);
+
+	setResult(MDoubleArray(1,sum));
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblMean
+
+   Get the average of all elements of a double array.
+
+   Parameters:
+
+		$dblArrayA - the double array
+		$compensated - (optional) 1 to use compensated (Kahan) summation (slower), default 0
+
+   Returns:
+
+      the mean value as a float[] with a single element
+
+*/
+#define mel mDblMean(float[] $dblArrayA, int $compensated);
+#undef mel
+
+CREATOR(mDblMean)
+MStatus mDblMean::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray dblA;
+    bool compensated;
+	MStatus stat = getArgDblCompensated(args, dblA, compensated);
+	ERROR_FAIL(stat);
+
+	if (dblA.length() == 0)
+		USER_ERROR_CHECK(MS::kFailure,"mDblMean: the array is empty!");
+
+	// do the actual job
+	double sum;
+	reduceSum(arrayPtr(dblA), dblA.length(), 1, compensated, &sum);
+
+	setResult(MDoubleArray(1,sum / dblA.length()));
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblMinMax
+
+   Get the smallest and the biggest element of a double array.
+
+   Parameters:
+
+		$dblArrayA - the double array
+
+   Returns:
+
+      the minimum and maximum value as a float[] with 2 elements
+
+*/
+#define mel mDblMinMax(float[] $dblArrayA);
+#undef mel
+
+CREATOR(mDblMinMax)
+MStatus mDblMinMax::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray dblA;
+    unsigned int count;
+	MStatus stat = getArgDbl(args, dblA, count);
+	ERROR_FAIL(stat);
+
+	if (count == 0)
+		USER_ERROR_CHECK(MS::kFailure,"mDblMinMax: the array is empty!");
+
+	// do the actual job
+	double min, max;
+	reduceMinMax(arrayPtr(dblA), count, 1, &min, &max);
+
+	MDoubleArray result(2);
+	result[0] = min;
+	result[1] = max;
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblVariance
+
+   Get the (population) variance of the elements of a double array, the square root of it is the
+   standard deviation.
+
+   Parameters:
+
+		$dblArrayA - the double array
+
+   Returns:
+
+      the variance as a float[] with a single element
+
+*/
+#define mel mDblVariance(float[] $dblArrayA);
+#undef mel
+
+CREATOR(mDblVariance)
+MStatus mDblVariance::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray dblA;
+    unsigned int count;
+	MStatus stat = getArgDbl(args, dblA, count);
+	ERROR_FAIL(stat);
+
+	if (count == 0)
+		USER_ERROR_CHECK(MS::kFailure,"mDblVariance: the array is empty!");
+
+	// do the actual job
+	double mean, variance;
+	reduceMeanVariance(arrayPtr(dblA), count, mean, variance);
+
+	setResult(MDoubleArray(1,variance));
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblHistogram
+
+   Count the elements of a double array in equal sized bins between a minimum and a maximum, eg. to
+   bucket particle speeds or ages. Elements outside of the range are not counted, an element equal to
+   the maximum goes into the last bin.
+
+   Parameters:
+
+		$dblArrayA - the double array
+		$bins - the number of bins
+		$min - the start of the range, a single value or one per element (eg. 0)
+		$max - the end of the range, a single value or one per element (eg. the lifespan of each particle)
+
+   Returns:
+
+      the number of elements in each bin as a float[] with $bins elements
+
+*/
+#define mel mDblHistogram(float[] $dblArrayA, int $bins, float[] $min, float[] $max);
+#undef mel
+
+CREATOR(mDblHistogram)
+MStatus mDblHistogram::doIt( const MArgList& args )
+{
+	// get the arguments
+	MStatus stat = argCountCheck(args,4);
+	ERROR_FAIL(stat);
+
+    MDoubleArray dblA, dblMin, dblMax;
+    int bins;
+	stat = getDoubleArrayArg(args,0,dblA);
+	ERROR_ARG(stat,1);
+	stat = getIntArg(args,1,bins);
+	ERROR_ARG(stat,2);
+	stat = getDoubleArrayArg(args,2,dblMin);
+	ERROR_ARG(stat,3);
+	stat = getDoubleArrayArg(args,3,dblMax);
+	ERROR_ARG(stat,4);
+
+	if (bins < 1)
+		USER_ERROR_CHECK(MS::kFailure,"mDblHistogram: the number of bins has to be at least 1!");
+
+	MDoubleArray result(bins, 0.0);
+	if (dblA.length() == 0)
+	{
+		setResult(result);
+		return MS::kSuccess;
+	}
+
+    unsigned int incA, incMin, incMax, count;
+	stat = threeArgCountsValid(dblA.length(), dblMin.length(), dblMax.length(), incA, incMin, incMax, count);
+	ERROR_FAIL(stat);
+
+	if ((incMin == 0) && (incMax == 0) && !(dblMax[0] > dblMin[0]))
+		USER_ERROR_CHECK(MS::kFailure,"mDblHistogram: the maximum has to be bigger than the minimum!");
+
+	// do the actual job
+	std::vector<unsigned int> counts(bins);
+	histogramCounts(arrayPtr(dblA), incA, arrayPtr(dblMin), incMin, arrayPtr(dblMax), incMax, count, bins, &counts[0]);
+
+	for (int i=0;i<bins;i++)
+		result[i] = counts[i];
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDblDigitize
+
+   Get the bin of every element of a double array for a list of ascending bin edges, eg. to turn a particle
+   attribute into instancer indices. Element x goes into bin i when edges[i-1] <= x < edges[i].
+
+   Parameters:
+
+		$dblArrayA - the double array
+		$edges - the bin edges in ascending order
+
+   Returns:
+
+      the bin index of each element as a float[], 0 below the first edge and size($edges) at or above the last one
+
+*/
+#define mel mDblDigitize(float[] $dblArrayA, float[] $edges);
+#undef mel
+
+CREATOR(mDblDigitize)
+MStatus mDblDigitize::doIt( const MArgList& args )
+{
+	// get the arguments
+	MStatus stat = argCountCheck(args,2);
+	ERROR_FAIL(stat);
+
+    MDoubleArray dblA, edges;
+	stat = getDoubleArrayArg(args,0,dblA);
+	ERROR_ARG(stat,1);
+	stat = getDoubleArrayArg(args,1,edges);
+	ERROR_ARG(stat,2);
+
+	for (unsigned int i=1;i<edges.length();i++)
+		if (!(edges[i] >= edges[i-1]))
+			USER_ERROR_CHECK(MS::kFailure,"mDblDigitize: the edges have to be in ascending order!");
+
+	// do the actual job
+	MDoubleArray result(dblA.length());
+	digitize(arrayPtr(dblA), dblA.length(), arrayPtr(edges), edges.length(), arrayPtr(result));
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+}// namespace
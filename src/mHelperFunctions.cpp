@@ -1401,6 +1401,155 @@ MStatus getArgMatDblDblDbl(const MArgList& args, MDoubleArray  & matA,MDoubleArr
 
 
 
+/********************************************************************************************/
+MStatus getArgQuat(const MArgList& args, MDoubleArray  & quatA,  unsigned int &count)
+{
+	// check the argument count
+	MStatus stat = argCountCheck(args,1); 
+	ERROR_FAIL(stat);
+	
+	// get dbl arrays from the arguments
+	stat = getDoubleArrayArg(args,0,quatA);
+	ERROR_FAIL(stat);
+
+	// check if the arguments are valid quaternion arrays
+	stat = quatIsValid(quatA,count);
+	ERROR_ARG(stat,1);
+
+    return stat;
+}
+
+MStatus getArgQuatQuat(const MArgList& args, MDoubleArray  & quatA, MDoubleArray  & quatB,
+                        unsigned int &incA,unsigned int &incB, unsigned int &count)
+{
+	// check the argument count
+	MStatus stat = argCountCheck(args,2); 
+	ERROR_FAIL(stat);
+	
+	// get dbl arrays from the arguments
+	stat = getDoubleArrayArg(args,0,quatA);
+	ERROR_FAIL(stat);
+
+	stat = getDoubleArrayArg(args,1,quatB);
+	ERROR_FAIL(stat);
+
+	// check if the arguments are valid arrays
+	unsigned int numA, numB;
+	stat = quatIsValid(quatA,numA);
+	ERROR_ARG(stat,1);
+
+	stat = quatIsValid(quatB,numB);
+	ERROR_ARG(stat,2);
+
+	// validate the counts and get iterators increasors
+	stat = twoArgCountsValid(numA,numB,incA,incB,count);
+	ERROR_FAIL(stat);
+
+    return MS::kSuccess;
+}
+
+MStatus getArgQuatQuatDbl(const MArgList& args, MDoubleArray  & quatA, MDoubleArray  & quatB, MDoubleArray  & dblC,
+                        unsigned int &incA,unsigned int &incB,unsigned int &incC, unsigned int &count)
+{
+	// check the argument count
+	MStatus stat = argCountCheck(args,3); 
+	ERROR_FAIL(stat);
+	
+	// get dbl arrays from the arguments
+	stat = getDoubleArrayArg(args,0,quatA);
+	ERROR_FAIL(stat);
+
+	stat = getDoubleArrayArg(args,1,quatB);
+	ERROR_FAIL(stat);
+
+	stat = getDoubleArrayArg(args,2,dblC);
+	ERROR_FAIL(stat);
+
+	// check if the arguments are valid arrays
+	unsigned int numA, numB, numC;
+	stat = quatIsValid(quatA,numA);
+	ERROR_ARG(stat,1);
+
+	stat = quatIsValid(quatB,numB);
+	ERROR_ARG(stat,2);
+
+	numC = dblC.length();
+
+	// validate the counts and get iterators increasors
+	stat = threeArgCountsValid(numA,numB,numC,incA,incB,incC,count);
+	ERROR_FAIL(stat);
+
+    return MS::kSuccess;
+}
+
+MStatus getArgVecQuat(const MArgList& args, MDoubleArray  & vecA, MDoubleArray  & quatB,
+                        unsigned int &incA,unsigned int &incB, unsigned int &count)
+{
+	// check the argument count
+	MStatus stat = argCountCheck(args,2); 
+	ERROR_FAIL(stat);
+	
+	// get dbl arrays from the arguments
+	stat = getDoubleArrayArg(args,0,vecA);
+	ERROR_FAIL(stat);
+
+	stat = getDoubleArrayArg(args,1,quatB);
+	ERROR_FAIL(stat);
+
+	// check if the arguments are valid arrays
+	unsigned int numA, numB;
+	stat = vecIsValid(vecA,numA);
+	ERROR_ARG(stat,1);
+
+	stat = quatIsValid(quatB,numB);
+	ERROR_ARG(stat,2);
+
+	// validate the counts and get iterators increasors
+	stat = twoArgCountsValid(numA,numB,incA,incB,count);
+	ERROR_FAIL(stat);
+
+    return MS::kSuccess;
+}
+
+/********************************************************************************************/
+// array of elements with the given number of components (1 double, ELEMENTS_VEC...) and a mask
+// with one value per element, a single mask value is expanded to all elements
+MStatus getArgMask(const MArgList& args, const unsigned int elements, MDoubleArray  & a, MDoubleArray  & mask, unsigned int &count)
+{
+	// check the argument count
+	MStatus stat = argCountCheck(args,2); 
+	ERROR_FAIL(stat);
+	
+	// get dbl arrays from the arguments
+	stat = getDoubleArrayArg(args,0,a);
+	ERROR_FAIL(stat);
+
+	stat = getDoubleArrayArg(args,1,mask);
+	ERROR_FAIL(stat);
+
+	if ((a.length() % elements) != 0)
+	{
+		MString err("float array is not the right size to hold elements of size ");
+		err = err + elements + "!";
+		MGlobal::displayError(err);
+		return MS::kFailure;
+	}
+	count = a.length() / elements;
+
+	if ((mask.length() == 1) && (count != 1))
+		mask = MDoubleArray(count,mask[0]);
+
+	if (mask.length() != count)
+	{
+		MString err("the mask has ");
+		err = err + mask.length() + " values, but the array has " + count + " elements!";
+		MGlobal::displayError(err);
+		return MS::kFailure;
+	}
+
+    return MS::kSuccess;    
+}
+
 }// namespace
 
 
@@ -33,7 +33,9 @@
 
 
 #include "../include/mHelperFunctions.h"
+#include "../include/mArrayStoreCmd.h"
 #include "../include/mMatrixManagementCmd.h"
+#include "../include/mArrayAlgorithms.h"
 
 namespace melfunctions
 {
@@ -326,7 +328,7 @@ MStatus mMatGet::doIt( const MArgList& args )
    Set elements in a matrix array, this function will not grow the matrix array, but error when you try to set an invalid array element!
 
    Parameters:
-		matrixArrayA - base matrix array
+		matrixArrayA - base matrix array, or the name of an mArrayStore object to change in place (its name is returned then)
 		ids	- int array of ids defining where in A to insert B
 		matrixArrayB - matrix array of elements to be inserted into A, must be size 1 or same size than id array
    Returns:
@@ -340,6 +342,16 @@ MStatus mMatGet::doIt( const MArgList& args )
 CREATOR(mMatSet)
 MStatus mMatSet::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetCmd(args, ELEMENTS_MAT, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	unsigned int count = 1;
 
 	MStatus stat = argCountCheck(args,3); 
@@ -404,6 +416,39 @@ MStatus mMatSet::doIt( const MArgList& args )
 }
 
 
+/*
+   Function: mMatCompact
+   Keep only the elements of a matrix array where a mask is not 0, eg. the result of mDblIsBigger.
+
+   Parameters:
+		matrixArrayA - the matrix array
+		mask - the mask, one value per matrix or a single value
+
+   Returns:
+
+      The kept matrices in their original order as a float array of their elements
+
+*/
+#define mel mMatCompact(float $matrixArrayA[], float $mask[]);
+#undef mel
+
+CREATOR(mMatCompact)
+MStatus mMatCompact::doIt( const MArgList& args )
+{
+	MDoubleArray matA, mask;
+	unsigned int count;
+	MStatus stat = getArgMask(args, ELEMENTS_MAT, matA, mask, count);
+	ERROR_FAIL(stat);
+
+	std::vector<unsigned int> offsets;
+	MDoubleArray result = createEmptyMatArray(compactOffsets(arrayPtr(mask), count, offsets));
+	compactByMask(arrayPtr(matA), count, ELEMENTS_MAT, arrayPtr(mask), offsets, arrayPtr(result));
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+
 /*
    Function: mMatGetComponent
 
@@ -470,7 +515,7 @@ MStatus mMatGetComponent::doIt( const MArgList& args )
 
    Parameters:
 
-		$matArray - the matrix array
+		$matArray - the matrix array, or the name of an mArrayStore object to change in place (its name is returned then)
 		$row - the row index [0-3] as an int array
 		$column - the column index [0-3] as an int array
 		$value - the value to insert as an float array
@@ -486,6 +531,16 @@ MStatus mMatGetComponent::doIt( const MArgList& args )
 CREATOR(mMatSetComponent)
 MStatus mMatSetComponent::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetComponentCmd(args, ELEMENTS_MAT, -1, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	// get the arguments
     MDoubleArray dblA, dblB, dblC, dblD;
     unsigned int incA, incB,incC, incD, count;
@@ -30,10 +30,15 @@
 #include <maya/MDoubleArray.h>
 #include <maya/MArgList.h>
 
+#include <string.h>
+#include <vector>
+
 
 
 #include "../include/mHelperFunctions.h"
 #include "../include/mMatrixMathCmd.h"
+#include "../include/mThreadPool.h"
+#include "../include/mMatrixAlgorithms.h"
 
 namespace melfunctions
 {
@@ -138,6 +143,48 @@ MStatus mMatSub::doIt( const MArgList& args )
 	return MS::kSuccess;
 }
 
+// threaded kernel for mMatMult, it reads the matrices straight from the arrays. A broadcast matrix
+// (eg. one parent for many children) is copied onto the stack once, so it stays in registers/L1 and
+// only one array is streamed. Affine pairs skip the products with the known last column.
+struct mMatMultKernel
+{
+	const double *a, *b;
+	unsigned int incA, incB;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		double constA[ELEMENTS_MAT], constB[ELEMENTS_MAT];
+		const double *a0 = a, *b0 = b;
+		unsigned int strideA = ELEMENTS_MAT*incA, strideB = ELEMENTS_MAT*incB;
+
+		if (incA == 0)
+		{
+			memcpy(constA, a, sizeof(constA));
+			a0 = constA;
+		}
+		if (incB == 0)
+		{
+			memcpy(constB, b, sizeof(constB));
+			b0 = constB;
+		}
+		bool affineA = (incA == 0) && matIsAffine(a0);
+		bool affineB = (incB == 0) && matIsAffine(b0);
+
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *ma = a0 + strideA*i;
+			const double *mb = b0 + strideB*i;
+			double *c = out + ELEMENTS_MAT*i;
+
+			if ((affineA || matIsAffine(ma)) && (affineB || matIsAffine(mb)))
+				matMultAffine(ma, mb, c);
+			else
+				matMult(ma, mb, c);
+		}
+	}
+};
+
 /*
    Function: mMatMult
 
@@ -167,27 +214,469 @@ MStatus mMatMult::doIt( const MArgList& args )
 	ERROR_ARG_FAIL(stat);
 
 	// do the actual job
-	unsigned int iterA, iterB;
-	iterA = iterB = 0;
-
-	MMatrix matA,matB,matC;
 	MDoubleArray dblC = createEmptyMatArray(count);
 
+	mMatMultKernel kernel;
+	kernel.a = arrayPtr(dblA);
+	kernel.b = arrayPtr(dblB);
+	kernel.incA = incA;
+	kernel.incB = incB;
+	kernel.out = arrayPtr(dblC);
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
+
+	setResult(dblC);
+	return MS::kSuccess;
+}
+
+// threaded kernel for mMatHierarchy, computes the world matrices of one depth level, the
+// parents are all on the level above and already done
+struct mMatHierarchyKernel
+{
+	const double *local;
+	const double *parent;
+	const unsigned int *nodes;
+	double *world;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+		{
+			unsigned int n = nodes[i];
+			const double *l = local + ELEMENTS_MAT*n;
+			double *w = world + ELEMENTS_MAT*n;
+			int p = (int)parent[n];
+
+			if (p < 0)
+				memcpy(w, l, ELEMENTS_MAT*sizeof(double));
+			else
+			{
+				const double *pw = world + ELEMENTS_MAT*p;
+				if (matIsAffine(l) && matIsAffine(pw))
+					matMultAffine(l, pw, w);
+				else
+					matMult(l, pw, w);
+			}
+		}
+	}
+};
+
+/*
+   Function: mMatHierarchy
+
+   Get the world matrices of a hierarchy (eg. a skeleton, feathers on a body) from the local matrices
+   of its elements in one go. The world matrix of an element is its local matrix times the world matrix
+   of its parent.
+
+   Parameters:
+
+		$matArrayA - the local matrices
+		$parentIndex - the index of the parent of each element in the same array, -1 for the roots
+
+   Returns:
+
+   the world matrices as a float[]
+
+*/
+#define mel mMatHierarchy(float[] $matArrayA, float[] $parentIndex);
+#undef mel
+
+CREATOR(mMatHierarchy)
+MStatus mMatHierarchy::doIt( const MArgList& args )
+{
+	// get the arguments
+	MStatus stat = argCountCheck(args,2);
+	ERROR_FAIL(stat);
+
+	MDoubleArray dblA, dblParent;
+	stat = getDoubleArrayArg(args,0,dblA);
+	ERROR_FAIL(stat);
+	stat = getDoubleArrayArg(args,1,dblParent);
+	ERROR_FAIL(stat);
+
+	unsigned int count;
+	stat = matIsValid(dblA,count);
+	ERROR_ARG(stat,1);
+
+	if (dblParent.length() != count)
+	{
+		MString err = "mMatHierarchy: there are ";
+		err = err + count + " matrices but " + dblParent.length() + " parent indices!";
+		USER_ERROR_CHECK(MS::kFailure,err);
+	}
+
 	for (unsigned int i=0;i<count;i++)
 	{
-		getMatFromArray(dblA,iterA,matA);
-		getMatFromArray(dblB,iterB,matB);
-		matC = matA*matB;
-		setMatToArray(dblC,i,matC);
+		int p = (int)dblParent[i];
+		if ((p < -1) || (p >= (int)count) || (p == (int)i))
+		{
+			MString err = "mMatHierarchy: invalid parent index at index ";
+			err = err + i + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+		dblParent[i] = p;
+	}
 
-		iterA += incA;
-		iterB += incB;
+	// get the depth of every element, walking up until an element with a known depth
+	std::vector<int> depth(count, -1);
+	std::vector<unsigned int> path;
+	unsigned int levels = 0;
+
+	for (unsigned int i=0;i<count;i++)
+	{
+		unsigned int n = i;
+		while ((depth[n] < 0) && (dblParent[n] >= 0))
+		{
+			if (path.size() >= count)
+				USER_ERROR_CHECK(MS::kFailure,"mMatHierarchy: the parent indices contain a cycle!");
+			path.push_back(n);
+			n = (unsigned int)dblParent[n];
+		}
+
+		if (depth[n] < 0)
+			depth[n] = 0;
+		int d = depth[n];
+		while (!path.empty())
+		{
+			depth[path.back()] = ++d;
+			path.pop_back();
+		}
+
+		if ((unsigned int)depth[i] + 1 > levels)
+			levels = depth[i] + 1;
+	}
+
+	// sort the elements by depth (counting sort)
+	std::vector<unsigned int> levelStart(levels + 1, 0);
+	for (unsigned int i=0;i<count;i++)
+		levelStart[depth[i] + 1]++;
+	for (unsigned int l=0;l<levels;l++)
+		levelStart[l + 1] += levelStart[l];
+
+	std::vector<unsigned int> nodes(count);
+	std::vector<unsigned int> pos(levelStart.begin(), levelStart.end() - 1);
+	for (unsigned int i=0;i<count;i++)
+		nodes[pos[depth[i]]++] = i;
+
+	// do the actual job, one level after the other
+	MDoubleArray dblC = createEmptyMatArray(count);
+
+	mMatHierarchyKernel kernel;
+	kernel.local = arrayPtr(dblA);
+	kernel.parent = arrayPtr(dblParent);
+	kernel.world = arrayPtr(dblC);
+
+	for (unsigned int l=0;l<levels;l++)
+	{
+		kernel.nodes = &nodes[levelStart[l]];
+		parallelFor(levelStart[l + 1] - levelStart[l], PARALLEL_GRAIN_MEDIUM, kernel);
 	}
 
 	setResult(dblC);
 	return MS::kSuccess;
 }
 
+// threaded kernel for mMatBlend, all inputs of an element are blended in one go
+// in dual quaternion mode every matrix is split into scale, shear, rotation and translation,
+// the rotation and translation are blended as a dual quaternion, scale and shear linearly
+struct mMatBlendKernel
+{
+	bool dualQuat;
+	std::vector<mArgStream> mats;
+	std::vector<mArgStream> weights;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		const unsigned int inputs = (unsigned int)mats.size();
+
+		for (unsigned int i=begin;i<end;i++)
+		{
+			double *r = out + ELEMENTS_MAT*i;
+
+			if (!dualQuat)
+			{
+				for (unsigned int k=0;k<ELEMENTS_MAT;k++)
+					r[k] = 0.0;
+				for (unsigned int j=0;j<inputs;j++)
+				{
+					const double *m = mats[j].ptr(i);
+					const double w = weights[j][i];
+					for (unsigned int k=0;k<ELEMENTS_MAT;k++)
+						r[k] += w * m[k];
+				}
+				continue;
+			}
+
+			double realSum[4] = { 0.0, 0.0, 0.0, 0.0 };
+			double dualSum[4] = { 0.0, 0.0, 0.0, 0.0 };
+			double scaleSum[3] = { 0.0, 0.0, 0.0 };
+			double shearSum[3] = { 0.0, 0.0, 0.0 };
+			double first[4];
+			double weightSum = 0.0;
+
+			for (unsigned int j=0;j<inputs;j++)
+			{
+				const double *m = mats[j].ptr(i);
+				const double w = weights[j][i];
+
+				double scale[3], shear[3], rot[9], q[4], d[4];
+				matDecompose(m, scale, shear, rot);
+				rotationToQuat(rot, q);
+				quatTranslationToDual(q, m + 12, d);
+
+				// keep all rotations in the hemisphere of the first one so they blend along the shorter arc
+				double wq = w;
+				if (j == 0)
+				{
+					for (unsigned int k=0;k<4;k++)
+						first[k] = q[k];
+				}
+				else if (q[0] * first[0] + q[1] * first[1] + q[2] * first[2] + q[3] * first[3] < 0.0)
+					wq = -w;
+
+				for (unsigned int k=0;k<4;k++)
+				{
+					realSum[k] += wq * q[k];
+					dualSum[k] += wq * d[k];
+				}
+				for (unsigned int k=0;k<3;k++)
+				{
+					scaleSum[k] += w * scale[k];
+					shearSum[k] += w * shear[k];
+				}
+				weightSum += w;
+			}
+
+			// normalize, weights summing up to 0 give the identity
+			double l = sqrt(realSum[0] * realSum[0] + realSum[1] * realSum[1] + realSum[2] * realSum[2] + realSum[3] * realSum[3]);
+			if (l > 0.0)
+			{
+				for (unsigned int k=0;k<4;k++)
+				{
+					realSum[k] /= l;
+					dualSum[k] /= l;
+				}
+			}
+			else
+			{
+				realSum[0] = realSum[1] = realSum[2] = 0.0;
+				realSum[3] = 1.0;
+				dualSum[0] = dualSum[1] = dualSum[2] = dualSum[3] = 0.0;
+			}
+
+			double s = (weightSum != 0.0) ? 1.0 / weightSum : 0.0;
+			for (unsigned int k=0;k<3;k++)
+			{
+				scaleSum[k] *= s;
+				shearSum[k] *= s;
+			}
+
+			double rot[9];
+			quatToRotation(realSum, rot);
+			matCompose(scaleSum, shearSum, rot, r);
+			dualToTranslation(realSum, dualSum, r + 12);
+			r[3] = r[7] = r[11] = 0.0;
+			r[15] = 1.0;
+		}
+	}
+};
+
+/*
+   Function: mMatBlend
+
+   Blend any number of matrix arrays with weight arrays in one go, instead of chaining mMatDblMult and mMatAdd.
+   In the linear mode all values of the matrices are simply summed up with the weights. The dual quaternion mode
+   blends rotation and translation like dual quaternion skinning does, without the shrinking of a linear blend,
+   scale and shear are blended linearly. In this mode the weights are normalized and the result is an affine matrix.
+   All arrays keep the standard broadcast rules (one element or as many as the longest array).
+
+   Parameters:
+
+		$matArrayA, $matArrayB ... - the matrix arrays
+		$weightA, $weightB ... - one weight array for each matrix array, in the same order
+		$mode - optional, 0 (default) linear, 1 dual quaternion
+
+   Returns:
+
+   the blended matrices as a float[]
+
+*/
+#define mel mMatBlend(float[] $matArrayA, float[] $matArrayB, float[] $weightA, float[] $weightB, int $mode);
+#undef mel
+
+CREATOR(mMatBlend)
+MStatus mMatBlend::doIt( const MArgList& args )
+{
+	MStatus stat;
+
+	// an odd number of arguments ends with the mode
+	unsigned int argCount = args.length();
+	int mode = 0;
+	if (argCount % 2)
+	{
+		argCount--;
+		stat = getIntArg(args, argCount, mode);
+		USER_ERROR_CHECK(stat,"mMatBlend: the last argument has to be the blend mode!");
+		if ((mode < 0) || (mode > 1))
+			USER_ERROR_CHECK(MS::kFailure,"mMatBlend: invalid blend mode, use 0 (linear) or 1 (dual quaternion)!");
+	}
+
+	if (argCount < 2)
+		USER_ERROR_CHECK(MS::kFailure,"mMatBlend: needs at least one matrix array and one weight array!");
+
+	// get the arguments, the matrices first, the weights after them
+	const unsigned int inputs = argCount / 2;
+	std::vector<MDoubleArray> mats(inputs), weights(inputs);
+	std::vector<unsigned int> num(argCount);
+	unsigned int count = 0;
+
+	for (unsigned int j=0;j<inputs;j++)
+	{
+		stat = getDoubleArrayArg(args, j, mats[j]);
+		ERROR_FAIL(stat);
+		stat = matIsValid(mats[j], num[j]);
+		ERROR_FAIL(stat);
+
+		stat = getDoubleArrayArg(args, inputs + j, weights[j]);
+		ERROR_FAIL(stat);
+		num[inputs + j] = weights[j].length();
+	}
+
+	for (unsigned int j=0;j<argCount;j++)
+		count = maximum(count, num[j]);
+
+	for (unsigned int j=0;j<argCount;j++)
+	{
+		if ((num[j] != 1) && (num[j] != count))
+		{
+			MString err = "mMatBlend: argument ";
+			err = err + (j + 1) + " has " + num[j] + " elements, it needs 1 or " + count + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+	}
+
+	// do the actual job
+	MDoubleArray result = createEmptyMatArray(count);
+
+	mMatBlendKernel kernel;
+	kernel.dualQuat = (mode == 1);
+	kernel.mats.resize(inputs);
+	kernel.weights.resize(inputs);
+	for (unsigned int j=0;j<inputs;j++)
+	{
+		kernel.mats[j] = mArgStream(mats[j], (num[j] == 1) ? 0 : 1, ELEMENTS_MAT);
+		kernel.weights[j] = mArgStream(weights[j], (num[inputs + j] == 1) ? 0 : 1);
+	}
+	kernel.out = arrayPtr(result);
+	parallelFor(count, kernel.dualQuat ? PARALLEL_GRAIN_HEAVY : PARALLEL_GRAIN_MEDIUM, kernel);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+// threaded kernel for mMatOrthonormalize, replaces the upper 3x3 by its rotation, scaled by the
+// scale of the matrix or by 1 (keeping a mirroring), the translation and the last column stay
+struct mMatOrthonormalizeKernel
+{
+	bool polar;
+	bool preserveScale;
+	const double *in;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *m = in + ELEMENTS_MAT*i;
+			double *r = out + ELEMENTS_MAT*i;
+
+			double scale[3], shear[3], rot[9];
+			matDecompose(m, scale, shear, rot);
+
+			// singular matrices keep the gram schmidt rotation
+			if (polar)
+				matPolarRotation(m, rot);
+
+			if (!preserveScale)
+			{
+				scale[0] = scale[1] = 1.0;
+				scale[2] = (scale[2] < 0.0) ? -1.0 : 1.0;
+			}
+			shear[0] = shear[1] = shear[2] = 0.0;
+
+			memcpy(r, m, ELEMENTS_MAT*sizeof(double));
+			matCompose(scale, shear, rot, r);
+		}
+	}
+};
+
+/*
+   Function: mMatOrthonormalize
+
+   Remove the shear (and optionally the scale) that matrices pick up from accumulated operations and numerical drift.
+   The gram schmidt mode keeps the direction of the x axis and the plane of the x and y axes, the polar mode
+   uses the rotation closest to the matrix, which spreads the correction evenly over all axes.
+   Mirroring matrices stay mirrored (along their z axis), translation and the last column are not changed.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$mode - optional, 0 (default) gram schmidt, 1 polar decomposition
+		$preserveScale - optional, 1 keeps the scale of the matrices (as returned by mMatGetScale), 0 (default) normalizes it
+
+   Returns:
+
+   the orthonormalized matrices as a float[]
+
+*/
+#define mel mMatOrthonormalize(float[] $matArrayA, int $mode, int $preserveScale);
+#undef mel
+
+CREATOR(mMatOrthonormalize)
+MStatus mMatOrthonormalize::doIt( const MArgList& args )
+{
+	MStatus stat;
+	const unsigned int argCount = args.length();
+	if ((argCount < 1) || (argCount > 3))
+		USER_ERROR_CHECK(MS::kFailure,"mMatOrthonormalize: wrong number of arguments, expected 1 to 3!");
+
+	// get the arguments
+	MDoubleArray dblA;
+	stat = getDoubleArrayArg(args,0,dblA);
+	ERROR_FAIL(stat);
+
+	unsigned int count;
+	stat = matIsValid(dblA,count);
+	ERROR_ARG(stat,1);
+
+	int mode = 0, preserveScale = 0;
+	if (argCount > 1)
+	{
+		stat = getIntArg(args,1,mode);
+		ERROR_ARG(stat,2);
+		if ((mode < 0) || (mode > 1))
+			USER_ERROR_CHECK(MS::kFailure,"mMatOrthonormalize: invalid mode, use 0 (gram schmidt) or 1 (polar decomposition)!");
+	}
+	if (argCount > 2)
+	{
+		stat = getIntArg(args,2,preserveScale);
+		ERROR_ARG(stat,3);
+	}
+
+	// do the actual job
+	MDoubleArray result = createEmptyMatArray(count);
+
+	mMatOrthonormalizeKernel kernel;
+	kernel.polar = (mode == 1);
+	kernel.preserveScale = (preserveScale != 0);
+	kernel.in = arrayPtr(dblA);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, kernel.polar ? PARALLEL_GRAIN_HEAVY : PARALLEL_GRAIN_MEDIUM, kernel);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
 /*
    Function: mMatDblMult
 
@@ -390,6 +879,33 @@ MStatus mMatIsEquivalent::doIt( const MArgList& args )
 	return MS::kSuccess;
 }
 
+// threaded kernels for the determinant based commands, they work straight on the array and only
+// hand (close to) singular matrices over to MMatrix so the results for those stay the same
+
+struct mMatIsSingularKernel
+{
+	const double *in;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		double m[4][4];
+
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *a = in + ELEMENTS_MAT*i;
+			double det = matIsAffine(a) ? matDet3x3(a) : matDet4x4(a);
+			if (fabs(det) > MAT_DET_TOLERANCE)
+				out[i] = 0.0;
+			else
+			{
+				memcpy(m, a, sizeof(m));
+				out[i] = MMatrix(m).isSingular();
+			}
+		}
+	}
+};
+
 /*
    Function: mMatIsSingular
 
@@ -422,19 +938,44 @@ MStatus mMatIsSingular::doIt( const MArgList& args )
 	ERROR_FAIL(stat);
 
 
-	MMatrix matA;
 	MDoubleArray dblC = MDoubleArray(count,0);
 
-	for (unsigned int i=0;i<count;i++)
-	{
-		getMatFromArray(dblA,i,matA);
-		dblC[i] = matA.isSingular();
-	}
+	mMatIsSingularKernel kernel;
+	kernel.in = arrayPtr(dblA);
+	kernel.out = arrayPtr(dblC);
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
 
 	setResult(dblC);
 	return MS::kSuccess;
 }
 
+// threaded kernel for mMatInverse, affine matrices (most transforms) take the shortcut of only
+// inverting the 3x3 part
+struct mMatInverseKernel
+{
+	const double *in;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		double m[4][4];
+
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *a = in + ELEMENTS_MAT*i;
+			double *c = out + ELEMENTS_MAT*i;
+
+			bool done = matIsAffine(a) ? matInverseAffine(a, c) : matInverse(a, c);
+			if (!done)
+			{
+				memcpy(m, a, sizeof(m));
+				MMatrix matC = MMatrix(m).inverse();
+				memcpy(c, matC.matrix, sizeof(m));
+			}
+		}
+	}
+};
+
 /*
    Function: mMatInverse
 
@@ -462,15 +1003,12 @@ MStatus mMatInverse::doIt( const MArgList& args )
 	ERROR_FAIL(stat);
 
 	// do the actual job
-	MMatrix matA,matC;
 	MDoubleArray dblC = createEmptyMatArray(count);
 
-	for (unsigned int i=0;i<count;i++)
-	{
-		getMatFromArray(dblA,i,matA);
-		matC = matA.inverse();
-		setMatToArray(dblC,i,matC);
-	}
+	mMatInverseKernel kernel;
+	kernel.in = arrayPtr(dblA);
+	kernel.out = arrayPtr(dblC);
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
 
 	setResult(dblC);
 	return MS::kSuccess;
@@ -558,6 +1096,19 @@ MStatus mMatHomogenize::doIt( const MArgList& args )
 }
 
 
+// threaded kernel for mMatAdjoint
+struct mMatAdjointKernel
+{
+	const double *in;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+			matAdjoint(in + ELEMENTS_MAT*i, out + ELEMENTS_MAT*i);
+	}
+};
+
 /*
    Function: mMatAdjoint
 
@@ -585,20 +1136,34 @@ MStatus mMatAdjoint::doIt( const MArgList& args )
 	ERROR_FAIL(stat);
 
 	// do the actual job
-	MMatrix matA,matC;
 	MDoubleArray dblC = createEmptyMatArray(count);
 
-	for (unsigned int i=0;i<count;i++)
-	{
-		getMatFromArray(dblA,i,matA);
-		matC = matA.adjoint();
-		setMatToArray(dblC,i,matC);
-	}
+	mMatAdjointKernel kernel;
+	kernel.in = arrayPtr(dblA);
+	kernel.out = arrayPtr(dblC);
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
 
 	setResult(dblC);
 	return MS::kSuccess;
 }
 
+// threaded kernel for mMatDet4x4 and mMatDet3x3
+struct mMatDeterminantKernel
+{
+	const double *in;
+	double *out;
+	bool upper3x3;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *a = in + ELEMENTS_MAT*i;
+			out[i] = (upper3x3 || matIsAffine(a)) ? matDet3x3(a) : matDet4x4(a);
+		}
+	}
+};
+
 /*
    Function: mMatDet4x4
 
@@ -625,14 +1190,13 @@ MStatus mMatDet4x4::doIt( const MArgList& args )
 	MStatus stat = getArgMat(args, dblA, count);
 	ERROR_FAIL(stat);
 
-	MMatrix matA;
 	MDoubleArray dblC = MDoubleArray(count,0);
 
-	for (unsigned int i=0;i<count;i++)
-	{
-		getMatFromArray(dblA,i,matA);
-		dblC[i] = matA.det4x4();
-	}
+	mMatDeterminantKernel kernel;
+	kernel.in = arrayPtr(dblA);
+	kernel.out = arrayPtr(dblC);
+	kernel.upper3x3 = false;
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
 
 	setResult(dblC);
 	return MS::kSuccess;
@@ -663,19 +1227,537 @@ MStatus mMatDet3x3::doIt( const MArgList& args )
 	MStatus stat = getArgMat(args, dblA, count);
 	ERROR_FAIL(stat);
 
-	MMatrix matA;
 	MDoubleArray dblC = MDoubleArray(count,0);
 
-	for (unsigned int i=0;i<count;i++)
+	mMatDeterminantKernel kernel;
+	kernel.in = arrayPtr(dblA);
+	kernel.out = arrayPtr(dblC);
+	kernel.upper3x3 = true;
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+
+	setResult(dblC);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************
+// transform components
+//
+// The components follow MTransformationMatrix without pivots: the upper 3x3 of a matrix is
+// scale * shear * rotation, the translation is the last row. Each matrix is decomposed only once
+// (QR on the rows of the 3x3), a mirroring matrix gets a negative z scale.
+
+enum { SRT_TRANSLATION, SRT_ROTATION, SRT_SCALE, SRT_SHEAR };
+enum { SRT_GET, SRT_SET, SRT_ADD };
+
+// threaded kernel for all the mMatGet/Set/Add component commands
+struct mMatSRTKernel
+{
+	mArgStream mat, vec, order;
+	int component;
+	int mode;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
 	{
-		getMatFromArray(dblA,i,matA);
-		dblC[i] = matA.det3x3();
+		double scale[3], shear[3], rot[9];
+
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *a = mat.ptr(i);
+			const double *v = vec.ptr(i);
+
+			if (mode == SRT_GET)
+			{
+				double *c = out + ELEMENTS_VEC*i;
+				if (component == SRT_TRANSLATION)
+				{
+					c[0] = a[12]; c[1] = a[13]; c[2] = a[14];
+					continue;
+				}
+
+				matDecompose(a, scale, shear, rot);
+				if (component == SRT_ROTATION)
+					rotationToEuler(rot, (int)order[i], c);
+				else
+				{
+					const double *p = (component == SRT_SCALE) ? scale : shear;
+					c[0] = p[0]; c[1] = p[1]; c[2] = p[2];
+				}
+				continue;
+			}
+
+			double *c = out + ELEMENTS_MAT*i;
+			memcpy(c, a, ELEMENTS_MAT*sizeof(double));
+
+			if (component == SRT_TRANSLATION)
+			{
+				for (unsigned int k=0;k<3;k++)
+					c[12+k] = (mode == SRT_SET) ? v[k] : a[12+k] + v[k];
+				continue;
+			}
+
+			matDecompose(a, scale, shear, rot);
+			switch (component)
+			{
+				case SRT_ROTATION:
+				{
+					double r[9];
+					eulerToRotation(v, (int)order[i], r);
+					if (mode == SRT_SET)
+						memcpy(rot, r, sizeof(r));
+					else
+					{
+						// the added rotation happens first, in the local space of the matrix
+						double tmp[9];
+						mat3Mult(r, rot, tmp);
+						memcpy(rot, tmp, sizeof(tmp));
+					}
+					break;
+				}
+				case SRT_SCALE:
+					for (unsigned int k=0;k<3;k++)
+						scale[k] = (mode == SRT_SET) ? v[k] : scale[k] * v[k];
+					break;
+				case SRT_SHEAR:
+					for (unsigned int k=0;k<3;k++)
+						shear[k] = (mode == SRT_SET) ? v[k] : shear[k] + v[k];
+					break;
+			}
+			matCompose(scale, shear, rot, c);
+		}
 	}
+};
 
-	setResult(dblC);
+// get the matrix array, the vector array (for set/add) and the optional rotate order array (for rotations),
+// all broadcast against each other
+static MStatus getArgMatSRT(const MArgList& args, const bool withVector, const bool withOrder,
+							MDoubleArray &matA, MDoubleArray &vecB, MDoubleArray &rotOrder,
+							mMatSRTKernel &kernel, unsigned int &count)
+{
+	unsigned int numArgs = withVector ? 2 : 1;
+	if ((args.length() != numArgs) && (!withOrder || (args.length() != numArgs+1)))
+	{
+		MString err = "wrong number of arguments, expected ";
+		err = err + numArgs + (withOrder ? " (and an optional rotate order array)!" : "!");
+		MGlobal::displayError(err);
+		return MS::kFailure;
+	}
+
+	MStatus stat = getDoubleArrayArg(args,0,matA);
+	ERROR_FAIL(stat);
+
+	unsigned int numA, numB = 1, numC = 1;
+	stat = matIsValid(matA,numA);
+	ERROR_ARG(stat,1);
+
+	if (withVector)
+	{
+		stat = getDoubleArrayArg(args,1,vecB);
+		ERROR_FAIL(stat);
+		stat = vecIsValid(vecB,numB);
+		ERROR_ARG(stat,2);
+	}
+	else
+		vecB = MDoubleArray(ELEMENTS_VEC,0.0);
+
+	if (args.length() > numArgs)
+	{
+		stat = getDoubleArrayArg(args,numArgs,rotOrder);
+		ERROR_FAIL(stat);
+		numC = rotOrder.length();
+
+		// verify the rot order is in the proper domain
+		for (unsigned int i=0;i<numC;i++)
+		{
+			int r = (int)rotOrder[i];
+			if ((r < ROTATE_ORDER_XYZ)||(r > ROTATE_ORDER_ZYX))
+			{
+				MString err="rotationOrder error at index ";
+				err = err + i +", not in valid range [0-5]!";
+				USER_ERROR_CHECK(MS::kFailure,err);
+			}
+		}
+	}
+	else
+		rotOrder = MDoubleArray(1,ROTATE_ORDER_XYZ);
+
+	unsigned int incA, incB, incC;
+	stat = threeArgCountsValid(numA,numB,numC,incA,incB,incC,count);
+	ERROR_FAIL(stat);
+
+	kernel.mat = mArgStream(matA, incA, ELEMENTS_MAT);
+	kernel.vec = mArgStream(vecB, incB, ELEMENTS_VEC);
+	kernel.order = mArgStream(rotOrder, incC);
+	return MS::kSuccess;
+}
+
+// shared doIt of the component commands
+static MStatus doMatSRT(const MArgList& args, const int component, const int mode, MDoubleArray &result)
+{
+	MDoubleArray matA, vecB, rotOrder;
+	mMatSRTKernel kernel;
+	unsigned int count;
+	MStatus stat = getArgMatSRT(args, mode != SRT_GET, component == SRT_ROTATION, matA, vecB, rotOrder, kernel, count);
+	ERROR_FAIL(stat);
+
+	result = (mode == SRT_GET) ? createEmptyVecArray(count) : createEmptyMatArray(count);
+
+	kernel.component = component;
+	kernel.mode = mode;
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
+
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatGetTranslation
+
+   Get the translation of the elements of a matrix array.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+
+   Returns:
+
+   the translations as a vector array (float[])
+
+*/
+#define mel mMatGetTranslation(float[] $matArrayA);
+#undef mel
+
+CREATOR(mMatGetTranslation)
+MStatus mMatGetTranslation::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_TRANSLATION, SRT_GET, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatSetTranslation
+
+   Replace the translation of the elements of a matrix array.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$vecArrayB - the new translations
+
+   Returns:
+
+   the changed matrices as a float[]
+
+*/
+#define mel mMatSetTranslation(float[] $matArrayA, float[] $vecArrayB);
+#undef mel
+
+CREATOR(mMatSetTranslation)
+MStatus mMatSetTranslation::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_TRANSLATION, SRT_SET, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatAddTranslation
+
+   Move the elements of a matrix array, the vectors are added to their translation.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$vecArrayB - the translations to add
+
+   Returns:
+
+   the changed matrices as a float[]
+
+*/
+#define mel mMatAddTranslation(float[] $matArrayA, float[] $vecArrayB);
+#undef mel
+
+CREATOR(mMatAddTranslation)
+MStatus mMatAddTranslation::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_TRANSLATION, SRT_ADD, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatGetRotation
+
+   Get the rotation of the elements of a matrix array as euler angles (in radians).
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$rotOrder - (optional) the rotate order, a single value or one per matrix: 0 xyz (default), 1 yzx, 2 zxy, 3 xzy, 4 yxz, 5 zyx
+
+   Returns:
+
+   the euler rotations as a vector array (float[])
+
+*/
+#define mel mMatGetRotation(float[] $matArrayA, float[] $rotOrder);
+#undef mel
+
+CREATOR(mMatGetRotation)
+MStatus mMatGetRotation::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_ROTATION, SRT_GET, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatSetRotation
+
+   Replace the rotation of the elements of a matrix array, scale, shear and translation stay the same.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$vecArrayB - the new euler rotations (in radians)
+		$rotOrder - (optional) the rotate order, a single value or one per matrix: 0 xyz (default), 1 yzx, 2 zxy, 3 xzy, 4 yxz, 5 zyx
+
+   Returns:
+
+   the changed matrices as a float[]
+
+*/
+#define mel mMatSetRotation(float[] $matArrayA, float[] $vecArrayB, float[] $rotOrder);
+#undef mel
+
+CREATOR(mMatSetRotation)
+MStatus mMatSetRotation::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_ROTATION, SRT_SET, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatAddRotation
+
+   Rotate the elements of a matrix array relative to their current rotation (in their local space).
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$vecArrayB - the euler rotations to add (in radians)
+		$rotOrder - (optional) the rotate order, a single value or one per matrix: 0 xyz (default), 1 yzx, 2 zxy, 3 xzy, 4 yxz, 5 zyx
+
+   Returns:
+
+   the changed matrices as a float[]
+
+*/
+#define mel mMatAddRotation(float[] $matArrayA, float[] $vecArrayB, float[] $rotOrder);
+#undef mel
+
+CREATOR(mMatAddRotation)
+MStatus mMatAddRotation::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_ROTATION, SRT_ADD, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatGetScale
+
+   Get the scale of the elements of a matrix array.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+
+   Returns:
+
+   the scales as a vector array (float[])
+
+*/
+#define mel mMatGetScale(float[] $matArrayA);
+#undef mel
+
+CREATOR(mMatGetScale)
+MStatus mMatGetScale::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_SCALE, SRT_GET, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatSetScale
+
+   Replace the scale of the elements of a matrix array, rotation, shear and translation stay the same.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$vecArrayB - the new scales
+
+   Returns:
+
+   the changed matrices as a float[]
+
+*/
+#define mel mMatSetScale(float[] $matArrayA, float[] $vecArrayB);
+#undef mel
+
+CREATOR(mMatSetScale)
+MStatus mMatSetScale::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_SCALE, SRT_SET, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatAddScale
+
+   Scale the elements of a matrix array relative to their current scale (the scales are multiplied).
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$vecArrayB - the scale factors
+
+   Returns:
+
+   the changed matrices as a float[]
+
+*/
+#define mel mMatAddScale(float[] $matArrayA, float[] $vecArrayB);
+#undef mel
+
+CREATOR(mMatAddScale)
+MStatus mMatAddScale::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_SCALE, SRT_ADD, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatGetShear
+
+   Get the shear (xy, xz, yz) of the elements of a matrix array.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+
+   Returns:
+
+   the shears as a vector array (float[])
+
+*/
+#define mel mMatGetShear(float[] $matArrayA);
+#undef mel
+
+CREATOR(mMatGetShear)
+MStatus mMatGetShear::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_SHEAR, SRT_GET, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
 	return MS::kSuccess;
 }
 
+/*
+   Function: mMatSetShear
+
+   Replace the shear (xy, xz, yz) of the elements of a matrix array, rotation, scale and translation stay the same.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$vecArrayB - the new shears
+
+   Returns:
+
+   the changed matrices as a float[]
+
+*/
+#define mel mMatSetShear(float[] $matArrayA, float[] $vecArrayB);
+#undef mel
+
+CREATOR(mMatSetShear)
+MStatus mMatSetShear::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_SHEAR, SRT_SET, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+/*
+   Function: mMatAddShear
+
+   Add to the shear (xy, xz, yz) of the elements of a matrix array.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+		$vecArrayB - the shears to add
+
+   Returns:
+
+   the changed matrices as a float[]
+
+*/
+#define mel mMatAddShear(float[] $matArrayA, float[] $vecArrayB);
+#undef mel
+
+CREATOR(mMatAddShear)
+MStatus mMatAddShear::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = doMatSRT(args, SRT_SHEAR, SRT_ADD, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+
 
 
 
@@ -23,10 +23,12 @@
 #include <maya/MDoubleArray.h>
 #include <maya/MArgList.h>
 #include <math.h>
+#include <algorithm>
 
 #include "../include/mHelperFunctions.h"
 #include "../include/mNoiseCmd.h"
 #include "../include/Noise.h"
+#include "../include/mThreadPool.h"
 
 namespace melfunctions
 {
@@ -38,7 +40,8 @@ int mfSeed = 1;
    Function: mSeed
    Init the melfunctions random number generator. This is the seed used for array generation and will be used
    whenever you are using one of the random number functions. So if you want a different array, you have
-   to reset the seed to a different value.
+   to reset the seed to a different value. It also picks the permutation table of the noise commands that
+   are not given seeds of their own, the default seed 1 gives the classic noise pattern.
 
    Parameters:
 
@@ -324,6 +327,418 @@ MStatus mDblSignedToUnsigned::doIt( const MArgList& args )
 }
 
 
+//************************************************************************************************//
+// threaded kernels used by the noise commands below, see mThreadPool.h
+// every chunk uses its own Noise instance, the samples of a block are grouped by their seed (and for the
+// basis and fractal noise by their basis setup), so each batched noise call works with a single
+// permutation table and the table only changes between groups
+
+// the noise kernels convert their chunk to float in blocks of this many samples for the batched noise calls
+#define NOISE_KERNEL_BLOCK 256
+
+struct mNoiseKey
+{
+	int seed;
+	int setup;
+
+	bool operator<(const mNoiseKey &k) const { return (seed < k.seed) || ((seed == k.seed) && (setup < k.setup)); }
+	bool operator==(const mNoiseKey &k) const { return (seed == k.seed) && (setup == k.setup); }
+};
+
+// orders the samples of a block by their key
+struct mNoiseKeyLess
+{
+	mNoiseKeyLess(const mNoiseKey *k) : keys(k) {}
+	bool operator()(const unsigned int a, const unsigned int b) const { return keys[a] < keys[b]; }
+
+	const mNoiseKey *keys;
+};
+
+// sort the n samples of a block by their key into order, a block with a single key keeps its order
+static void groupNoiseBlock(const mNoiseKey *keys, unsigned int *order, const unsigned int n)
+{
+	bool single = true;
+	for (unsigned int i=0;i<n;i++)
+	{
+		order[i] = i;
+		single = single && (keys[i] == keys[0]);
+	}
+	if (!single)
+		std::stable_sort(order, order + n, mNoiseKeyLess(keys));
+}
+
+// end of the group starting at order[r]
+static unsigned int noiseGroupEnd(const mNoiseKey *keys, const unsigned int *order, const unsigned int r, const unsigned int n)
+{
+	unsigned int e = r + 1;
+	while ((e < n) && (keys[order[e]] == keys[order[r]]))
+		e++;
+	return e;
+}
+
+// improved perlin noise in 1 to 4 dimensions, one argument stream per dimension, optionally periodic
+struct mPerlinNoiseKernel
+{
+	mPerlinNoiseKernel() : periodic(false) {}
+
+	unsigned int dimensions;
+	mArgStream in[4];
+	mArgStream seed;
+	bool periodic;
+	int period[4];
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		Noise noiseGen;
+		float p[4][NOISE_KERNEL_BLOCK];
+		float res[NOISE_KERNEL_BLOCK];
+		unsigned int order[NOISE_KERNEL_BLOCK];
+		mNoiseKey keys[NOISE_KERNEL_BLOCK];
+
+		for (unsigned int start=begin;start<end;start+=NOISE_KERNEL_BLOCK)
+		{
+			const unsigned int n = (end - start < NOISE_KERNEL_BLOCK) ? end - start : NOISE_KERNEL_BLOCK;
+
+			for (unsigned int i=0;i<n;i++)
+			{
+				keys[i].seed = int(seed[start+i]);
+				keys[i].setup = 0;
+			}
+			groupNoiseBlock(keys, order, n);
+
+			for (unsigned int r=0;r<n;)
+			{
+				const unsigned int e = noiseGroupEnd(keys, order, r, n);
+
+				for (unsigned int d=0;d<dimensions;d++)
+					for (unsigned int j=r;j<e;j++)
+						p[d][j-r] = float(in[d][start+order[j]]);
+
+				noiseGen.reshufflePermutationTable(keys[order[r]].seed);
+
+				if (periodic)
+				{
+					switch (dimensions)
+					{
+						case 1:
+							noiseGen.improvedPerlin1dS(p[0], res, e - r, period);
+							break;
+						case 2:
+							noiseGen.improvedPerlin2dS(p[0], p[1], res, e - r, period);
+							break;
+						case 3:
+							noiseGen.improvedPerlin3dS(p[0], p[1], p[2], res, e - r, period);
+							break;
+						default:
+							noiseGen.improvedPerlin4dS(p[0], p[1], p[2], p[3], res, e - r, period);
+							break;
+					}
+				}
+				else
+				{
+					switch (dimensions)
+					{
+						case 1:
+							noiseGen.improvedPerlin1dS(p[0], res, e - r);
+							break;
+						case 2:
+							noiseGen.improvedPerlin2dS(p[0], p[1], res, e - r);
+							break;
+						case 3:
+							noiseGen.improvedPerlin3dS(p[0], p[1], p[2], res, e - r);
+							break;
+						default:
+							noiseGen.improvedPerlin4dS(p[0], p[1], p[2], p[3], res, e - r);
+							break;
+					}
+				}
+
+				for (unsigned int j=r;j<e;j++)
+					out[start+order[j]] = res[j-r];
+
+				r = e;
+			}
+		}
+	}
+};
+
+// noise vector, 3 values per element, each one is the noise at an offset sample position (see Noise::noiseVector)
+struct mNoiseVectorKernel
+{
+	mArgStream in[3];
+	mArgStream seed;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		static const float offset[3][3] = { { 9.321f, -1.531f, -7.951f }, { 0.0f, 0.0f, 0.0f }, { 6.327f, 0.1671f, -2.672f } };
+
+		Noise noiseGen;
+		float p[3][NOISE_KERNEL_BLOCK];
+		float q[3][NOISE_KERNEL_BLOCK];
+		float res[NOISE_KERNEL_BLOCK];
+		unsigned int order[NOISE_KERNEL_BLOCK];
+		mNoiseKey keys[NOISE_KERNEL_BLOCK];
+
+		for (unsigned int start=begin;start<end;start+=NOISE_KERNEL_BLOCK)
+		{
+			const unsigned int n = (end - start < NOISE_KERNEL_BLOCK) ? end - start : NOISE_KERNEL_BLOCK;
+
+			for (unsigned int i=0;i<n;i++)
+			{
+				keys[i].seed = int(seed[start+i]);
+				keys[i].setup = 0;
+			}
+			groupNoiseBlock(keys, order, n);
+
+			for (unsigned int r=0;r<n;)
+			{
+				const unsigned int e = noiseGroupEnd(keys, order, r, n);
+
+				for (unsigned int d=0;d<3;d++)
+					for (unsigned int j=r;j<e;j++)
+						p[d][j-r] = float(in[d][start+order[j]]);
+
+				noiseGen.reshufflePermutationTable(keys[order[r]].seed);
+
+				for (unsigned int c=0;c<ELEMENTS_VEC;c++)
+				{
+					for (unsigned int d=0;d<3;d++)
+						for (unsigned int j=0;j<e-r;j++)
+							q[d][j] = p[d][j] + offset[c][d];
+
+					noiseGen.improvedPerlin3dS(q[0], q[1], q[2], res, e - r);
+
+					for (unsigned int j=r;j<e;j++)
+						out[ELEMENTS_VEC*(start+order[j]) + c] = res[j-r];
+				}
+
+				r = e;
+			}
+		}
+	}
+};
+
+// turbulence, scalar or vector, the octave count is truncated to int. the samples of a block are grouped by
+// their seed, noise basis and hard flag, the octave counts, lacunarity and gain can differ within a group
+struct mTurbulenceKernel
+{
+	bool vector;
+	mArgStream in[3];
+	mArgStream octaves;
+	mArgStream basis;
+	mArgStream hard;
+	mArgStream lacunarity;
+	mArgStream gain;
+	mArgStream seed;
+	double *out;
+
+	mNoiseKey key(const unsigned int i) const
+	{
+		mNoiseKey k;
+		k.seed = int(seed[i]);
+		k.setup = int(basis[i]) * 2 + ((hard[i] != 0.0) ? 1 : 0);
+		return k;
+	}
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		Noise noiseGen;
+		float p[3][NOISE_KERNEL_BLOCK];
+		float q[3][NOISE_KERNEL_BLOCK];
+		float res[3][NOISE_KERNEL_BLOCK];
+		unsigned int order[NOISE_KERNEL_BLOCK];
+		mNoiseKey keys[NOISE_KERNEL_BLOCK];
+
+		for (unsigned int start=begin;start<end;start+=NOISE_KERNEL_BLOCK)
+		{
+			const unsigned int n = (end - start < NOISE_KERNEL_BLOCK) ? end - start : NOISE_KERNEL_BLOCK;
+
+			for (unsigned int i=0;i<n;i++)
+				keys[i] = key(start+i);
+			groupNoiseBlock(keys, order, n);
+
+			// one batched call per group
+			for (unsigned int r=0;r<n;)
+			{
+				const unsigned int e = noiseGroupEnd(keys, order, r, n);
+
+				for (unsigned int j=r;j<e;j++)
+				{
+					const unsigned int i = start + order[j];
+					for (unsigned int d=0;d<3;d++)
+						p[d][j-r] = float(in[d][i]);
+					q[0][j-r] = float(int(octaves[i]));
+					q[1][j-r] = float(lacunarity[i]);
+					q[2][j-r] = float(gain[i]);
+				}
+
+				const unsigned int first = start + order[r];
+				noiseGen.reshufflePermutationTable(keys[order[r]].seed);
+
+				if (vector)
+				{
+					noiseGen.turbulenceVector(p[0], p[1], p[2], q[0], q[1], q[2], res[0], res[1], res[2], e - r,
+											  hard[first] != 0.0, int(basis[first]));
+
+					for (unsigned int j=r;j<e;j++)
+					{
+						double *v = out + ELEMENTS_VEC*(start + order[j]);
+						v[0] = res[0][j-r];
+						v[1] = res[1][j-r];
+						v[2] = res[2][j-r];
+					}
+				}
+				else
+				{
+					noiseGen.turbulence3dS(p[0], p[1], p[2], q[0], q[1], q[2], res[0], e - r, hard[first] != 0.0, int(basis[first]));
+
+					for (unsigned int j=r;j<e;j++)
+						out[start + order[j]] = res[0][j-r];
+				}
+
+				r = e;
+			}
+		}
+	}
+};
+
+// split a vector array argument into its three component streams
+static void vecArgStreams(MDoubleArray &vecA, const unsigned int incA, mArgStream in[3])
+{
+	for (unsigned int c=0;c<ELEMENTS_VEC;c++)
+		in[c] = mArgStream(vecA, incA, ELEMENTS_VEC, c);
+}
+
+// the first numArrays arguments of a noise command, the first one is a vector array if vector is set, the others
+// are double arrays, all of them with 1 or count elements, inc is 0 for the single element ones
+static MStatus getNoiseArrays(const MArgList& args, const char *cmd, const unsigned int numArrays, const bool vector,
+							  MDoubleArray *arrays, unsigned int *inc, unsigned int &count)
+{
+	MStatus stat;
+	unsigned int num[4];
+	count = 0;
+
+	for (unsigned int j=0;j<numArrays;j++)
+	{
+		stat = getDoubleArrayArg(args, j, arrays[j]);
+		ERROR_FAIL(stat);
+
+		if ((j == 0) && vector)
+		{
+			stat = vecIsValid(arrays[0], num[0]);
+			ERROR_ARG(stat,1);
+		}
+		else
+			num[j] = arrays[j].length();
+
+		count = maximum(count, num[j]);
+	}
+
+	for (unsigned int j=0;j<numArrays;j++)
+	{
+		if ((num[j] != 1) && (num[j] != count))
+		{
+			MString err = cmd;
+			err = err + ": argument " + (j + 1) + " has " + num[j] + " elements, it needs 1 or " + count + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+		inc[j] = (num[j] == 1) ? 0 : 1;
+	}
+
+	return MS::kSuccess;
+}
+
+// an optional array argument at argIndex with one value or one per sample, without it (or with an empty one)
+// all samples use the default value, name is used in the error message
+static MStatus getBroadcastArg(const MArgList& args, const unsigned int argIndex, const char *cmd, const char *name,
+							   const unsigned int count, const double defaultValue, MDoubleArray &values, mArgStream &stream)
+{
+	if (argIndex < args.length())
+	{
+		MStatus stat = getDoubleArrayArg(args, argIndex, values);
+		ERROR_FAIL(stat);
+
+		if (values.length() == 0)
+			values = MDoubleArray(1, defaultValue);
+		else if ((values.length() != 1) && (values.length() != count))
+		{
+			MString err = cmd;
+			err = err + ": the " + name + " array has " + values.length() + " elements, it needs 1 or " + count + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+	}
+	else
+		values = MDoubleArray(1, defaultValue);
+
+	stream = mArgStream(values, (values.length() == 1) ? 0 : 1);
+	return MS::kSuccess;
+}
+
+// the optional seed array of a noise command at argument argIndex, with one seed or one per sample,
+// without it (or with an empty one) all samples use the seed set by mSeed
+static MStatus getSeedArg(const MArgList& args, const unsigned int argIndex, const char *cmd, const unsigned int count,
+						  MDoubleArray &seeds, mArgStream &stream)
+{
+	return getBroadcastArg(args, argIndex, cmd, "seed", count, mfSeed, seeds, stream);
+}
+
+// the optional period array of the perlin noise commands at argument argIndex, with one period for all
+// axes or one per axis, truncated to int, 0 leaves an axis unbounded
+static MStatus getPeriodArg(const MArgList& args, const unsigned int argIndex, const char *cmd, mPerlinNoiseKernel &kernel)
+{
+	if (argIndex >= args.length())
+		return MS::kSuccess;
+
+	MDoubleArray periods;
+	MStatus stat = getDoubleArrayArg(args, argIndex, periods);
+	ERROR_FAIL(stat);
+
+	if ((periods.length() != 1) && (periods.length() != kernel.dimensions))
+	{
+		MString err = cmd;
+		err = err + ": the period array has " + periods.length() + " elements, it needs 1 or " + kernel.dimensions + "!";
+		USER_ERROR_CHECK(MS::kFailure,err);
+	}
+
+	for (unsigned int d=0;d<kernel.dimensions;d++)
+	{
+		kernel.period[d] = int(periods[(periods.length() == 1) ? 0 : d]);
+		if (kernel.period[d] < 0)
+		{
+			MString err = cmd;
+			err = err + ": invalid period " + kernel.period[d] + ", it has to be 0 (not periodic) or more!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+	}
+
+	kernel.periodic = true;
+	return MS::kSuccess;
+}
+
+// the frequency grows with every octave, beyond this many the float sample positions have no precision left,
+// the limit also keeps a huge count from blocking the worker threads
+#define NOISE_MAX_OCTAVES 30
+
+// the per sample octave counts of the fractal and turbulence commands have to be between 0 and NOISE_MAX_OCTAVES,
+// checked on the doubles, before anything converts them to int
+static MStatus octavesValid(const MDoubleArray &octaves, const char *cmd)
+{
+	for (unsigned int i=0;i<octaves.length();i++)
+	{
+		if (!((octaves[i] >= 0.0) && (octaves[i] <= NOISE_MAX_OCTAVES)))
+		{
+			MString err = cmd;
+			err = err + ": the octave count has to be between 0 and " + NOISE_MAX_OCTAVES + ", it is " + octaves[i] + " at index " + i + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+	}
+
+	return MS::kSuccess;
+}
+
+
 //************************************************************************************************//
 /*
    Function: mDbl1dNoise 
@@ -333,33 +748,49 @@ MStatus mDblSignedToUnsigned::doIt( const MArgList& args )
    Parameters:
 
 		$dblArrayA - the double array
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed (also when empty)
+		$period - optional, the lattice wraps every period cells along an axis so the noise tiles, one for all axes or one per axis, 0 leaves an axis unbounded
 
    Returns:
 
 		noise values as a float[]
 
 */
-#define mel mDbl1dNoise(float[] $dblArrayA);
+#define mel mDbl1dNoise(float[] $dblArrayA, int[] $seeds, int[] $period);
 #undef mel
 
 CREATOR(mDbl1dNoise)
 MStatus mDbl1dNoise::doIt( const MArgList& args )
 {
+	mPerlinNoiseKernel kernel;
+	kernel.dimensions = 1;
+
+	MDoubleArray arrays[1], seeds;
+	unsigned int inc[1], count;
+
+	if ((args.length() < 1) || (args.length() > 3))
+	{
+		USER_ERROR_CHECK(MS::kFailure,("mDbl1dNoise: wrong number of arguments, should be 1 dblArray, an optional seed array and an optional period array!"));
+	}
+
 	// get the arguments
-    MDoubleArray dblA;
-    unsigned int count;
-	MStatus stat = getArgDbl(args, dblA, count);
+	MStatus stat = getNoiseArrays(args, "mDbl1dNoise", 1, false, arrays, inc, count);
 	ERROR_FAIL(stat);
-    
+
+	kernel.in[0] = mArgStream(arrays[0], inc[0]);
+
+	stat = getSeedArg(args, 1, "mDbl1dNoise", count, seeds, kernel.seed);
+	ERROR_FAIL(stat);
+
+	stat = getPeriodArg(args, 2, "mDbl1dNoise", kernel);
+	ERROR_FAIL(stat);
+
 	// do the actual job
-	Noise noiseGen;
-    
-	for (unsigned int i=0;i<dblA.length();i++)
-	{
-        dblA[i] = noiseGen.improvedPerlin1dS(float(dblA[i]));
-	}
+	MDoubleArray result(count);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
 
-	setResult(dblA);
+	setResult(result);
 	return MS::kSuccess;
 }
 
@@ -374,10 +805,12 @@ MStatus mDbl1dNoise::doIt( const MArgList& args )
 		
 		$dblArrayA - the double array with sample values for dimension 1
         $dblArrayB - the double array with sample values for dimension 2
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed (also when empty)
+		$period - optional, the lattice wraps every period cells along an axis so the noise tiles, one for all axes or one per axis, 0 leaves an axis unbounded
         
         OR - .
         
-        $uvArray - single uv array with the sample values
+        $uvArray - single uv array with the sample values, uses the mSeed seed
         
 
    Returns:
@@ -385,60 +818,54 @@ MStatus mDbl1dNoise::doIt( const MArgList& args )
 		noise values as a float[]
 
 */
-#define mel mDbl2dNoise(float[] $dblArrayA,float[] $dblArrayB);
+#define mel mDbl2dNoise(float[] $dblArrayA,float[] $dblArrayB, int[] $seeds, int[] $period);
 #undef mel
 
 CREATOR(mDbl2dNoise)
 MStatus mDbl2dNoise::doIt( const MArgList& args )
 {
+	mPerlinNoiseKernel kernel;
+	kernel.dimensions = 2;
+
+	MDoubleArray arrays[2], seeds;
+	unsigned int inc[2], count;
+	MStatus stat;
+
 	if (args.length() == 1)
 	{
 		// get the arguments
-    	MDoubleArray dblA;
-	    unsigned int count;
-		MStatus stat = getArgUV(args, dblA, count);
+		stat = getArgUV(args, arrays[0], count);
 		ERROR_FAIL(stat);
-    
-		// do the job
-		MDoubleArray result = MDoubleArray(count);		
 
-        Noise noiseGen;
-        for(int i=0;i<count;i++)
-	    	result[i] = noiseGen.improvedPerlin2dS(float(dblA[i*ELEMENTS_UV]), float(dblA[i*ELEMENTS_UV+1]));
-            
-        setResult(result);
-        
+		kernel.in[0] = mArgStream(arrays[0], 1, ELEMENTS_UV, 0);
+		kernel.in[1] = mArgStream(arrays[0], 1, ELEMENTS_UV, 1);
 	}
-	else if (args.length() == 2)
+	else if ((args.length() >= 2) && (args.length() <= 4))
 	{
 		// get the arguments
-	    MDoubleArray dblA, dblB;
-    	unsigned int incA, incB, count;
-		MStatus stat = getArgDblDbl(args, dblA, dblB, incA, incB, count);
+		stat = getNoiseArrays(args, "mDbl2dNoise", 2, false, arrays, inc, count);
 		ERROR_FAIL(stat);
-	
-		// do the actual job
-		unsigned int iterA, iterB;
-		iterA = iterB = 0;
-
-		MDoubleArray result(count);
-		Noise noiseGen;
-
-		for (unsigned int i=0;i<count;i++)
-		{
-        	result[i] = noiseGen.improvedPerlin2dS(float(dblA[iterA]), float(dblB[iterB]));
 
-			iterA += incA;
-			iterB += incB;
-		}
-		
-        setResult(result);
+		kernel.in[0] = mArgStream(arrays[0], inc[0]);
+		kernel.in[1] = mArgStream(arrays[1], inc[1]);
 	}
 	else
 	{
-		USER_ERROR_CHECK(MS::kFailure,("mDbl2dNoise: wrong number of arguments, should be 1 uvArray or 2 dblArrays!"));
+		USER_ERROR_CHECK(MS::kFailure,("mDbl2dNoise: wrong number of arguments, should be 1 uvArray or 2 dblArrays, an optional seed array and an optional period array!"));
 	}
-    
+
+	stat = getSeedArg(args, 2, "mDbl2dNoise", count, seeds, kernel.seed);
+	ERROR_FAIL(stat);
+
+	stat = getPeriodArg(args, 3, "mDbl2dNoise", kernel);
+	ERROR_FAIL(stat);
+
+	// do the job
+	MDoubleArray result(count);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
+
+	setResult(result);
 	return MS::kSuccess;
 
 }
@@ -455,10 +882,14 @@ MStatus mDbl2dNoise::doIt( const MArgList& args )
 		$dblArrayA - the double array with sample values for dimension 1
         $dblArrayB - the double array with sample values for dimension 2
         $dblArrayC - the double array with sample values for dimension 3
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed (also when empty)
+		$period - optional, the lattice wraps every period cells along an axis so the noise tiles, one for all axes or one per axis, 0 leaves an axis unbounded
+			a period only for the third axis ({0,0,n}) gives 2d noise looping every n units of time
         
         OR - .
         
         $vecArray - single vector array with the sample values
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
         
 
    Returns:
@@ -466,65 +897,57 @@ MStatus mDbl2dNoise::doIt( const MArgList& args )
 		noise values as a float[]
 
 */
-#define mel mDbl3dNoise(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC);
+#define mel mDbl3dNoise(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC, int[] $seeds, int[] $period);
 #undef mel
 
 CREATOR(mDbl3dNoise)
 MStatus mDbl3dNoise::doIt( const MArgList& args )
 {
-	if (args.length() == 1)
+	mPerlinNoiseKernel kernel;
+	kernel.dimensions = 3;
+
+	MDoubleArray arrays[3], seeds;
+	unsigned int inc[3], count, numArrays;
+	MStatus stat;
+
+	if ((args.length() == 1) || (args.length() == 2))
 	{
     	// vector array
 		// get the arguments
-    	MDoubleArray dblA;
-	    unsigned int count;
-		MStatus stat = getArgVec(args, dblA, count);
+		numArrays = 1;
+		stat = getNoiseArrays(args, "mDbl3dNoise", numArrays, true, arrays, inc, count);
 		ERROR_FAIL(stat);
-    
-		// do the job
-		MDoubleArray result = MDoubleArray(count);		
 
-        Noise noiseGen;
-        for(int i=0;i<count;i++)
-        {
-        	int id = ELEMENTS_VEC *i;
-	    	result[i] = noiseGen.improvedPerlin3dS(float(dblA[id]), float(dblA[id+1]),float(dblA[id+2]));
-        }
-            
-        setResult(result);
-        
+		vecArgStreams(arrays[0], inc[0], kernel.in);
 	}
-	else if (args.length() == 3)
+	else if ((args.length() >= 3) && (args.length() <= 5))
 	{
 		// get the arguments
-	    MDoubleArray dblA, dblB, dblC;
-    	unsigned int incA, incB, incC, count;
-		MStatus stat = getArgDblDblDbl(args, dblA, dblB, dblC, incA, incB, incC, count);
+		numArrays = 3;
+		stat = getNoiseArrays(args, "mDbl3dNoise", numArrays, false, arrays, inc, count);
 		ERROR_FAIL(stat);
-	
-		// do the actual job
-		unsigned int iterA, iterB, iterC;
-		iterA = iterB = iterC = 0;
-
-		MDoubleArray result(count);
-		Noise noiseGen;
-
-		for (unsigned int i=0;i<count;i++)
-		{
-        	result[i] = noiseGen.improvedPerlin3dS(float(dblA[iterA]), float(dblB[iterB]),  float(dblC[iterC]));
 
-			iterA += incA;
-			iterB += incB;
-			iterC += incC;            
-		}
-		
-        setResult(result);
+		kernel.in[0] = mArgStream(arrays[0], inc[0]);
+		kernel.in[1] = mArgStream(arrays[1], inc[1]);
+		kernel.in[2] = mArgStream(arrays[2], inc[2]);
 	}
 	else
 	{
-		USER_ERROR_CHECK(MS::kFailure,("mDbl3dNoise: wrong number of arguments, should be 1 vecArray or 3 dblArrays!"));
+		USER_ERROR_CHECK(MS::kFailure,("mDbl3dNoise: wrong number of arguments, should be 1 vecArray and an optional seed array or 3 dblArrays, an optional seed array and an optional period array!"));
 	}
-    
+
+	stat = getSeedArg(args, numArrays, "mDbl3dNoise", count, seeds, kernel.seed);
+	ERROR_FAIL(stat);
+
+	stat = getPeriodArg(args, numArrays + 1, "mDbl3dNoise", kernel);
+	ERROR_FAIL(stat);
+
+	// do the job
+	MDoubleArray result(count);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
+
+	setResult(result);
 	return MS::kSuccess;
 
 }
@@ -542,81 +965,74 @@ MStatus mDbl3dNoise::doIt( const MArgList& args )
         $dblArrayB - the double array with sample values for dimension 2
         $dblArrayC - the double array with sample values for dimension 3
         $dblArrayT - the double array with sample values for dimension 4
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed (also when empty)
+		$period - optional, the lattice wraps every period cells along an axis so the noise tiles, one for all axes or one per axis, 0 leaves an axis unbounded
+			a period only for the time axis ({0,0,0,n}) loops the 3d noise every n units of time, much cheaper than sampling 4d noise on a torus
         
         OR - .
         
         $vecArray - single vector array with the sample values
         $dblArrayT - the double array with sample values for dimension 4        
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
 
    Returns:
 
 		noise values as a float[]
 
 */
-#define mel mDbl4dNoise(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC,float[] $dblArrayT);
+#define mel mDbl4dNoise(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC,float[] $dblArrayT, int[] $seeds, int[] $period);
 #undef mel
 
 CREATOR(mDbl4dNoise)
 MStatus mDbl4dNoise::doIt( const MArgList& args )
 {
-	if (args.length() == 2)
+	mPerlinNoiseKernel kernel;
+	kernel.dimensions = 4;
+
+	MDoubleArray arrays[4], seeds;
+	unsigned int inc[4], count, numArrays;
+	MStatus stat;
+
+	if ((args.length() == 2) || (args.length() == 3))
 	{
     	// vector array and single value
 		// get the arguments
-    	MDoubleArray dblA,dblD;
-	    unsigned int iterA, iterD, incA,incD,count;
-        iterA=iterD=0;
-		MStatus stat = getArgVecDbl(args, dblA,dblD,incA,incD, count);
+		numArrays = 2;
+		stat = getNoiseArrays(args, "mDbl4dNoise", numArrays, true, arrays, inc, count);
 		ERROR_FAIL(stat);
-    
-		// do the job
-		MDoubleArray result = MDoubleArray(count);		
 
-        Noise noiseGen;
-        for(int i=0;i<count;i++)
-        {
-        	int id = ELEMENTS_VEC *iterA;
-	    	result[i] = noiseGen.improvedPerlin4dS(float(dblA[id]), float(dblA[id+1]),float(dblA[id+2]),float(dblD[iterD]));
-            
-            iterD += incD;
-            iterA += incA;
-        }
-            
-        setResult(result);
-        
+		vecArgStreams(arrays[0], inc[0], kernel.in);
+		kernel.in[3] = mArgStream(arrays[1], inc[1]);
 	}
-	else if (args.length() == 4)
+	else if ((args.length() >= 4) && (args.length() <= 6))
 	{
 		// get the arguments
-	    MDoubleArray dblA, dblB, dblC, dblD;
-    	unsigned int incA, incB, incC, incD, count;
-		MStatus stat = getArgDblDblDblDbl(args, dblA, dblB, dblC, dblD, incA, incB, incC, incD, count);
+		numArrays = 4;
+		stat = getNoiseArrays(args, "mDbl4dNoise", numArrays, false, arrays, inc, count);
 		ERROR_FAIL(stat);
-	
-		// do the actual job
-		unsigned int iterA, iterB, iterC, iterD;
-		iterA = iterB = iterC = iterD = 0;
-
-		MDoubleArray result(count);
-		Noise noiseGen;
-
-		for (unsigned int i=0;i<count;i++)
-		{
-        	result[i] = noiseGen.improvedPerlin4dS(float(dblA[iterA]), float(dblB[iterB]),  float(dblC[iterC]),  float(dblD[iterD]));
 
-			iterA += incA;
-			iterB += incB;
-			iterC += incC;            
-			iterD += incD;                        
-		}
-		
-        setResult(result);
+		kernel.in[0] = mArgStream(arrays[0], inc[0]);
+		kernel.in[1] = mArgStream(arrays[1], inc[1]);
+		kernel.in[2] = mArgStream(arrays[2], inc[2]);
+		kernel.in[3] = mArgStream(arrays[3], inc[3]);
 	}
 	else
 	{
-		USER_ERROR_CHECK(MS::kFailure,("mDbl4dNoise: wrong number of arguments, should be 1 vecArray and 1 dblArray or 4 dblArrays!"));
+		USER_ERROR_CHECK(MS::kFailure,("mDbl4dNoise: wrong number of arguments, should be 1 vecArray, 1 dblArray and an optional seed array or 4 dblArrays, an optional seed array and an optional period array!"));
 	}
-    
+
+	stat = getSeedArg(args, numArrays, "mDbl4dNoise", count, seeds, kernel.seed);
+	ERROR_FAIL(stat);
+
+	stat = getPeriodArg(args, numArrays + 1, "mDbl4dNoise", kernel);
+	ERROR_FAIL(stat);
+
+	// do the job
+	MDoubleArray result(count);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
+
+	setResult(result);
 	return MS::kSuccess;
 
 }
@@ -633,10 +1049,12 @@ MStatus mDbl4dNoise::doIt( const MArgList& args )
 		$dblArrayA - the double array with sample values for dimension 1
         $dblArrayB - the double array with sample values for dimension 2
         $dblArrayC - the double array with sample values for dimension 3
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
         
         OR - .
         
         $vecArray - single vector array with the sample values
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
         
 
    Returns:
@@ -644,284 +1062,1125 @@ MStatus mDbl4dNoise::doIt( const MArgList& args )
 		noise vector as a float[]
 
 */
-#define mel mVec3dNoise(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC);
+#define mel mVec3dNoise(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC, int[] $seeds);
 #undef mel
 
 CREATOR(mVec3dNoise)
 MStatus mVec3dNoise::doIt( const MArgList& args )
 {
-	if (args.length() == 1)
+	mNoiseVectorKernel kernel;
+
+	MDoubleArray arrays[3], seeds;
+	unsigned int inc[3], count, numArrays;
+	MStatus stat;
+
+	if ((args.length() == 1) || (args.length() == 2))
 	{
     	// vector array
 		// get the arguments
-    	MDoubleArray dblA;
-	    unsigned int count;
-		MStatus stat = getArgVec(args, dblA, count);
+		numArrays = 1;
+		stat = getNoiseArrays(args, "mVec3dNoise", numArrays, true, arrays, inc, count);
 		ERROR_FAIL(stat);
-    
-		// do the job
-		MDoubleArray result = MDoubleArray(count*ELEMENTS_VEC);		
 
-        Noise noiseGen;
-        float v[3];
-        
-        for(int i=0;i<count;i++)
-        {
-        	int id = ELEMENTS_VEC *i;
-            noiseGen.noiseVector(float (dblA[id]), float(dblA[id+1]),float(dblA[id+2]), NOISE_IMPROVED_PERLIN, v);
-			result[id] = v[0];
-			result[id+1] = v[1];
-			result[id+2] = v[2];                        
-        }
-            
-        setResult(result);
-        
+		vecArgStreams(arrays[0], inc[0], kernel.in);
 	}
-	else if (args.length() == 3)
+	else if ((args.length() == 3) || (args.length() == 4))
 	{
 		// get the arguments
-	    MDoubleArray dblA, dblB, dblC;
-    	unsigned int incA, incB, incC, count;
-		MStatus stat = getArgDblDblDbl(args, dblA, dblB, dblC, incA, incB, incC, count);
+		numArrays = 3;
+		stat = getNoiseArrays(args, "mVec3dNoise", numArrays, false, arrays, inc, count);
 		ERROR_FAIL(stat);
-	
-		// do the actual job
-		unsigned int iterA, iterB, iterC;
-		iterA = iterB = iterC = 0;
 
-		MDoubleArray result = MDoubleArray(count*ELEMENTS_VEC);	
-		Noise noiseGen;
-		float v[3];
-         
-		for (unsigned int i=0;i<count;i++)
-		{
-        	noiseGen.noiseVector(float(dblA[iterA]), float(dblB[iterB]),  float(dblC[iterC]),NOISE_IMPROVED_PERLIN, v);
-			
-            int id = ELEMENTS_VEC *i;
-            
-            result[id] = v[0];
-			result[id+1] = v[1];
-			result[id+2] = v[2];
-            
-			iterA += incA;
-			iterB += incB;
-			iterC += incC;            
-		}
-		
-        setResult(result);
+		kernel.in[0] = mArgStream(arrays[0], inc[0]);
+		kernel.in[1] = mArgStream(arrays[1], inc[1]);
+		kernel.in[2] = mArgStream(arrays[2], inc[2]);
 	}
 	else
 	{
-		USER_ERROR_CHECK(MS::kFailure,("mVec3dNoise: wrong number of arguments, should be 1 vecArray or 3 dblArrays!"));
+		USER_ERROR_CHECK(MS::kFailure,("mVec3dNoise: wrong number of arguments, should be 1 vecArray or 3 dblArrays and an optional seed array!"));
 	}
-    
-	return MS::kSuccess;
 
-}
+	stat = getSeedArg(args, numArrays, "mVec3dNoise", count, seeds, kernel.seed);
+	ERROR_FAIL(stat);
 
+	// do the job
+	MDoubleArray result = MDoubleArray(count*ELEMENTS_VEC);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
 
+	setResult(result);
+	return MS::kSuccess;
 
-//************************************************************************************************//
-/*
-   Function: mDbl3dTurbulence
+}
 
-   Create turbulence based on Improved Perlin noise in 3 dimensions [-1 to 1]
+// shared argument handling of the turbulence commands, the double array form takes the optional
+// basis, hard, lacunarity and gain arrays after the seeds
+static MStatus turbulenceCmd(const MArgList& args, const char *cmd, mTurbulenceKernel &kernel, MDoubleArray &result)
+{
+	MDoubleArray arrays[4], seeds, basis, hard, lacunarity, gain;
+	unsigned int inc[4], count, numArrays;
+	MStatus stat;
 
-   Parameters:
+	if ((args.length() == 2) || (args.length() == 3))
+	{
+    	// vector array
+		// get the arguments
+		numArrays = 2;
+		stat = getNoiseArrays(args, cmd, numArrays, true, arrays, inc, count);
+		ERROR_FAIL(stat);
 
+		vecArgStreams(arrays[0], inc[0], kernel.in);
+		kernel.octaves = mArgStream(arrays[1], inc[1]);
+	}
+	else if ((args.length() >= 4) && (args.length() <= 9))
+	{
+		// get the arguments
+		numArrays = 4;
+		stat = getNoiseArrays(args, cmd, numArrays, false, arrays, inc, count);
+		ERROR_FAIL(stat);
 
-		$dblArrayA - the double array with sample values for dimension 1
-        $dblArrayB - the double array with sample values for dimension 2
-        $dblArrayC - the double array with sample values for dimension 3
+		kernel.in[0] = mArgStream(arrays[0], inc[0]);
+		kernel.in[1] = mArgStream(arrays[1], inc[1]);
+		kernel.in[2] = mArgStream(arrays[2], inc[2]);
+		kernel.octaves = mArgStream(arrays[3], inc[3]);
+	}
+	else
+	{
+		MString err = cmd;
+		err += ": wrong number of arguments, should be 1 vecArray + 1 dblArray and an optional seed array or 4 dblArrays and the optional seed, basis, hard, lacunarity and gain arrays!";
+		USER_ERROR_CHECK(MS::kFailure,err);
+	}
 
-        $dblArrayO - the double array with the number of octaves (will be truncated to int)
+	stat = getSeedArg(args, numArrays, cmd, count, seeds, kernel.seed);
+	ERROR_FAIL(stat);
+	stat = getBroadcastArg(args, numArrays + 1, cmd, "basis", count, NOISE_IMPROVED_PERLIN, basis, kernel.basis);
+	ERROR_FAIL(stat);
+	stat = getBroadcastArg(args, numArrays + 2, cmd, "hard", count, 0.0, hard, kernel.hard);
+	ERROR_FAIL(stat);
+	stat = getBroadcastArg(args, numArrays + 3, cmd, "lacunarity", count, 2.0, lacunarity, kernel.lacunarity);
+	ERROR_FAIL(stat);
+	stat = getBroadcastArg(args, numArrays + 4, cmd, "gain", count, 0.5, gain, kernel.gain);
+	ERROR_FAIL(stat);
+
+	for (unsigned int i=0;i<basis.length();i++)
+	{
+		const int v = int(basis[i]);
+		if ((v < NOISE_IMPROVED_PERLIN) || (v > NOISE_BLENDER))
+		{
+			MString err = cmd;
+			err = err + ": invalid noise basis " + v + " at index " + i + ", use " + NOISE_IMPROVED_PERLIN + " to " + NOISE_BLENDER + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+	}
+
+	// the octave array is the last of the sample arrays
+	stat = octavesValid(arrays[numArrays - 1], cmd);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	result = MDoubleArray(kernel.vector ? count*ELEMENTS_VEC : count);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
+
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDbl3dTurbulence
+
+   Create turbulence based on any of the noise basis functions in 3 dimensions [-1 to 1], improved perlin by default
+
+   Parameters:
+
+
+		$dblArrayA - the double array with sample values for dimension 1
+        $dblArrayB - the double array with sample values for dimension 2
+        $dblArrayC - the double array with sample values for dimension 3
+
+        $dblArrayO - the double array with the number of octaves (0 to 30, will be truncated to int)
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+		$basis - optional, the noise basis (see <mDbl3dBasisNoise>), defaults to 1
+		$hard - optional, non zero for hard turbulence, defaults to 0
+		$lacunarity - optional, the frequency scale from one octave to the next, defaults to 2
+		$gain - optional, the amplitude scale from one octave to the next, defaults to 0.5
+		(all of them one for all or one per element)
                 
         OR - .
         
         $vecArray - single vector array with the sample values
-        $dblArrayO - the double array with the number of octaves (will be truncated to int)        
+        $dblArrayO - the double array with the number of octaves (0 to 30, will be truncated to int)        
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
 
    Returns:
 
 		noise values as a float[]
 
 */
-#define mel mDbl3dTurbulence(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC,float[] $dblArrayO);
+#define mel mDbl3dTurbulence(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC,float[] $dblArrayO, int[] $seeds, int[] $basis, int[] $hard, float[] $lacunarity, float[] $gain);
 #undef mel
 
 CREATOR(mDbl3dTurbulence)
 MStatus mDbl3dTurbulence::doIt( const MArgList& args )
 {
-	if (args.length() == 2)
-	{
-    	// vector array
-		// get the arguments
-	    MDoubleArray dblA, dblB;
-    	unsigned int incA, incB, count;
-		MStatus stat = getArgVecDbl(args, dblA, dblB, incA, incB, count);
-		ERROR_FAIL(stat);
-	
-		// do the actual job
-		unsigned int iterA, iterB;
-		iterA = iterB = 0;
+	mTurbulenceKernel kernel;
+	kernel.vector = false;
 
-		MDoubleArray result(count);
-		Noise noiseGen;
+	MDoubleArray result;
+	MStatus stat = turbulenceCmd(args, "mDbl3dTurbulence", kernel, result);
+	ERROR_FAIL(stat);
 
-        for(int i=0;i<count;i++)
-        {
-        	int id = ELEMENTS_VEC *iterA;
-	    	result[i] = noiseGen.turbulence3dS(float(dblA[id]), float(dblA[id+1]),float(dblA[id+2]),int(dblB[iterB]),false,NOISE_IMPROVED_PERLIN);
+	setResult(result);
+	return MS::kSuccess;
 
-            iterA += incA;
-            iterB += incB;            
-        }
-            
-        setResult(result);
+}
+
+//************************************************************************************************//
+/*
+   Function: mVec3dTurbulence
+
+   Create turbulence vector based on any of the noise basis functions in 3 dimensions, improved perlin by default
+
+   Parameters:
+
+
+		$dblArrayA - the double array with sample values for dimension 1
+        $dblArrayB - the double array with sample values for dimension 2
+        $dblArrayC - the double array with sample values for dimension 3
+
+        $dblArrayO - the double array with the number of octaves (0 to 30, will be truncated to int)
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+		$basis - optional, the noise basis (see <mDbl3dBasisNoise>), defaults to 1
+		$hard - optional, non zero for hard turbulence, defaults to 0
+		$lacunarity - optional, the frequency scale from one octave to the next, defaults to 2
+		$gain - optional, the amplitude scale from one octave to the next, defaults to 0.5
+		(all of them one for all or one per element)
+                
+        OR - .
         
+        $vecArray - single vector array with the sample values
+        $dblArrayO - the double array with the number of octaves (0 to 30, will be truncated to int)        
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+
+   Returns:
+
+		noise values as a float[]
+
+*/
+#define mel mVec3dTurbulence(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC,float[] $dblArrayO, int[] $seeds, int[] $basis, int[] $hard, float[] $lacunarity, float[] $gain);
+#undef mel
+
+CREATOR(mVec3dTurbulence)
+MStatus mVec3dTurbulence::doIt( const MArgList& args )
+{
+	mTurbulenceKernel kernel;
+	kernel.vector = true;
+
+	MDoubleArray result;
+	MStatus stat = turbulenceCmd(args, "mVec3dTurbulence", kernel, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+
+}
+
+//************************************************************************************************//
+// basis and fractal noise commands
+
+#define NOISE_CMD_BASIS					0
+#define NOISE_CMD_FBM					1
+#define NOISE_CMD_MULTIFRACTAL			2
+#define NOISE_CMD_HETEROTERRAIN			3
+#define NOISE_CMD_HYBRIDMULTIFRACTAL	4
+#define NOISE_CMD_RIDGEDMULTIFRACTAL	5
+#define NOISE_CMD_VLNOISE				6
+
+// the vector array, up to 5 parameter arrays, 2 basis arrays and the distance metric array
+#define NOISE_CMD_MAX_ARRAYS 9
+
+// threaded kernel for the basis and fractal noise, the samples of a block are grouped by their seed, noise basis
+// and distance metric so every batched noise call has a fixed setup, broadcast ones form a single group
+struct mFractalNoiseKernel
+{
+	int function;
+	unsigned int numParams;
+	mArgStream in[3];
+	mArgStream param[5];
+	mArgStream basis[2];
+	mArgStream metric;
+	mArgStream seed;
+	float exponent;
+	double *out;
+
+	mNoiseKey key(const unsigned int i) const
+	{
+		mNoiseKey k;
+		k.seed = int(seed[i]);
+		k.setup = (int(basis[0][i]) * 16 + int(basis[1][i])) * 16 + int(metric[i]);
+		return k;
 	}
-	else if (args.length() == 4)
+
+	void evaluate(Noise &noiseGen, float p[3][NOISE_KERNEL_BLOCK], float q[5][NOISE_KERNEL_BLOCK], float *res, const unsigned int n,
+				  const int basis1, const int basis2, const int distanceMetric)
 	{
-		// get the arguments
-	    MDoubleArray dblA, dblB, dblC,dblD;
-    	unsigned int incA, incB, incC, incD, count;
-		MStatus stat = getArgDblDblDblDbl(args, dblA, dblB, dblC,dblD, incA, incB, incC, incD,count);
-		ERROR_FAIL(stat);
-	
-		// do the actual job
-		unsigned int iterA, iterB, iterC,iterD;
-		iterA = iterB = iterC =iterD = 0;
+		switch (function)
+		{
+			case NOISE_CMD_FBM:
+				noiseGen.musgraveFBmS(p[0], p[1], p[2], q[0], q[1], q[2], res, n, basis1, distanceMetric, exponent);
+				break;
+			case NOISE_CMD_MULTIFRACTAL:
+				noiseGen.musgraveMultiFractalS(p[0], p[1], p[2], q[0], q[1], q[2], res, n, basis1, distanceMetric, exponent);
+				break;
+			case NOISE_CMD_HETEROTERRAIN:
+				noiseGen.musgraveHeteroTerrainS(p[0], p[1], p[2], q[0], q[1], q[2], q[3], res, n, basis1, distanceMetric, exponent);
+				break;
+			case NOISE_CMD_HYBRIDMULTIFRACTAL:
+				noiseGen.musgraveHybridMultiFractalS(p[0], p[1], p[2], q[0], q[1], q[2], q[3], q[4], res, n, basis1, distanceMetric, exponent);
+				break;
+			case NOISE_CMD_RIDGEDMULTIFRACTAL:
+				noiseGen.musgraveRidgedMultiFractalS(p[0], p[1], p[2], q[0], q[1], q[2], q[3], q[4], res, n, basis1, distanceMetric, exponent);
+				break;
+			case NOISE_CMD_VLNOISE:
+				noiseGen.musgraveVLNoiseS(p[0], p[1], p[2], q[0], res, n, basis1, basis2, distanceMetric, exponent);
+				break;
+			default:
+				noiseGen.noise3dS(p[0], p[1], p[2], res, n, basis1, distanceMetric, exponent);
+				break;
+		}
+	}
 
-		MDoubleArray result(count);
+	void operator()(unsigned int begin, unsigned int end)
+	{
 		Noise noiseGen;
+		float p[3][NOISE_KERNEL_BLOCK];
+		float q[5][NOISE_KERNEL_BLOCK];
+		float res[NOISE_KERNEL_BLOCK];
+		unsigned int order[NOISE_KERNEL_BLOCK];
+		mNoiseKey keys[NOISE_KERNEL_BLOCK];
 
-		for (unsigned int i=0;i<count;i++)
+		for (unsigned int start=begin;start<end;start+=NOISE_KERNEL_BLOCK)
 		{
-        	result[i] = noiseGen.turbulence3dS(float(dblA[iterA]), float(dblB[iterB]),  float(dblC[iterC]), int(dblD[iterD]),false,NOISE_IMPROVED_PERLIN);
+			const unsigned int n = (end - start < NOISE_KERNEL_BLOCK) ? end - start : NOISE_KERNEL_BLOCK;
+
+			// group the block
+			for (unsigned int i=0;i<n;i++)
+				keys[i] = key(start+i);
+			groupNoiseBlock(keys, order, n);
+
+			// one batched call per group
+			for (unsigned int r=0;r<n;)
+			{
+				const unsigned int e = noiseGroupEnd(keys, order, r, n);
+
+				for (unsigned int j=r;j<e;j++)
+				{
+					const unsigned int i = start + order[j];
+					for (unsigned int d=0;d<3;d++)
+						p[d][j-r] = float(in[d][i]);
+					for (unsigned int k=0;k<numParams;k++)
+						q[k][j-r] = float(param[k][i]);
+				}
+
+				const unsigned int first = start + order[r];
+				noiseGen.reshufflePermutationTable(keys[order[r]].seed);
+				evaluate(noiseGen, p, q, res, e - r, int(basis[0][first]), int(basis[1][first]), int(metric[first]));
+
+				for (unsigned int j=r;j<e;j++)
+					out[start + order[j]] = res[j-r];
+
+				r = e;
+			}
+		}
+	}
+};
 
-			iterA += incA;
-			iterB += incB;
-			iterC += incC;            
-			iterD += incD;                        
+// shared argument handling and evaluation of the basis and fractal noise commands:
+// a vector array with the sample positions, numParams parameter arrays, then optional numBasis noise basis arrays,
+// the distance metric array, the minkovsky exponent and the seeds, all arrays can hold one value or one per sample
+static MStatus fractalNoiseCmd(const MArgList& args, const char *cmd, const int function, const unsigned int numParams,
+							   const unsigned int numBasis, MDoubleArray &result)
+{
+	MStatus stat;
+
+	const unsigned int argCount = args.length();
+	const unsigned int minArgs = 1 + numParams;
+	const unsigned int numArrays = minArgs + numBasis + 1;
+
+	if ((argCount < minArgs) || (argCount > numArrays + 2))
+	{
+		MString err = cmd;
+		err = err + ": wrong number of arguments, needs a vecArray and " + numParams + " dblArrays, optional " + numBasis + " basis, the distance metric, the exponent and the seeds!";
+		USER_ERROR_CHECK(MS::kFailure,err);
+	}
+
+	// get the arrays, the missing ones use improved perlin and the real distance
+	MDoubleArray arrays[NOISE_CMD_MAX_ARRAYS];
+	unsigned int num[NOISE_CMD_MAX_ARRAYS];
+	unsigned int count = 0;
+
+	for (unsigned int j=0;j<numArrays;j++)
+	{
+		if (j < argCount)
+		{
+			stat = getDoubleArrayArg(args, j, arrays[j]);
+			ERROR_FAIL(stat);
 		}
-		
-        setResult(result);
+		else
+			arrays[j] = MDoubleArray(1, (j < minArgs + numBasis) ? NOISE_IMPROVED_PERLIN : VORONOI_DIST_REAL);
+
+		if (j == 0)
+		{
+			stat = vecIsValid(arrays[0], num[0]);
+			ERROR_ARG(stat,1);
+		}
+		else
+			num[j] = arrays[j].length();
+
+		count = maximum(count, num[j]);
 	}
-	else
+
+	for (unsigned int j=0;j<numArrays;j++)
 	{
-		USER_ERROR_CHECK(MS::kFailure,("mDbl3dTurbulence: wrong number of arguments, should be 1 vecArray + 1 dblArray or 4 dblArrays!"));
+		if ((num[j] != 1) && (num[j] != count))
+		{
+			MString err = cmd;
+			err = err + ": argument " + (j + 1) + " has " + num[j] + " elements, it needs 1 or " + count + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
 	}
-    
+
+	// valid bases and distance metrics
+	for (unsigned int j=minArgs;j<numArrays;j++)
+	{
+		const bool isBasis = (j < minArgs + numBasis);
+		const int lo = isBasis ? NOISE_IMPROVED_PERLIN : VORONOI_DIST_REAL;
+		const int hi = isBasis ? NOISE_BLENDER : VORONOI_DIST_MINKOVSKY4;
+
+		for (unsigned int i=0;i<num[j];i++)
+		{
+			const int v = int(arrays[j][i]);
+			if ((v < lo) || (v > hi))
+			{
+				MString err = cmd;
+				err = err + (isBasis ? ": invalid noise basis " : ": invalid distance metric ") + v + " at index " + i + ", use " + lo + " to " + hi + "!";
+				USER_ERROR_CHECK(MS::kFailure,err);
+			}
+		}
+	}
+
+	// the musgrave functions take H, lacunarity and the octaves as their first parameters
+	if ((function != NOISE_CMD_BASIS) && (function != NOISE_CMD_VLNOISE))
+	{
+		stat = octavesValid(arrays[3], cmd);
+		ERROR_FAIL(stat);
+	}
+
+	double exponent = 2.5;
+	if (argCount > numArrays)
+	{
+		stat = getDoubleArg(args, numArrays, exponent);
+		ERROR_ARG(stat,numArrays + 1);
+	}
+
+	// do the job
+	mFractalNoiseKernel kernel;
+	MDoubleArray seeds;
+	stat = getSeedArg(args, numArrays + 1, cmd, count, seeds, kernel.seed);
+	ERROR_FAIL(stat);
+
+	kernel.function = function;
+	kernel.numParams = numParams;
+	vecArgStreams(arrays[0], (num[0] == 1) ? 0 : 1, kernel.in);
+	for (unsigned int k=0;k<numParams;k++)
+		kernel.param[k] = mArgStream(arrays[1+k], (num[1+k] == 1) ? 0 : 1);
+	kernel.basis[0] = mArgStream(arrays[minArgs], (num[minArgs] == 1) ? 0 : 1);
+	kernel.basis[1] = (numBasis == 2) ? mArgStream(arrays[minArgs+1], (num[minArgs+1] == 1) ? 0 : 1) : kernel.basis[0];
+	kernel.metric = mArgStream(arrays[numArrays-1], (num[numArrays-1] == 1) ? 0 : 1);
+	kernel.exponent = float(exponent);
+
+	result = MDoubleArray(count);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
+
 	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDbl3dBasisNoise
+
+   Sample any of the noise basis functions in 3 dimensions [-1 to 1]
+
+   Parameters:
+
+		$vecArray - vector array with the sample positions
+		$basis - optional, the noise basis, defaults to 1
+			1 - improved perlin
+			2 - voronoi F1 (distance to the closest feature point)
+			3 - voronoi F2
+			4 - voronoi F3
+			5 - voronoi F4
+			6 - voronoi F2-F1
+			7 - voronoi crackle
+			8 - cell noise
+			9 - blender noise
+		$distanceMetric - optional, the distance metric of the voronoi bases, defaults to 0
+			0 - real
+			1 - squared
+			2 - manhattan
+			3 - chebychev
+			4 - minkovsky (with the exponent)
+			5 - minkovsky 0.5
+			6 - minkovsky 4
+		$exponent - optional, the exponent of the minkovsky distance, defaults to 2.5
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+
+   Returns:
+
+		noise values as a float[]
 
+*/
+#define mel mDbl3dBasisNoise(float[] $vecArray, int[] $basis, int[] $distanceMetric, float $exponent, int[] $seeds);
+#undef mel
+
+CREATOR(mDbl3dBasisNoise)
+MStatus mDbl3dBasisNoise::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = fractalNoiseCmd(args, "mDbl3dBasisNoise", NOISE_CMD_BASIS, 0, 1, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
 }
 
 //************************************************************************************************//
 /*
-   Function: mVec3dTurbulence
+   Function: mDbl3dFBm
 
-   Create turbulence vector based on Improved Perlin noise in 3 dimensions
+   Fractional brownian motion, the noise basis summed over several octaves (after Musgrave)
 
    Parameters:
 
+		$vecArray - vector array with the sample positions
+		$H - the fractal increment, the amplitude falls by lacunarity^-H per octave
+		$lacunarity - the frequency gap between successive octaves
+		$octaves - the number of octaves (0 to 30), the fractional part blends in the last one
+		$basis - optional, the noise basis (see <mDbl3dBasisNoise>), defaults to 1
+		$distanceMetric - optional, the voronoi distance metric (see <mDbl3dBasisNoise>), defaults to 0
+		$exponent - optional, the exponent of the minkovsky distance, defaults to 2.5
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
 
-		$dblArrayA - the double array with sample values for dimension 1
-        $dblArrayB - the double array with sample values for dimension 2
-        $dblArrayC - the double array with sample values for dimension 3
+   Returns:
 
-        $dblArrayO - the double array with the number of octaves (will be truncated to int)
-                
-        OR - .
-        
-        $vecArray - single vector array with the sample values
-        $dblArrayO - the double array with the number of octaves (will be truncated to int)        
+		noise values as a float[]
+
+*/
+#define mel mDbl3dFBm(float[] $vecArray, float[] $H, float[] $lacunarity, float[] $octaves, int[] $basis, int[] $distanceMetric, float $exponent, int[] $seeds);
+#undef mel
+
+CREATOR(mDbl3dFBm)
+MStatus mDbl3dFBm::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = fractalNoiseCmd(args, "mDbl3dFBm", NOISE_CMD_FBM, 3, 1, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDbl3dMultiFractal
+
+   Multifractal, the octaves of the noise basis are multiplied instead of summed (after Musgrave)
+
+   Parameters:
+
+		$vecArray - vector array with the sample positions
+		$H - the fractal increment, the amplitude falls by lacunarity^-H per octave
+		$lacunarity - the frequency gap between successive octaves
+		$octaves - the number of octaves (0 to 30), the fractional part blends in the last one
+		$basis - optional, the noise basis (see <mDbl3dBasisNoise>), defaults to 1
+		$distanceMetric - optional, the voronoi distance metric (see <mDbl3dBasisNoise>), defaults to 0
+		$exponent - optional, the exponent of the minkovsky distance, defaults to 2.5
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
 
    Returns:
 
 		noise values as a float[]
 
 */
-#define mel mVec3dTurbulence(float[] $dblArrayA,float[] $dblArrayB,float[] $dblArrayC,float[] $dblArrayO);
+#define mel mDbl3dMultiFractal(float[] $vecArray, float[] $H, float[] $lacunarity, float[] $octaves, int[] $basis, int[] $distanceMetric, float $exponent, int[] $seeds);
 #undef mel
 
-CREATOR(mVec3dTurbulence)
-MStatus mVec3dTurbulence::doIt( const MArgList& args )
+CREATOR(mDbl3dMultiFractal)
+MStatus mDbl3dMultiFractal::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = fractalNoiseCmd(args, "mDbl3dMultiFractal", NOISE_CMD_MULTIFRACTAL, 3, 1, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDbl3dHeteroTerrain
+
+   Heterogeneous terrain, the octaves are scaled by the value so far (after Musgrave)
+
+   Parameters:
+
+		$vecArray - vector array with the sample positions
+		$H - the fractal increment, the amplitude falls by lacunarity^-H per octave
+		$lacunarity - the frequency gap between successive octaves
+		$octaves - the number of octaves (0 to 30), the fractional part blends in the last one
+		$offset - raises the terrain from 'sea level'
+		$basis - optional, the noise basis (see <mDbl3dBasisNoise>), defaults to 1
+		$distanceMetric - optional, the voronoi distance metric (see <mDbl3dBasisNoise>), defaults to 0
+		$exponent - optional, the exponent of the minkovsky distance, defaults to 2.5
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+
+   Returns:
+
+		noise values as a float[]
+
+*/
+#define mel mDbl3dHeteroTerrain(float[] $vecArray, float[] $H, float[] $lacunarity, float[] $octaves, float[] $offset, int[] $basis, int[] $distanceMetric, float $exponent, int[] $seeds);
+#undef mel
+
+CREATOR(mDbl3dHeteroTerrain)
+MStatus mDbl3dHeteroTerrain::doIt( const MArgList& args )
 {
-	if (args.length() == 2)
+	MDoubleArray result;
+	MStatus stat = fractalNoiseCmd(args, "mDbl3dHeteroTerrain", NOISE_CMD_HETEROTERRAIN, 4, 1, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDbl3dHybridMultiFractal
+
+   Hybrid additive/multiplicative multifractal terrain (after Musgrave), good values to start with are H 0.25 and offset 0.7
+
+   Parameters:
+
+		$vecArray - vector array with the sample positions
+		$H - the fractal increment, the amplitude falls by lacunarity^-H per octave
+		$lacunarity - the frequency gap between successive octaves
+		$octaves - the number of octaves (0 to 30), the fractional part blends in the last one
+		$offset - the offset added to the noise basis
+		$gain - the gain of the octave weights
+		$basis - optional, the noise basis (see <mDbl3dBasisNoise>), defaults to 1
+		$distanceMetric - optional, the voronoi distance metric (see <mDbl3dBasisNoise>), defaults to 0
+		$exponent - optional, the exponent of the minkovsky distance, defaults to 2.5
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+
+   Returns:
+
+		noise values as a float[]
+
+*/
+#define mel mDbl3dHybridMultiFractal(float[] $vecArray, float[] $H, float[] $lacunarity, float[] $octaves, float[] $offset, float[] $gain, int[] $basis, int[] $distanceMetric, float $exponent, int[] $seeds);
+#undef mel
+
+CREATOR(mDbl3dHybridMultiFractal)
+MStatus mDbl3dHybridMultiFractal::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = fractalNoiseCmd(args, "mDbl3dHybridMultiFractal", NOISE_CMD_HYBRIDMULTIFRACTAL, 5, 1, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDbl3dRidgedMultiFractal
+
+   Ridged multifractal terrain (after Musgrave), good values to start with are H 1, offset 1 and gain 2
+
+   Parameters:
+
+		$vecArray - vector array with the sample positions
+		$H - the fractal increment, the amplitude falls by lacunarity^-H per octave
+		$lacunarity - the frequency gap between successive octaves
+		$octaves - the number of octaves (0 to 30, truncated to int)
+		$offset - the offset the ridges are subtracted from
+		$gain - the gain of the octave weights
+		$basis - optional, the noise basis (see <mDbl3dBasisNoise>), defaults to 1
+		$distanceMetric - optional, the voronoi distance metric (see <mDbl3dBasisNoise>), defaults to 0
+		$exponent - optional, the exponent of the minkovsky distance, defaults to 2.5
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+
+   Returns:
+
+		noise values as a float[]
+
+*/
+#define mel mDbl3dRidgedMultiFractal(float[] $vecArray, float[] $H, float[] $lacunarity, float[] $octaves, float[] $offset, float[] $gain, int[] $basis, int[] $distanceMetric, float $exponent, int[] $seeds);
+#undef mel
+
+CREATOR(mDbl3dRidgedMultiFractal)
+MStatus mDbl3dRidgedMultiFractal::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = fractalNoiseCmd(args, "mDbl3dRidgedMultiFractal", NOISE_CMD_RIDGEDMULTIFRACTAL, 5, 1, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mDbl3dVLNoise
+
+   Variable lacunarity noise, the domain of one noise basis distorted by another one (after Musgrave)
+
+   Parameters:
+
+		$vecArray - vector array with the sample positions
+		$distortion - the amount of distortion
+		$basis1 - optional, the noise basis of the distortion (see <mDbl3dBasisNoise>), defaults to 1
+		$basis2 - optional, the noise basis sampled in the distorted domain, defaults to 1
+		$distanceMetric - optional, the voronoi distance metric (see <mDbl3dBasisNoise>), defaults to 0
+		$exponent - optional, the exponent of the minkovsky distance, defaults to 2.5
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+
+   Returns:
+
+		noise values as a float[]
+
+*/
+#define mel mDbl3dVLNoise(float[] $vecArray, float[] $distortion, int[] $basis1, int[] $basis2, int[] $distanceMetric, float $exponent, int[] $seeds);
+#undef mel
+
+CREATOR(mDbl3dVLNoise)
+MStatus mDbl3dVLNoise::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = fractalNoiseCmd(args, "mDbl3dVLNoise", NOISE_CMD_VLNOISE, 1, 2, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+// noise gradient and curl noise commands
+
+// improved perlin summed over octaves (doubling the frequency and halving the amplitude per octave) with its
+// analytic gradient, either the gradient itself or the curl of a vector potential made of three such fields
+// at offset sample positions (the offsets of Noise::noiseVector), which gives a divergence free field
+
+struct mNoiseGradientKernel
+{
+	bool curl;
+	int octaves;
+	mArgStream in[3];
+	mArgStream seed;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
 	{
-    	// vector array
-		// get the arguments
-	    MDoubleArray dblA, dblB;
-    	unsigned int incA, incB, count;
-		MStatus stat = getArgVecDbl(args, dblA, dblB, incA, incB, count);
-		ERROR_FAIL(stat);
-	
-		// do the actual job
-		unsigned int iterA, iterB;
-		iterA = iterB = 0;
+		static const float offset[3][3] = { { 9.321f, -1.531f, -7.951f }, { 0.0f, 0.0f, 0.0f }, { 6.327f, 0.1671f, -2.672f } };
 
-		MDoubleArray result(count*ELEMENTS_VEC);
 		Noise noiseGen;
-        float v[3];
+		float p[3][NOISE_KERNEL_BLOCK];
+		float q[3][NOISE_KERNEL_BLOCK];
+		float dq[3][NOISE_KERNEL_BLOCK];
+		float g[3][3][NOISE_KERNEL_BLOCK];
+		float res[NOISE_KERNEL_BLOCK];
+		unsigned int order[NOISE_KERNEL_BLOCK];
+		mNoiseKey keys[NOISE_KERNEL_BLOCK];
+
+		// the gradient of one field, the curl needs all three
+		const unsigned int fields = curl ? 3 : 1;
+		const unsigned int first = curl ? 0 : 1;
+
+		for (unsigned int start=begin;start<end;start+=NOISE_KERNEL_BLOCK)
+		{
+			const unsigned int n = (end - start < NOISE_KERNEL_BLOCK) ? end - start : NOISE_KERNEL_BLOCK;
+
+			for (unsigned int i=0;i<n;i++)
+			{
+				keys[i].seed = int(seed[start+i]);
+				keys[i].setup = 0;
+			}
+			groupNoiseBlock(keys, order, n);
+
+			for (unsigned int r=0;r<n;)
+			{
+				const unsigned int e = noiseGroupEnd(keys, order, r, n);
+				const unsigned int m = e - r;
+
+				for (unsigned int d=0;d<3;d++)
+					for (unsigned int j=r;j<e;j++)
+						p[d][j-r] = float(in[d][start+order[j]]);
+
+				noiseGen.reshufflePermutationTable(keys[order[r]].seed);
+
+				for (unsigned int f=0;f<fields;f++)
+					for (unsigned int d=0;d<3;d++)
+						for (unsigned int j=0;j<m;j++)
+							g[f][d][j] = 0.0f;
+
+				// amplitude times frequency is 1 for every octave, so the gradients simply add up
+				float frequency = 1.0f;
+				for (int o=0;o<octaves;o++, frequency*=2.0f)
+				{
+					for (unsigned int f=0;f<fields;f++)
+					{
+						const float *off = offset[first + f];
+						for (unsigned int d=0;d<3;d++)
+							for (unsigned int j=0;j<m;j++)
+								q[d][j] = p[d][j] * frequency + off[d];
+
+						noiseGen.improvedPerlin3dS(q[0], q[1], q[2], res, dq[0], dq[1], dq[2], m);
+
+						for (unsigned int d=0;d<3;d++)
+							for (unsigned int j=0;j<m;j++)
+								g[f][d][j] += dq[d][j];
+					}
+				}
+
+				for (unsigned int j=r;j<e;j++)
+				{
+					double *v = out + ELEMENTS_VEC*(start+order[j]);
+					const unsigned int k = j - r;
+
+					if (curl)
+					{
+						v[0] = g[2][1][k] - g[1][2][k];
+						v[1] = g[0][2][k] - g[2][0][k];
+						v[2] = g[1][0][k] - g[0][1][k];
+					}
+					else
+					{
+						v[0] = g[0][0][k];
+						v[1] = g[0][1][k];
+						v[2] = g[0][2][k];
+					}
+				}
+
+				r = e;
+			}
+		}
+	}
+};
 
-        for(int i=0;i<count;i++)
-        {
-            int id = ELEMENTS_VEC *iterA;           
-	    	noiseGen.turbulenceVector(float(dblA[id]), float(dblA[id+1]),float(dblA[id+2]),int(dblB[iterB]),false,NOISE_IMPROVED_PERLIN,v);
- 
- 			int rid = ELEMENTS_VEC * i;
-            result[rid] = v[0];
-			result[rid+1] = v[1];
-			result[rid+2] = v[2]; 
-
-            iterA += incA;
-            iterB += incB;            
-                       
-        }
-            
-        setResult(result);
-        
+// shared argument handling of the gradient and curl noise commands: the vector array, the optional number
+// of octaves and the optional seeds
+static MStatus noiseGradientCmd(const MArgList& args, const char *cmd, const bool curl, MDoubleArray &result)
+{
+	if ((args.length() < 1) || (args.length() > 3))
+	{
+		MString err = cmd;
+		err += ": wrong number of arguments, should be 1 vecArray, an optional octave count and an optional seed array!";
+		USER_ERROR_CHECK(MS::kFailure,err);
 	}
-	else if (args.length() == 4)
+
+	MDoubleArray vecA, seeds;
+	unsigned int incA, count;
+	MStatus stat = getNoiseArrays(args, cmd, 1, true, &vecA, &incA, count);
+	ERROR_FAIL(stat);
+
+	mNoiseGradientKernel kernel;
+	kernel.curl = curl;
+	kernel.octaves = 1;
+	if (args.length() > 1)
 	{
-		// get the arguments
-	    MDoubleArray dblA, dblB, dblC,dblD;
-    	unsigned int incA, incB, incC, incD, count;
-		MStatus stat = getArgDblDblDblDbl(args, dblA, dblB, dblC,dblD, incA, incB, incC, incD,count);
+		stat = getIntArg(args, 1, kernel.octaves);
+		ERROR_ARG(stat,2);
+	}
+	if ((kernel.octaves < 1) || (kernel.octaves > NOISE_MAX_OCTAVES))
+	{
+		MString err = cmd;
+		err = err + ": the octave count has to be between 1 and " + NOISE_MAX_OCTAVES + ", it is " + kernel.octaves + "!";
+		USER_ERROR_CHECK(MS::kFailure,err);
+	}
+
+	stat = getSeedArg(args, 2, cmd, count, seeds, kernel.seed);
+	ERROR_FAIL(stat);
+
+	// do the job
+	vecArgStreams(vecA, incA, kernel.in);
+	result = MDoubleArray(count*ELEMENTS_VEC);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_HEAVY, kernel);
+
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mVec3dNoiseGradient
+
+   The gradient of Improved Perlin noise in 3 dimensions, computed analytically in the same pass as the noise
+   (the noise values themselves are the ones of <mDbl3dNoise>). With more than one octave it is the gradient
+   of the noise summed over the octaves, each one with double the frequency and half the amplitude.
+
+   Parameters:
+
+		$vecArray - vector array with the sample positions
+		$octaves - optional, the number of octaves (1 to 30), defaults to 1
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+
+   Returns:
+
+		gradient vectors as a float[]
+
+*/
+#define mel mVec3dNoiseGradient(float[] $vecArray, int $octaves, int[] $seeds);
+#undef mel
+
+CREATOR(mVec3dNoiseGradient)
+MStatus mVec3dNoiseGradient::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = noiseGradientCmd(args, "mVec3dNoiseGradient", false, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mVec3dCurlNoise
+
+   Curl noise, a divergence free vector field for advecting particles (after Bridson). It is the curl of a
+   vector potential made of three Improved Perlin noise fields, using their analytic gradients, so it costs
+   three gradient evaluations per octave instead of finite differences.
+
+   Parameters:
+
+		$vecArray - vector array with the sample positions
+		$octaves - optional, the number of octaves (1 to 30), defaults to 1
+		$seeds - optional, the seed of the noise pattern, one for all or one per element, defaults to the mSeed seed
+
+   Returns:
+
+		curl vectors as a float[]
+
+*/
+#define mel mVec3dCurlNoise(float[] $vecArray, int $octaves, int[] $seeds);
+#undef mel
+
+CREATOR(mVec3dCurlNoise)
+MStatus mVec3dCurlNoise::doIt( const MArgList& args )
+{
+	MDoubleArray result;
+	MStatus stat = noiseGradientCmd(args, "mVec3dCurlNoise", true, result);
+	ERROR_FAIL(stat);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+// noise on a regular grid
+
+// threaded kernel for the grid noise, one element per scanline along x, the coordinates of a line are
+// generated in blocks, improved perlin reuses the permutation table lookups along the line
+struct mNoiseGridKernel
+{
+	unsigned int resolution[3];
+	float origin[3];
+	float spacing[3];
+	int basis;
+	int metric;
+	float exponent;
+	unsigned int seed;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		Noise noiseGen(seed);
+		float p[3][NOISE_KERNEL_BLOCK];
+		float res[NOISE_KERNEL_BLOCK];
+
+		for (unsigned int line=begin;line<end;line++)
+		{
+			const float y = origin[1] + float(line % resolution[1]) * spacing[1];
+			const float z = origin[2] + float(line / resolution[1]) * spacing[2];
+			double *o = out + line * resolution[0];
+
+			for (unsigned int start=0;start<resolution[0];start+=NOISE_KERNEL_BLOCK)
+			{
+				const unsigned int n = (resolution[0] - start < NOISE_KERNEL_BLOCK) ? resolution[0] - start : NOISE_KERNEL_BLOCK;
+				const float x = origin[0] + float(start) * spacing[0];
+
+				if (basis == NOISE_IMPROVED_PERLIN)
+					noiseGen.improvedPerlin3dRowS(x, spacing[0], y, z, res, n);
+				else
+				{
+					for (unsigned int i=0;i<n;i++)
+					{
+						p[0][i] = x + float(i) * spacing[0];
+						p[1][i] = y;
+						p[2][i] = z;
+					}
+					noiseGen.noise3dS(p[0], p[1], p[2], res, n, basis, metric, exponent);
+				}
+
+				for (unsigned int i=0;i<n;i++)
+					o[start+i] = res[i];
+			}
+		}
+	}
+};
+
+//************************************************************************************************//
+/*
+   Function: mDblNoiseGrid
+
+   Sample a noise basis on a regular grid without building the coordinate arrays first. The result is
+   ordered x first, then y, then z, so element x + resX * (y + resY * z) is the sample at
+   origin + (x, y, z) * spacing. For a 2d grid use a resolution of 1 along an axis.
+
+   Parameters:
+
+		$resX - the number of samples along x
+		$resY - the number of samples along y
+		$resZ - the number of samples along z
+		$origin - vector (float[3]) with the position of the first sample
+		$spacing - the distance between the samples, a single value or one per axis (float[3])
+		$basis - optional, the noise basis (see <mDbl3dBasisNoise>), defaults to 1
+		$distanceMetric - optional, the voronoi distance metric (see <mDbl3dBasisNoise>), defaults to 0
+		$exponent - optional, the exponent of the minkovsky distance, defaults to 2.5
+		$seed - optional, the seed of the noise pattern, defaults to the mSeed seed
+
+   Returns:
+
+		noise values as a float[]
+
+*/
+#define mel mDblNoiseGrid(int $resX, int $resY, int $resZ, float[] $origin, float[] $spacing, int $basis, int $distanceMetric, float $exponent, int $seed);
+#undef mel
+
+CREATOR(mDblNoiseGrid)
+MStatus mDblNoiseGrid::doIt( const MArgList& args )
+{
+	if ((args.length() < 5) || (args.length() > 9))
+	{
+		USER_ERROR_CHECK(MS::kFailure,("mDblNoiseGrid: wrong number of arguments, needs the 3 resolutions, the origin and the spacing, optional the basis, the distance metric, the exponent and the seed!"));
+	}
+
+	MStatus stat;
+	mNoiseGridKernel kernel;
+
+	// resolution
+	double count = 1.0;
+	for (unsigned int j=0;j<3;j++)
+	{
+		int r;
+		stat = getIntArg(args, j, r);
 		ERROR_FAIL(stat);
-	
-		// do the actual job
-		unsigned int iterA, iterB, iterC,iterD;
-		iterA = iterB = iterC =iterD = 0;
+		if (r < 0)
+		{
+			MString err = "mDblNoiseGrid: invalid resolution ";
+			err = err + r + ", it can't be negative!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+		kernel.resolution[j] = r;
+		count *= r;
+	}
 
-		MDoubleArray result(count*ELEMENTS_VEC);
-		Noise noiseGen;
-        float v[3];
-        
-		for (unsigned int i=0;i<count;i++)
+	if (count > 4294967295.0)
+	{
+		USER_ERROR_CHECK(MS::kFailure,("mDblNoiseGrid: the grid has too many samples!"));
+	}
+
+	// origin and spacing
+	MDoubleArray origin, spacing;
+	stat = getDoubleArrayArg(args, 3, origin);
+	ERROR_FAIL(stat);
+	if (origin.length() != ELEMENTS_VEC)
+	{
+		USER_ERROR_CHECK(MS::kFailure,("mDblNoiseGrid: the origin has to be a single vector!"));
+	}
+
+	stat = getDoubleArrayArg(args, 4, spacing);
+	ERROR_FAIL(stat);
+	if ((spacing.length() != 1) && (spacing.length() != ELEMENTS_VEC))
+	{
+		USER_ERROR_CHECK(MS::kFailure,("mDblNoiseGrid: the spacing has to be a single value or a vector!"));
+	}
+
+	for (unsigned int j=0;j<3;j++)
+	{
+		kernel.origin[j] = float(origin[j]);
+		kernel.spacing[j] = float(spacing[(spacing.length() == 1) ? 0 : j]);
+	}
+
+	// basis, metric and exponent
+	kernel.basis = NOISE_IMPROVED_PERLIN;
+	kernel.metric = VORONOI_DIST_REAL;
+	double exponent = 2.5;
+	int seed = mfSeed;
+
+	if (args.length() > 5)
+	{
+		stat = getIntArg(args, 5, kernel.basis);
+		ERROR_ARG(stat,6);
+		if ((kernel.basis < NOISE_IMPROVED_PERLIN) || (kernel.basis > NOISE_BLENDER))
 		{
-        	noiseGen.turbulenceVector(float(dblA[iterA]), float(dblB[iterB]),  float(dblC[iterC]), int(dblD[iterD]),false,NOISE_IMPROVED_PERLIN,v);
+			MString err = "mDblNoiseGrid: invalid noise basis ";
+			err = err + kernel.basis + ", use " + NOISE_IMPROVED_PERLIN + " to " + NOISE_BLENDER + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+	}
 
-            int id = ELEMENTS_VEC *i;           
-            
-            result[id] = v[0];
-			result[id+1] = v[1];
-			result[id+2] = v[2]; 
-
-			iterA += incA;
-			iterB += incB;
-			iterC += incC;            
-			iterD += incD;                        
+	if (args.length() > 6)
+	{
+		stat = getIntArg(args, 6, kernel.metric);
+		ERROR_ARG(stat,7);
+		if ((kernel.metric < VORONOI_DIST_REAL) || (kernel.metric > VORONOI_DIST_MINKOVSKY4))
+		{
+			MString err = "mDblNoiseGrid: invalid distance metric ";
+			err = err + kernel.metric + ", use " + VORONOI_DIST_REAL + " to " + VORONOI_DIST_MINKOVSKY4 + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
 		}
-		
-        setResult(result);
 	}
-	else
+
+	if (args.length() > 7)
 	{
-		USER_ERROR_CHECK(MS::kFailure,("mVec3dTurbulence: wrong number of arguments, should be 1 vecArray + 1 dblArray or 4 dblArrays!"));
+		stat = getDoubleArg(args, 7, exponent);
+		ERROR_ARG(stat,8);
 	}
-    
-	return MS::kSuccess;
 
+	if (args.length() > 8)
+	{
+		stat = getIntArg(args, 8, seed);
+		ERROR_ARG(stat,9);
+	}
+
+	kernel.exponent = float(exponent);
+	kernel.seed = seed;
+
+	// do the job, threaded over the scanlines
+	const unsigned int lines = kernel.resolution[1] * kernel.resolution[2];
+	MDoubleArray result(kernel.resolution[0] * lines);
+	kernel.out = arrayPtr(result);
+
+	if (kernel.resolution[0])
+	{
+		const unsigned int grain = (kernel.resolution[0] < PARALLEL_GRAIN_HEAVY) ? PARALLEL_GRAIN_HEAVY / kernel.resolution[0] : 1;
+		parallelFor(lines, grain, kernel);
+	}
+
+	setResult(result);
+	return MS::kSuccess;
 }
+
 }// namespace
@@ -0,0 +1,452 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// Title: Quaternion Array Math Commands
+//
+// About:
+// Quaternions are a compact and cheap way to store and combine orientations, eg. of instanced particles.
+// These commands create quaternion arrays from the other ways of describing a rotation, combine and
+// interpolate them and turn them back into matrices. To rotate vectors by them use mVecRotateByQuat.
+//
+// Important conventions:
+// A quaternion in melfunctions is represented as an array of 4 floats (x, y, z, w) like MQuaternion.
+// Quaternions are multiplied in the same order as matrices: $quatA * $quatB first rotates by $quatA, then by $quatB.
+// All commands don't change the actual data in place, but create a new output.
+
+
+#include <maya/MDoubleArray.h>
+#include <maya/MArgList.h>
+#include <math.h>
+
+#include "../include/mHelperFunctions.h"
+#include "../include/mQuaternionMathCmd.h"
+#include "../include/mMatrixAlgorithms.h"
+#include "../include/mThreadPool.h"
+
+namespace melfunctions
+{
+
+enum { QUAT_FROM_EULER, QUAT_FROM_AXIS_ANGLE, QUAT_FROM_MATRIX, QUAT_MULT, QUAT_CONJUGATE,
+	   QUAT_SLERP, QUAT_NLERP, QUAT_TO_MATRIX };
+
+// threaded kernel for all quaternion commands, the operation doesn't change inside a batch
+struct mQuatKernel
+{
+	mArgStream a, b, c;
+	int operation;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		double scale[3], shear[3], rot[9];
+
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *qa = a.ptr(i);
+			double *q = out + ELEMENTS_QUAT*i;
+
+			switch (operation)
+			{
+				case QUAT_FROM_EULER:
+					eulerToQuat(qa, (int)c[i], q);
+					break;
+				case QUAT_FROM_AXIS_ANGLE:
+					axisAngleToQuat(qa, b[i], q);
+					break;
+				case QUAT_FROM_MATRIX:
+					// only the rotation, scale and shear are split off first
+					matDecompose(qa, scale, shear, rot);
+					rotationToQuat(rot, q);
+					break;
+				case QUAT_MULT:
+					quatMult(qa, b.ptr(i), q);
+					break;
+				case QUAT_CONJUGATE:
+					q[0] = -qa[0]; q[1] = -qa[1]; q[2] = -qa[2]; q[3] = qa[3];
+					break;
+				case QUAT_SLERP:
+					quatSlerp(qa, b.ptr(i), c[i], q);
+					break;
+				case QUAT_NLERP:
+					quatNlerp(qa, b.ptr(i), c[i], q);
+					break;
+				case QUAT_TO_MATRIX:
+				{
+					double *m = out + ELEMENTS_MAT*i;
+					quatToRotation(qa, rot);
+					m[0] = rot[0]; m[1] = rot[1]; m[2]  = rot[2]; m[3]  = 0.0;
+					m[4] = rot[3]; m[5] = rot[4]; m[6]  = rot[5]; m[7]  = 0.0;
+					m[8] = rot[6]; m[9] = rot[7]; m[10] = rot[8]; m[11] = 0.0;
+					m[12] = 0.0;   m[13] = 0.0;   m[14] = 0.0;    m[15] = 1.0;
+					break;
+				}
+			}
+		}
+	}
+};
+
+// run the kernel over count elements
+static void runQuatKernel(mQuatKernel &kernel, const int operation, const unsigned int count, MDoubleArray &result)
+{
+	kernel.operation = operation;
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
+}
+
+
+//************************************************************************************************//
+/*
+   Function: mQuatCreateFromEuler
+
+   Create quaternions from euler rotations.
+
+   Parameters:
+
+		$vecArrayA - the euler rotations (in radians)
+		$rotOrder - (optional) the rotate order, a single value or one per rotation: 0 xyz (default), 1 yzx, 2 zxy, 3 xzy, 4 yxz, 5 zyx
+
+   Returns:
+
+      the quaternions as a float[]
+
+*/
+#define mel mQuatCreateFromEuler(float[] $vecArrayA, float[] $rotOrder);
+#undef mel
+
+CREATOR(mQuatCreateFromEuler)
+MStatus mQuatCreateFromEuler::doIt( const MArgList& args )
+{
+	// get the arguments
+	MStatus stat;
+	MDoubleArray vecA, rotOrder;
+	unsigned int incA, incC, count;
+
+	if (args.length() == 2)
+	{
+		stat = getArgVecDbl(args, vecA, rotOrder, incA, incC, count);
+		ERROR_FAIL(stat);
+
+		// verify the rot order is in the proper domain
+		for (unsigned int i=0;i<rotOrder.length();i++)
+		{
+			int r = (int)rotOrder[i];
+			if ((r < ROTATE_ORDER_XYZ)||(r > ROTATE_ORDER_ZYX))
+			{
+				MString err="rotationOrder error at index ";
+				err = err + i +", not in valid range [0-5]!";
+				USER_ERROR_CHECK(MS::kFailure,err);
+			}
+		}
+	}
+	else
+	{
+		stat = getArgVec(args, vecA, count);
+		ERROR_FAIL(stat);
+
+		incA = 1;
+		incC = 0;
+		rotOrder = MDoubleArray(1,ROTATE_ORDER_XYZ);
+	}
+
+	// do the actual job
+	MDoubleArray result = createEmptyQuatArray(count);
+
+	mQuatKernel kernel;
+	kernel.a = mArgStream(vecA, incA, ELEMENTS_VEC);
+	kernel.c = mArgStream(rotOrder, incC);
+	runQuatKernel(kernel, QUAT_FROM_EULER, count, result);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mQuatCreateFromAxisAngle
+
+   Create quaternions rotating about an axis by an angle.
+
+   Parameters:
+
+		$vecArrayA - the axis
+		$dblArrayB - the angle (in radians)
+
+   Returns:
+
+      the quaternions as a float[]
+
+*/
+#define mel mQuatCreateFromAxisAngle(float[] $vecArrayA, float[] $dblArrayB);
+#undef mel
+
+CREATOR(mQuatCreateFromAxisAngle)
+MStatus mQuatCreateFromAxisAngle::doIt( const MArgList& args )
+{
+	// get the arguments
+	MDoubleArray vecA, dblB;
+	unsigned int incA, incB, count;
+	MStatus stat = getArgVecDbl(args, vecA, dblB, incA, incB, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyQuatArray(count);
+
+	mQuatKernel kernel;
+	kernel.a = mArgStream(vecA, incA, ELEMENTS_VEC);
+	kernel.b = mArgStream(dblB, incB);
+	runQuatKernel(kernel, QUAT_FROM_AXIS_ANGLE, count, result);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mQuatCreateFromMatrix
+
+   Create quaternions from the rotation of matrices, scale, shear and translation are ignored.
+
+   Parameters:
+
+		$matArrayA - the matrix array
+
+   Returns:
+
+      the quaternions as a float[]
+
+*/
+#define mel mQuatCreateFromMatrix(float[] $matArrayA);
+#undef mel
+
+CREATOR(mQuatCreateFromMatrix)
+MStatus mQuatCreateFromMatrix::doIt( const MArgList& args )
+{
+	// get the arguments
+	MDoubleArray matA;
+	unsigned int count;
+	MStatus stat = getArgMat(args, matA, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyQuatArray(count);
+
+	mQuatKernel kernel;
+	kernel.a = mArgStream(matA, 1, ELEMENTS_MAT);
+	runQuatKernel(kernel, QUAT_FROM_MATRIX, count, result);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mQuatMult
+
+   Multiply two quaternion arrays elementwise, the result first rotates by A and then by B.
+
+   Parameters:
+
+		$quatArrayA - the first quaternion array
+		$quatArrayB - the second quaternion array
+
+   Returns:
+
+      $quatArrayA[] * $quatArrayB[] as a float[]
+
+*/
+#define mel mQuatMult(float[] $quatArrayA, float[] $quatArrayB);
+#undef mel
+
+CREATOR(mQuatMult)
+MStatus mQuatMult::doIt( const MArgList& args )
+{
+	// get the arguments
+	MDoubleArray quatA, quatB;
+	unsigned int incA, incB, count;
+	MStatus stat = getArgQuatQuat(args, quatA, quatB, incA, incB, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyQuatArray(count);
+
+	mQuatKernel kernel;
+	kernel.a = mArgStream(quatA, incA, ELEMENTS_QUAT);
+	kernel.b = mArgStream(quatB, incB, ELEMENTS_QUAT);
+	runQuatKernel(kernel, QUAT_MULT, count, result);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mQuatConjugate
+
+   Get the conjugate of the elements of a quaternion array, for unit quaternions this is the inverse rotation.
+
+   Parameters:
+
+		$quatArrayA - the quaternion array
+
+   Returns:
+
+      the conjugated quaternions as a float[]
+
+*/
+#define mel mQuatConjugate(float[] $quatArrayA);
+#undef mel
+
+CREATOR(mQuatConjugate)
+MStatus mQuatConjugate::doIt( const MArgList& args )
+{
+	// get the arguments
+	MDoubleArray quatA;
+	unsigned int count;
+	MStatus stat = getArgQuat(args, quatA, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyQuatArray(count);
+
+	mQuatKernel kernel;
+	kernel.a = mArgStream(quatA, 1, ELEMENTS_QUAT);
+	runQuatKernel(kernel, QUAT_CONJUGATE, count, result);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mQuatSlerp
+
+   Spherical linear interpolation between two unit quaternion arrays, along the shorter arc. The rotation
+   changes with a constant speed.
+
+   Parameters:
+
+		$quatArrayA - the first quaternion array
+		$quatArrayB - the second quaternion array
+		$dblArrayC - the interpolation parameter (0 gives A, 1 gives B)
+
+   Returns:
+
+      the interpolated quaternions as a float[]
+
+*/
+#define mel mQuatSlerp(float[] $quatArrayA, float[] $quatArrayB, float[] $dblArrayC);
+#undef mel
+
+CREATOR(mQuatSlerp)
+MStatus mQuatSlerp::doIt( const MArgList& args )
+{
+	// get the arguments
+	MDoubleArray quatA, quatB, dblC;
+	unsigned int incA, incB, incC, count;
+	MStatus stat = getArgQuatQuatDbl(args, quatA, quatB, dblC, incA, incB, incC, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyQuatArray(count);
+
+	mQuatKernel kernel;
+	kernel.a = mArgStream(quatA, incA, ELEMENTS_QUAT);
+	kernel.b = mArgStream(quatB, incB, ELEMENTS_QUAT);
+	kernel.c = mArgStream(dblC, incC);
+	runQuatKernel(kernel, QUAT_SLERP, count, result);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mQuatNlerp
+
+   Normalized linear interpolation between two unit quaternion arrays, along the shorter arc. Cheaper than
+   mQuatSlerp, the path is the same but the speed is not constant.
+
+   Parameters:
+
+		$quatArrayA - the first quaternion array
+		$quatArrayB - the second quaternion array
+		$dblArrayC - the interpolation parameter (0 gives A, 1 gives B)
+
+   Returns:
+
+      the interpolated quaternions as a float[]
+
+*/
+#define mel mQuatNlerp(float[] $quatArrayA, float[] $quatArrayB, float[] $dblArrayC);
+#undef mel
+
+CREATOR(mQuatNlerp)
+MStatus mQuatNlerp::doIt( const MArgList& args )
+{
+	// get the arguments
+	MDoubleArray quatA, quatB, dblC;
+	unsigned int incA, incB, incC, count;
+	MStatus stat = getArgQuatQuatDbl(args, quatA, quatB, dblC, incA, incB, incC, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyQuatArray(count);
+
+	mQuatKernel kernel;
+	kernel.a = mArgStream(quatA, incA, ELEMENTS_QUAT);
+	kernel.b = mArgStream(quatB, incB, ELEMENTS_QUAT);
+	kernel.c = mArgStream(dblC, incC);
+	runQuatKernel(kernel, QUAT_NLERP, count, result);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mQuatToMatrix
+
+   Get the rotation matrices of the elements of a unit quaternion array.
+
+   Parameters:
+
+		$quatArrayA - the quaternion array
+
+   Returns:
+
+      the rotation matrices as a float[]
+
+*/
+#define mel mQuatToMatrix(float[] $quatArrayA);
+#undef mel
+
+CREATOR(mQuatToMatrix)
+MStatus mQuatToMatrix::doIt( const MArgList& args )
+{
+	// get the arguments
+	MDoubleArray quatA;
+	unsigned int count;
+	MStatus stat = getArgQuat(args, quatA, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyMatArray(count);
+
+	mQuatKernel kernel;
+	kernel.a = mArgStream(quatA, 1, ELEMENTS_QUAT);
+	runQuatKernel(kernel, QUAT_TO_MATRIX, count, result);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+}// namespace
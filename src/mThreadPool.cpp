@@ -0,0 +1,234 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// Title: Threading Commands
+//
+// About:
+// Most array commands split big arrays into chunks and process them on several threads. The chunk size
+// does not depend on the number of threads, so the results are identical no matter how many threads
+// are used. Small arrays are always processed directly.
+
+
+#include <maya/MArgList.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../include/mHelperFunctions.h"
+#include "../include/mThreadPool.h"
+
+namespace melfunctions
+{
+
+// hard upper limit for the number of threads
+#define MAX_THREADS 64
+
+static pthread_t		s_workers[MAX_THREADS];
+static unsigned int		s_workerCount = 0;
+static bool				s_quit = false;
+
+static pthread_mutex_t	s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	s_wakeCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	s_doneCond = PTHREAD_COND_INITIALIZER;
+
+// the job currently being processed
+static mParallelTask	*s_task = NULL;
+static unsigned int		s_count = 0;
+static unsigned int		s_grain = 1;
+static unsigned int		s_chunkCount = 0;
+static volatile unsigned int s_nextChunk = 0;
+static unsigned int		s_activeWorkers = 0;
+static unsigned int		s_generation = 0;
+
+// set while a job is running, a parallelFor issued from inside a kernel runs serially
+static volatile int		s_busy = 0;
+
+
+//*************************************************************************************************
+// grab chunks until there are none left
+
+static void processChunks()
+{
+	unsigned int chunk;
+	while ((chunk = __sync_fetch_and_add(&s_nextChunk, 1)) < s_chunkCount)
+	{
+		unsigned int begin = chunk * s_grain;
+		unsigned int end = begin + s_grain;
+		if (end > s_count)
+			end = s_count;
+
+		s_task->run(begin, end);
+	}
+}
+
+static void* workerMain(void*)
+{
+	unsigned int seenGeneration = 0;
+
+	pthread_mutex_lock(&s_mutex);
+	while (true)
+	{
+		while ((seenGeneration == s_generation) && !s_quit)
+			pthread_cond_wait(&s_wakeCond, &s_mutex);
+
+		if (s_quit)
+			break;
+
+		seenGeneration = s_generation;
+		pthread_mutex_unlock(&s_mutex);
+
+		processChunks();
+
+		pthread_mutex_lock(&s_mutex);
+		if (--s_activeWorkers == 0)
+			pthread_cond_signal(&s_doneCond);
+	}
+	pthread_mutex_unlock(&s_mutex);
+
+	return NULL;
+}
+
+
+//*************************************************************************************************
+
+unsigned int mThreadPool::processorCount()
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n < 1) ? 1 : (unsigned int)n;
+}
+
+void mThreadPool::init(unsigned int threadCount)
+{
+	release();
+
+	if (threadCount == 0)
+		threadCount = processorCount();
+	if (threadCount > MAX_THREADS)
+		threadCount = MAX_THREADS;
+
+	s_quit = false;
+	s_generation = 0;
+
+	// the thread calling parallelFor does its share of the work, so start one less
+	for (unsigned int i = 0; i + 1 < threadCount; i++)
+	{
+		if (pthread_create(&s_workers[s_workerCount], NULL, workerMain, NULL) != 0)
+			break;
+		s_workerCount++;
+	}
+}
+
+void mThreadPool::release()
+{
+	if (s_workerCount == 0)
+		return;
+
+	pthread_mutex_lock(&s_mutex);
+	s_quit = true;
+	pthread_cond_broadcast(&s_wakeCond);
+	pthread_mutex_unlock(&s_mutex);
+
+	for (unsigned int i = 0; i < s_workerCount; i++)
+		pthread_join(s_workers[i], NULL);
+
+	s_workerCount = 0;
+	s_quit = false;
+}
+
+unsigned int mThreadPool::threadCount()
+{
+	return s_workerCount + 1;
+}
+
+void mThreadPool::run(mParallelTask &task, unsigned int count, unsigned int grain)
+{
+	if (grain == 0)
+		grain = 1;
+
+	// nested or concurrent call, the workers are taken - do it right here
+	if ((s_workerCount == 0) || !__sync_bool_compare_and_swap(&s_busy, 0, 1))
+	{
+		for (unsigned int begin = 0; begin < count; begin += grain)
+			task.run(begin, (begin + grain < count) ? begin + grain : count);
+		return;
+	}
+
+	pthread_mutex_lock(&s_mutex);
+	s_task = &task;
+	s_count = count;
+	s_grain = grain;
+	s_chunkCount = parallelChunkCount(count, grain);
+	s_nextChunk = 0;
+	s_activeWorkers = s_workerCount;
+	s_generation++;
+	pthread_cond_broadcast(&s_wakeCond);
+	pthread_mutex_unlock(&s_mutex);
+
+	processChunks();
+
+	pthread_mutex_lock(&s_mutex);
+	while (s_activeWorkers > 0)
+		pthread_cond_wait(&s_doneCond, &s_mutex);
+	s_task = NULL;
+	pthread_mutex_unlock(&s_mutex);
+
+	__sync_lock_release(&s_busy);
+}
+
+
+//************************************************************************************************//
+/*
+   Function: mThreadCount
+   Set or query the number of threads the array commands use. The results of all commands are the
+   same for every thread count, only the speed changes.
+
+   Parameters:
+
+		none - query the current number of threads
+		or
+		count - the number of threads to use, 0 uses one thread per processor, 1 disables threading
+
+   Returns:
+
+      the number of threads in use as an int
+
+*/
+#define mel mThreadCount(int $count);
+#undef mel
+
+CREATOR(mThreadCount)
+MStatus mThreadCount::doIt( const MArgList& args )
+{
+	MStatus stat;
+
+	// check how many arguments we have
+	if (args.length() == 1)
+	{
+		int count;
+		stat = getIntArg(args, 0, count);
+		ERROR_FAIL(stat);
+
+		if (count < 0)
+			USER_ERROR_CHECK(MS::kFailure,"mThreadCount: the thread count can't be negative!");
+
+		mThreadPool::init((unsigned int)count);
+	}
+	else if (args.length() != 0)
+	{
+		ERROR_FAIL(MS::kFailure);
+	}
+
+	setResult((int)mThreadPool::threadCount());
+	return MS::kSuccess;
+}
+
+}// namespace
@@ -24,7 +24,9 @@
 #include <maya/MArgList.h>
 
 #include "../include/mHelperFunctions.h"
+#include "../include/mArrayStoreCmd.h"
 #include "../include/mUVManagementCmd.h"
+#include "../include/mThreadPool.h"
 
 namespace melfunctions
 {
@@ -317,7 +319,7 @@ MStatus mUVGet::doIt( const MArgList& args )
    Set elements in a UV array, this function will not grow the UV array, but error when you try to set an invalid array element!
 
    Parameters:
-		uvArrayA - base UV array
+		uvArrayA - base UV array, or the name of an mArrayStore object to change in place (its name is returned then)
 		ids	- int array of ids defining where in A to insert B
 		uvArrayB - UV array of elements to be inserted into A, must be size 1 or same size than id array
    Returns:
@@ -331,6 +333,16 @@ MStatus mUVGet::doIt( const MArgList& args )
 CREATOR(mUVSet)
 MStatus mUVSet::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetCmd(args, ELEMENTS_UV, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	unsigned int count = 1;
 
 	MStatus stat = argCountCheck(args,3); 
@@ -534,7 +546,7 @@ MStatus mUVGetComponent::doIt( const MArgList& args )
 
    Parameters:
 
-		$uvArrayA - the UV array
+		$uvArrayA - the UV array, or the name of an mArrayStore object to change in place (its name is returned then)
 		$value - the double array to be set into the component
 
    Returns:
@@ -548,6 +560,16 @@ MStatus mUVGetComponent::doIt( const MArgList& args )
 CREATOR(mUVSetU)
 MStatus mUVSetU::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetComponentCmd(args, ELEMENTS_UV, 0, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	// get the arguments
     MDoubleArray dblA, dblB;
     unsigned int incA, incB, count;
@@ -583,7 +605,7 @@ MStatus mUVSetU::doIt( const MArgList& args )
 
    Parameters:
 
-		$uvArrayA - the UV array
+		$uvArrayA - the UV array, or the name of an mArrayStore object to change in place (its name is returned then)
 		$value - the double array to be set into the component
 
    Returns:
@@ -597,6 +619,16 @@ MStatus mUVSetU::doIt( const MArgList& args )
 CREATOR(mUVSetV)
 MStatus mUVSetV::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetComponentCmd(args, ELEMENTS_UV, 1, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	// get the arguments
     MDoubleArray dblA, dblB;
     unsigned int incA, incB, count;
@@ -634,7 +666,7 @@ MStatus mUVSetV::doIt( const MArgList& args )
 
    Parameters:
 
-		$uvArrayA - the UV array
+		$uvArrayA - the UV array, or the name of an mArrayStore object to change in place (its name is returned then)
 		$component - the index [0-2] as an int array
 		$value - the double array to be set into the component
 
@@ -649,6 +681,16 @@ MStatus mUVSetV::doIt( const MArgList& args )
 CREATOR(mUVSetComponent)
 MStatus mUVSetComponent::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetComponentCmd(args, ELEMENTS_UV, -1, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	// get the arguments
     MDoubleArray dblA, dblB,dblC;
     unsigned int incA, incB, incC,count;
@@ -689,4 +731,319 @@ MStatus mUVSetComponent::doIt( const MArgList& args )
 	return MS::kSuccess;
 }
 
+//****//
+
+// threaded kernel for mUVTransform, scale and rotate about the pivot, then offset
+struct mUVTransformKernel
+{
+	mArgStream uvA, offset, scale, rotate, pivot;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *uv = uvA.ptr(i);
+			const double *o = offset.ptr(i);
+			const double *s = scale.ptr(i);
+			const double *p = pivot.ptr(i);
+			const double r = rotate[i];
+			const double c = cos(r);
+			const double sn = sin(r);
+
+			const double u = (uv[0] - p[0]) * s[0];
+			const double v = (uv[1] - p[1]) * s[1];
+
+			double *res = out + ELEMENTS_UV*i;
+			res[0] = c*u - sn*v + p[0] + o[0];
+			res[1] = sn*u + c*v + p[1] + o[1];
+		}
+	}
+};
+
+/*
+   Function: mUVTransform
+
+   Transform UVs: scale and rotate them about a pivot, then offset them.
+   The trailing arguments are optional, all of them can be single values or arrays of the same size as the UV array.
+
+   Parameters:
+
+		$uvArrayA - the UV array
+		$offset - the offset as a UV array
+		$scale - optional, the scale as a UV array, defaults to <<1,1>>
+		$rotate - optional, the rotation angle (in rad), defaults to 0
+		$pivot - optional, the pivot for scale and rotation as a UV array, defaults to <<0,0>>
+
+   Returns:
+
+      the transformed UV array as a float array
+
+*/
+#define mel mUVTransform(float $uvArrayA[], float $offset[], float $scale[], float $rotate[], float $pivot[]);
+#undef mel
+
+CREATOR(mUVTransform)
+MStatus mUVTransform::doIt( const MArgList& args )
+{
+	MStatus stat;
+
+	const unsigned int argCount = args.length();
+	if ((argCount < 2) || (argCount > 5))
+		USER_ERROR_CHECK(MS::kFailure,"mUVTransform: needs 2 to 5 arguments (uv, offset, [scale], [rotate], [pivot])!");
+
+	// get the arguments, the missing ones default to the identity
+	MDoubleArray a[5];
+	a[2].setLength(2); a[2][0] = a[2][1] = 1.0;
+	a[3].setLength(1); a[3][0] = 0.0;
+	a[4].setLength(2); a[4][0] = a[4][1] = 0.0;
+
+	const unsigned int elements[5] = {ELEMENTS_UV, ELEMENTS_UV, ELEMENTS_UV, 1, ELEMENTS_UV};
+	unsigned int num[5];
+	unsigned int count = 0;
+
+	for (unsigned int j=0;j<5;j++)
+	{
+		if (j < argCount)
+		{
+			stat = getDoubleArrayArg(args, j, a[j]);
+			ERROR_FAIL(stat);
+		}
+
+		if (elements[j] == ELEMENTS_UV)
+		{
+			stat = uvIsValid(a[j], num[j]);
+			ERROR_ARG(stat,j+1);
+		}
+		else
+			num[j] = a[j].length();
+
+		count = maximum(count, num[j]);
+	}
+
+	for (unsigned int j=0;j<5;j++)
+	{
+		if ((num[j] != 1) && (num[j] != count))
+		{
+			MString err = "mUVTransform: argument ";
+			err = err + (j + 1) + " has " + num[j] + " elements, it needs 1 or " + count + "!";
+			USER_ERROR_CHECK(MS::kFailure,err);
+		}
+	}
+
+	// do the actual job
+	MDoubleArray result = createEmptyUVArray(count);
+
+	mUVTransformKernel kernel;
+	kernel.uvA = mArgStream(a[0], (num[0] == 1) ? 0 : 1, ELEMENTS_UV);
+	kernel.offset = mArgStream(a[1], (num[1] == 1) ? 0 : 1, ELEMENTS_UV);
+	kernel.scale = mArgStream(a[2], (num[2] == 1) ? 0 : 1, ELEMENTS_UV);
+	kernel.rotate = mArgStream(a[3], (num[3] == 1) ? 0 : 1);
+	kernel.pivot = mArgStream(a[4], (num[4] == 1) ? 0 : 1, ELEMENTS_UV);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//****//
+
+#define MUV_WRAP_REPEAT 0
+#define MUV_WRAP_MIRROR 1
+#define MUV_WRAP_CLAMP 2
+
+// threaded kernel for mUVWrap, u and v are treated alike so it runs over the flat values,
+// one loop per mode to keep the loops free of branches
+struct mUVWrapKernel
+{
+	const double *in;
+	double *out;
+	int mode;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		const unsigned int first = begin * ELEMENTS_UV;
+		const unsigned int last = end * ELEMENTS_UV;
+
+		switch (mode)
+		{
+			case MUV_WRAP_REPEAT:
+				for (unsigned int j=first;j<last;j++)
+					out[j] = in[j] - floor(in[j]);
+				break;
+
+			case MUV_WRAP_MIRROR:
+				for (unsigned int j=first;j<last;j++)
+				{
+					const double t = in[j] - 2.0 * floor(in[j] * 0.5);
+					out[j] = (t > 1.0) ? 2.0 - t : t;
+				}
+				break;
+
+			default:
+				for (unsigned int j=first;j<last;j++)
+					out[j] = (in[j] < 0.0) ? 0.0 : ((in[j] > 1.0) ? 1.0 : in[j]);
+				break;
+		}
+	}
+};
+
+/*
+   Function: mUVWrap
+
+   Wrap UVs into the 0-1 range.
+
+   Parameters:
+
+		$uvArrayA - the UV array
+		$mode - optional, 0 repeat (the fractional part, default), 1 mirrored repeat, 2 clamp
+
+   Returns:
+
+      the wrapped UV array as a float array
+
+*/
+#define mel mUVWrap(float $uvArrayA[], int $mode);
+#undef mel
+
+CREATOR(mUVWrap)
+MStatus mUVWrap::doIt( const MArgList& args )
+{
+	MStatus stat;
+
+	int mode = MUV_WRAP_REPEAT;
+	if (args.length() == 2)
+	{
+		stat = getIntArg(args, 1, mode);
+		USER_ERROR_CHECK(stat,"mUVWrap: the second argument has to be the wrap mode!");
+		if ((mode < MUV_WRAP_REPEAT) || (mode > MUV_WRAP_CLAMP))
+			USER_ERROR_CHECK(MS::kFailure,"mUVWrap: invalid wrap mode, use 0 (repeat), 1 (mirror) or 2 (clamp)!");
+	}
+	else
+	{
+		stat = argCountCheck(args,1);
+		ERROR_FAIL(stat);
+	}
+
+	MDoubleArray dblA;
+	stat = getDoubleArrayArg(args, 0, dblA);
+	ERROR_FAIL(stat);
+
+	unsigned int count;
+	stat = uvIsValid(dblA, count);
+	ERROR_ARG(stat,1);
+
+	// do the actual job
+	MDoubleArray result = createEmptyUVArray(count);
+
+	mUVWrapKernel kernel;
+	kernel.in = arrayPtr(dblA);
+	kernel.out = arrayPtr(result);
+	kernel.mode = mode;
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//****//
+
+// threaded kernel for mUVTile, returns the UDIM tile of each uv,
+// or, with a target tile, moves each uv from its own tile into the target tile
+struct mUVTileKernel
+{
+	mArgStream uvA, tile;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		if (!tile.data)
+		{
+			for (unsigned int i=begin;i<end;i++)
+			{
+				const double *uv = uvA.ptr(i);
+				out[i] = 1001.0 + floor(uv[0]) + 10.0 * floor(uv[1]);
+			}
+			return;
+		}
+
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *uv = uvA.ptr(i);
+			const double t = tile[i] - 1001.0;
+			const double tv = floor(t * 0.1);
+
+			double *res = out + ELEMENTS_UV*i;
+			res[0] = uv[0] - floor(uv[0]) + (t - 10.0 * tv);
+			res[1] = uv[1] - floor(uv[1]) + tv;
+		}
+	}
+};
+
+/*
+   Function: mUVTile
+
+   Get the UDIM tile (1001 + uTile + 10 * vTile) of UVs, or move UVs into UDIM tiles keeping their position within the tile.
+
+   Parameters:
+
+		$uvArrayA - the UV array
+		$tile - optional, the UDIM tile to move each uv into
+
+   Returns:
+
+      without $tile: the UDIM tile number of each uv as a float array
+      with $tile: the moved UV array as a float array
+
+*/
+#define mel mUVTile(float $uvArrayA[], int $tile[]);
+#undef mel
+
+CREATOR(mUVTile)
+MStatus mUVTile::doIt( const MArgList& args )
+{
+	MStatus stat;
+
+	// get the arguments
+	MDoubleArray dblA, dblB;
+	unsigned int incA, incB, count;
+	const bool moveToTile = (args.length() == 2);
+
+	if (moveToTile)
+	{
+		stat = getArgUVDbl(args, dblA, dblB, incA, incB, count);
+		ERROR_FAIL(stat);
+
+		for (unsigned int i=0;i<dblB.length();i++)
+		{
+			if ((dblB[i] < 1001.0) || (dblB[i] != floor(dblB[i])))
+			{
+				MString err = "mUVTile: invalid UDIM tile at index ";
+				err = err + i + ", it has to be a whole number >= 1001!";
+				USER_ERROR_CHECK(MS::kFailure,err);
+			}
+		}
+	}
+	else
+	{
+		stat = getArgUV(args, dblA, count);
+		ERROR_FAIL(stat);
+		incA = 1;
+	}
+
+	// do the actual job
+	MDoubleArray result = moveToTile ? createEmptyUVArray(count) : createEmptyDblArray(count);
+
+	mUVTileKernel kernel;
+	kernel.uvA = mArgStream(dblA, incA, ELEMENTS_UV);
+	if (moveToTile)
+		kernel.tile = mArgStream(dblB, incB);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
 } // end namespace
@@ -33,7 +33,10 @@
 
 
 #include "../include/mHelperFunctions.h"
+#include "../include/mArrayStoreCmd.h"
 #include "../include/mVectorManagementCmd.h"
+#include "../include/mThreadPool.h"
+#include "../include/mArrayAlgorithms.h"
 
 namespace melfunctions
 {
@@ -373,12 +376,135 @@ MStatus mVecGet::doIt( const MArgList& args )
 }
 
 
+// threaded kernel for mVecGather, the source rows are prefetched a few elements ahead
+// so the random reads overlap instead of stalling one after the other
+#define GATHER_PREFETCH_DISTANCE 16
+
+struct mVecGatherKernel
+{
+	const double *vec;
+	const double *ids;
+	double *out;
+	unsigned int count;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+		{
+			if (i + GATHER_PREFETCH_DISTANCE < count)
+				__builtin_prefetch(vec + ELEMENTS_VEC * int(ids[i + GATHER_PREFETCH_DISTANCE]));
+
+			const double *v = vec + ELEMENTS_VEC * int(ids[i]);
+			double *r = out + ELEMENTS_VEC * i;
+			r[0] = v[0];
+			r[1] = v[1];
+			r[2] = v[2];
+		}
+	}
+};
+
+/*
+   Function: mVecGather
+   Reorder or pick elements of a vector array by an index array, eg. the result of mDblArgSort. Unlike mVecGet
+   there is no substitution, all indices have to be valid.
+
+   Parameters:
+		vectorArrayA - vector array to pick elements from
+		ids	- int array of the ids of the elements, in the order they should appear in the result
+
+   Returns:
+
+      The gathered vector array as a float array of its elements
+
+*/
+#define mel mVecGather(float $vectorArrayA[], int $id[]);
+#undef mel
+
+CREATOR(mVecGather)
+MStatus mVecGather::doIt( const MArgList& args )
+{
+	MStatus stat = argCountCheck(args,2);
+	ERROR_FAIL(stat);
+
+	MDoubleArray vecA, dblB;
+	stat = getDoubleArrayArg(args,0,vecA);
+	ERROR_FAIL(stat);
+
+	stat = getDoubleArrayArg(args,1,dblB);
+	ERROR_FAIL(stat);
+
+	unsigned int numA;
+	stat = vecIsValid(vecA,numA);
+	ERROR_ARG(stat,1);
+
+	unsigned int count = dblB.length();
+
+	// check the ids up front, the kernel doesn't have to
+	for (unsigned int i=0;i<count;i++)
+	{
+		int id = int(dblB[i]);
+		if ((id < 0) || (id >= int(numA)))
+		{
+			// we've got an invalid index
+			MString err = "id array has an invalid index '";
+			err = err + id +"' at position '"+i+"'!";
+			USER_ERROR_CHECK(MS::kFailure,err)
+		}
+	}
+
+	MDoubleArray result = createEmptyVecArray(count);
+
+	mVecGatherKernel kernel;
+	kernel.vec = arrayPtr(vecA);
+	kernel.ids = arrayPtr(dblB);
+	kernel.out = arrayPtr(result);
+	kernel.count = count;
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+
+/*
+   Function: mVecCompact
+   Keep only the elements of a vector array where a mask is not 0, eg. the result of mDblIsBigger.
+
+   Parameters:
+		vectorArrayA - the vector array
+		mask - the mask, one value per vector or a single value
+
+   Returns:
+
+      The kept vectors in their original order as a float array of their elements
+
+*/
+#define mel mVecCompact(float $vectorArrayA[], float $mask[]);
+#undef mel
+
+CREATOR(mVecCompact)
+MStatus mVecCompact::doIt( const MArgList& args )
+{
+	MDoubleArray vecA, mask;
+	unsigned int count;
+	MStatus stat = getArgMask(args, ELEMENTS_VEC, vecA, mask, count);
+	ERROR_FAIL(stat);
+
+	std::vector<unsigned int> offsets;
+	MDoubleArray result = createEmptyVecArray(compactOffsets(arrayPtr(mask), count, offsets));
+	compactByMask(arrayPtr(vecA), count, ELEMENTS_VEC, arrayPtr(mask), offsets, arrayPtr(result));
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+
 /*
    Function: mVecSet
    Set elements in a vector array, this function will not grow the vector array, but error when you try to set an invalid array element!
 
    Parameters:
-		vectorArrayA - base vector array
+		vectorArrayA - base vector array, or the name of an mArrayStore object to change in place (its name is returned then)
 		ids	- int array of ids defining where in A to insert B
 		vectorArrayB - vector array of elements to be inserted into A, must be size 1 or same size than id array
    Returns:
@@ -392,6 +518,16 @@ MStatus mVecGet::doIt( const MArgList& args )
 CREATOR(mVecSet)
 MStatus mVecSet::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetCmd(args, ELEMENTS_VEC, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	unsigned int count = 1;
 
 	MStatus stat = argCountCheck(args,3); 
@@ -628,7 +764,7 @@ MStatus mVecGetComponent::doIt( const MArgList& args )
 
    Parameters:
 
-		$vecArrayA - the vector array
+		$vecArrayA - the vector array, or the name of an mArrayStore object to change in place (its name is returned then)
 		$value - the double array to be set into the component
 
    Returns:
@@ -642,6 +778,16 @@ MStatus mVecGetComponent::doIt( const MArgList& args )
 CREATOR(mVecSetX)
 MStatus mVecSetX::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetComponentCmd(args, ELEMENTS_VEC, 0, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	// get the arguments
     MDoubleArray dblA, dblB;
     unsigned int incA, incB, count;
@@ -677,7 +823,7 @@ MStatus mVecSetX::doIt( const MArgList& args )
 
    Parameters:
 
-		$vecArrayA - the vector array
+		$vecArrayA - the vector array, or the name of an mArrayStore object to change in place (its name is returned then)
 		$value - the double array to be set into the component
 
    Returns:
@@ -691,6 +837,16 @@ MStatus mVecSetX::doIt( const MArgList& args )
 CREATOR(mVecSetY)
 MStatus mVecSetY::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetComponentCmd(args, ELEMENTS_VEC, 1, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	// get the arguments
     MDoubleArray dblA, dblB;
     unsigned int incA, incB, count;
@@ -727,7 +883,7 @@ MStatus mVecSetY::doIt( const MArgList& args )
 
    Parameters:
 
-		$vecArrayA - the vector array
+		$vecArrayA - the vector array, or the name of an mArrayStore object to change in place (its name is returned then)
 		$value - the double array to be set into the component
 
    Returns:
@@ -741,6 +897,16 @@ MStatus mVecSetY::doIt( const MArgList& args )
 CREATOR(mVecSetZ)
 MStatus mVecSetZ::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetComponentCmd(args, ELEMENTS_VEC, 2, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	// get the arguments
     MDoubleArray dblA, dblB;
     unsigned int incA, incB, count;
@@ -777,7 +943,7 @@ MStatus mVecSetZ::doIt( const MArgList& args )
 
    Parameters:
 
-		$vecArrayA - the vector array
+		$vecArrayA - the vector array, or the name of an mArrayStore object to change in place (its name is returned then)
 		$component - the index [0-2] as an int array
 		$value - the double array to be set into the component
 
@@ -792,6 +958,16 @@ MStatus mVecSetZ::doIt( const MArgList& args )
 CREATOR(mVecSetComponent)
 MStatus mVecSetComponent::doIt( const MArgList& args )
 {
+	// change a store in place
+	if (isStoreArg(args,0))
+	{
+		MString name;
+		MStatus stat = arrayStoreSetComponentCmd(args, ELEMENTS_VEC, -1, name);
+		ERROR_FAIL(stat);
+		setResult(name);
+		return MS::kSuccess;
+	}
+
 	// get the arguments
     MDoubleArray dblA, dblB,dblC;
     unsigned int incA, incB, incC,count;
@@ -35,6 +35,8 @@
 
 #include "../include/mHelperFunctions.h"
 #include "../include/mVectorMathCmd.h"
+#include "../include/mThreadPool.h"
+#include "../include/mMatrixAlgorithms.h"
 
 namespace melfunctions
 {
@@ -895,6 +897,59 @@ MStatus mVecRotateByEuler::doIt( const MArgList& args )
 	return MS::kSuccess;
 }
 
+// threaded kernel for mVecRotateByQuat
+struct mVecRotateByQuatKernel
+{
+	mArgStream vecA, quatB;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i=begin;i<end;i++)
+			quatRotate(quatB.ptr(i), vecA.ptr(i), out + ELEMENTS_VEC*i);
+	}
+};
+
+/*
+   Function: mVecRotateByQuat
+
+   Rotate vector by a quaternion
+
+   Parameters:
+
+		$vecArrayA - the vector
+		$quatArrayB - the (unit) quaternion
+
+   Returns:
+
+      the vector rotated by the quaternion as a float[]
+
+*/
+#define mel mVecRotateByQuat(float[] $vecArrayA, float[] $quatArrayB);
+#undef mel
+
+CREATOR(mVecRotateByQuat)
+MStatus mVecRotateByQuat::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray dblA, dblB;
+    unsigned int incA, incB, count;
+	MStatus stat = getArgVecQuat(args, dblA, dblB, incA, incB, count);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyVecArray(count);
+
+	mVecRotateByQuatKernel kernel;
+	kernel.vecA = mArgStream(dblA, incA, ELEMENTS_VEC);
+	kernel.quatB = mArgStream(dblB, incB, ELEMENTS_QUAT);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_LIGHT, kernel);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
 /*
    Function: mVecRotateByAxisAngle
 
@@ -1258,6 +1313,57 @@ MStatus mVecLerp::doIt( const MArgList& args )
 }
 
 
+// threaded kernel for mVecSlerp
+struct mVecSlerpKernel
+{
+	mArgStream vecA, vecB, param;
+	double *out;
+
+	void operator()(unsigned int begin, unsigned int end)
+	{
+		MVector vA,vB,vC;
+		double p;
+
+		for (unsigned int i=begin;i<end;i++)
+		{
+			const double *a = vecA.ptr(i);
+			const double *b = vecB.ptr(i);
+			vA = MVector(a[0],a[1],a[2]);
+			vB = MVector(b[0],b[1],b[2]);
+
+			p = param[i];
+
+			// interpolate
+			if (p <= 0.0)
+				vC = vA;
+			else if (p >= 1.0)
+				vC = vB;
+			else
+			{
+				// do the rotation
+				MQuaternion quat(vA,vB,p);
+				vC = vA.rotateBy(quat);
+
+				// do the length
+				double lA = vA.length();
+				double lB = vB.length();
+
+				if (lA != lB)
+				{
+					double length = lA * (1-p) + lB * p;
+					vC.normalize();
+					vC *= length;
+				}
+			}
+
+			double *r = out + ELEMENTS_VEC*i;
+			r[0] = vC.x;
+			r[1] = vC.y;
+			r[2] = vC.z;
+		}
+	}
+};
+
 /*
    Function: mVecSlerp
 
@@ -1289,52 +1395,14 @@ MStatus mVecSlerp::doIt( const MArgList& args )
 
 
 	// do the actual job
-	unsigned int iterA, iterB,iterC;
-	iterA = iterB = iterC = 0;
-
-	MVector vecA,vecB, vecC;
-    double param;
 	MDoubleArray result = createEmptyVecArray(count);
 
-	for (unsigned int i=0;i<count;i++)
-	{
-		getVecFromArray(dblA,iterA,vecA);
-		getVecFromArray(dblB,iterB,vecB);
-		
-        param = dblC[iterC];
-        
-        // interpolate
-        if (param <= 0.0)
-            vecC = vecA;
-        else if (param >= 1.0)
-            vecC = vecB;
-        else
-        {
-            // do the rotation
-			MQuaternion quat(vecA,vecB,param);
-			vecC = vecA.rotateBy(quat);
-			
-			// do the length
-			double lA = vecA.length();
-			double lB = vecB.length();
-	
-			if (lA != lB)
-			{
-				double length = lA * (1-param) + lB * param;
-				vecC.normalize();
-				vecC *= length;
-			}
-			
-        }
-
-        
-        //
-        setVecToArray(result,i,vecC);
-        
-		iterA += incA;
-		iterB += incB;
-		iterC += incC;
-	}
+	mVecSlerpKernel kernel;
+	kernel.vecA = mArgStream(dblA, incA, ELEMENTS_VEC);
+	kernel.vecB = mArgStream(dblB, incB, ELEMENTS_VEC);
+	kernel.param = mArgStream(dblC, incC);
+	kernel.out = arrayPtr(result);
+	parallelFor(count, PARALLEL_GRAIN_MEDIUM, kernel);
 
 	setResult(result);
 	return MS::kSuccess;
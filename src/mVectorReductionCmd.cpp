@@ -0,0 +1,241 @@
+/* COPYRIGHT --
+ *
+ * This file is part of melfunctions, a collection of mel commands to for Autodesk Maya.
+ * melfunctions is (c) 2006 Carsten Kolve <carsten@kolve.com>
+ * and distributed under the terms of the GNU GPL V2.
+ * See the ./License-GPL.txt file in the source tree root for more information.
+ *
+ * THIS PACKAGE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES
+ * OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+// Title: Vector Array Reduction Commands
+//
+// About:
+// These commands reduce a whole vector array to a single vector (or a pair of vectors), eg. to get the
+// centre of mass or the bounding box of a particle cloud without looping over it in MEL.
+// Big arrays are processed in chunks on several threads, the chunk results are always combined in the same order,
+// so the results don't change with the number of threads.
+//
+// Important conventions:
+// All commands don't change the actual data in place, but create a new output.
+
+
+#include <maya/MDoubleArray.h>
+#include <maya/MArgList.h>
+#include <math.h>
+
+#include "../include/mHelperFunctions.h"
+#include "../include/mVectorReductionCmd.h"
+#include "../include/mArrayAlgorithms.h"
+
+namespace melfunctions
+{
+
+// get the vector array and the optional compensated summation switch
+static MStatus getArgVecCompensated(const MArgList& args, MDoubleArray &vecA, unsigned int &count, bool &compensated)
+{
+	compensated = false;
+
+	if ((args.length() != 1) && (args.length() != 2))
+	{
+		MGlobal::displayError("wrong number of arguments, expected a vector array and an optional int!");
+		return MS::kFailure;
+	}
+
+	MStatus stat = getDoubleArrayArg(args,0,vecA);
+	ERROR_FAIL(stat);
+
+	stat = vecIsValid(vecA,count);
+	ERROR_ARG(stat,1);
+
+	if (args.length() == 2)
+	{
+		int c;
+		stat = getIntArg(args,1,c);
+		ERROR_FAIL(stat);
+		compensated = (c != 0);
+	}
+
+	return MS::kSuccess;
+}
+
+
+//************************************************************************************************//
+/*
+   Function: mVecSum
+
+   Sum up all elements of a vector array. The sum is built pairwise which keeps the rounding error
+   small even for big arrays, for the highest precision use compensated (Kahan) summation.
+
+   Parameters:
+
+		$vecArrayA - the vector array
+		$compensated - (optional) 1 to use compensated summation (slower), default 0
+
+   Returns:
+
+      the sum of all vectors as a float[] with a single vector
+
+*/
+#define mel mVecSum(float[] $vecArrayA, int $compensated);
+#undef mel
+
+CREATOR(mVecSum)
+MStatus mVecSum::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray vecA;
+    unsigned int count;
+    bool compensated;
+	MStatus stat = getArgVecCompensated(args, vecA, count, compensated);
+	ERROR_FAIL(stat);
+
+	// do the actual job
+	MDoubleArray result = createEmptyVecArray(1);
+	reduceSum(arrayPtr(vecA), count, ELEMENTS_VEC, compensated, &result[0]);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mVecMean
+
+   Get the average of all elements of a vector array.
+
+   Parameters:
+
+		$vecArrayA - the vector array
+		$compensated - (optional) 1 to use compensated (Kahan) summation (slower), default 0
+
+   Returns:
+
+      the average vector as a float[] with a single vector
+
+*/
+#define mel mVecMean(float[] $vecArrayA, int $compensated);
+#undef mel
+
+CREATOR(mVecMean)
+MStatus mVecMean::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray vecA;
+    unsigned int count;
+    bool compensated;
+	MStatus stat = getArgVecCompensated(args, vecA, count, compensated);
+	ERROR_FAIL(stat);
+
+	if (count == 0)
+		USER_ERROR_CHECK(MS::kFailure,"mVecMean: the array is empty!");
+
+	// do the actual job
+	MDoubleArray result = createEmptyVecArray(1);
+	reduceSum(arrayPtr(vecA), count, ELEMENTS_VEC, compensated, &result[0]);
+
+	for (unsigned int c=0;c<ELEMENTS_VEC;c++)
+		result[c] /= count;
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mVecBounds
+
+   Get the axis aligned bounding box of the elements of a vector array.
+
+   Parameters:
+
+		$vecArrayA - the vector array
+
+   Returns:
+
+      the minimum and the maximum corner of the bounding box as a float[] with 2 vectors
+
+*/
+#define mel mVecBounds(float[] $vecArrayA);
+#undef mel
+
+CREATOR(mVecBounds)
+MStatus mVecBounds::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray vecA;
+    unsigned int count;
+	MStatus stat = getArgVec(args, vecA, count);
+	ERROR_FAIL(stat);
+
+	if (count == 0)
+		USER_ERROR_CHECK(MS::kFailure,"mVecBounds: the array is empty!");
+
+	// do the actual job
+	MDoubleArray result = createEmptyVecArray(2);
+	reduceMinMax(arrayPtr(vecA), count, ELEMENTS_VEC, &result[0], &result[ELEMENTS_VEC]);
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+//************************************************************************************************//
+/*
+   Function: mVecCentroid
+
+   Get the weighted average of the elements of a vector array, eg. the centre of mass of a particle cloud
+   when using the particle masses as weights.
+
+   Parameters:
+
+		$vecArrayA - the vector array
+		$dblArrayW - the weight of each vector (double array of the same size or a single value)
+
+   Returns:
+
+      the centroid as a float[] with a single vector
+
+*/
+#define mel mVecCentroid(float[] $vecArrayA, float[] $dblArrayW);
+#undef mel
+
+CREATOR(mVecCentroid)
+MStatus mVecCentroid::doIt( const MArgList& args )
+{
+	// get the arguments
+    MDoubleArray vecA, dblB;
+    unsigned int incA, incB, count;
+	MStatus stat = getArgVecDbl(args, vecA, dblB, incA, incB, count);
+	ERROR_FAIL(stat);
+
+	if (count == 0)
+		USER_ERROR_CHECK(MS::kFailure,"mVecCentroid: the array is empty!");
+
+	// do the actual job
+	MDoubleArray result = createEmptyVecArray(1);
+	double weightSum;
+
+	if (incA == 0)
+	{
+		// a single vector is its own centroid, as long as the weights don't cancel out
+		reduceSum(arrayPtr(dblB), count, 1, false, &weightSum);
+		for (unsigned int c=0;c<ELEMENTS_VEC;c++)
+			result[c] = vecA[c];
+	}
+	else
+		reduceWeightedSum(arrayPtr(vecA), count, ELEMENTS_VEC, arrayPtr(dblB), incB, false, &result[0], weightSum);
+
+	if (weightSum == 0.0)
+		USER_ERROR_CHECK(MS::kFailure,"mVecCentroid: the weights sum up to 0!");
+
+	if (incA != 0)
+		for (unsigned int c=0;c<ELEMENTS_VEC;c++)
+			result[c] /= weightSum;
+
+	setResult(result);
+	return MS::kSuccess;
+}
+
+}// namespace
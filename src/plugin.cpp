@@ -24,11 +24,15 @@
 
 #include "../include/mVectorManagementCmd.h"
 #include "../include/mVectorMathCmd.h"
+#include "../include/mVectorReductionCmd.h"
+
+#include "../include/mQuaternionMathCmd.h"
 
 #include "../include/mDoubleManagementCmd.h"
 #include "../include/mDoubleAlgebraCmd.h"
 #include "../include/mDoubleTrigonometryCmd.h"
 #include "../include/mDoubleLogicCmd.h"
+#include "../include/mDoubleReductionCmd.h"
 
 
 #include "../include/mUVManagementCmd.h"
@@ -38,12 +42,15 @@
 #include "../include/mAttrCmd.h"
 #include "../include/m2dShaderInfoCmd.h"
 #include "../include/mNeighbourInfoCmd.h"
+#include "../include/mArrayStoreCmd.h"
 
 #include "../include/mUVMeshInfoCmd.h"
 #include "../include/mVertexMeshInfoCmd.h"
 #include "../include/mInstancerInfoCmd.h"
 #include "../include/mAnimCurveInfoCmd.h"
 
+#include "../include/mThreadPool.h"
+
 
 
 MStatus initializePlugin( MObject obj )
@@ -56,6 +63,10 @@ MStatus initializePlugin( MObject obj )
 	MGlobal::displayInfo("Licensed under the GPL, if you find this useful please consider donating to a charity!");
 	MGlobal::displayInfo("Visit www.kolve.com for news, updates and information on the licenses!");
 	MGlobal::displayInfo("----------------------------------------------------------------------------------------");
+
+	// worker threads shared by all array commands, the pool itself is only started once
+	// every command registered, a failed load returns early and must not leave threads behind
+	REGISTER_COMMAND(melfunctions,mThreadCount)
     
 	// matrix management
     REGISTER_COMMAND(melfunctions,mMatCreate)
@@ -63,6 +74,7 @@ MStatus initializePlugin( MObject obj )
     REGISTER_COMMAND(melfunctions,mMatAppend)
     REGISTER_COMMAND(melfunctions,mMatGet)
     REGISTER_COMMAND(melfunctions,mMatSet)
+    REGISTER_COMMAND(melfunctions,mMatCompact)
 	REGISTER_COMMAND(melfunctions,mMatGetComponent)
 	REGISTER_COMMAND(melfunctions,mMatSetComponent)
 //	REGISTER_COMMAND(mMatGetRow)
@@ -74,6 +86,9 @@ MStatus initializePlugin( MObject obj )
 	REGISTER_COMMAND(melfunctions,mMatAdd)
 	REGISTER_COMMAND(melfunctions,mMatSub)
 	REGISTER_COMMAND(melfunctions,mMatMult)
+	REGISTER_COMMAND(melfunctions,mMatHierarchy)
+	REGISTER_COMMAND(melfunctions,mMatBlend)
+	REGISTER_COMMAND(melfunctions,mMatOrthonormalize)
 	REGISTER_COMMAND(melfunctions,mMatDblMult)
 	REGISTER_COMMAND(melfunctions,mMatIsEqual)
 	REGISTER_COMMAND(melfunctions,mMatIsNotEqual)    
@@ -86,19 +101,18 @@ MStatus initializePlugin( MObject obj )
 	REGISTER_COMMAND(melfunctions,mMatDet4x4)
 	REGISTER_COMMAND(melfunctions,mMatDet3x3)
 
-/*	REGISTER_COMMAND(mMatGetTranslation)
-	REGISTER_COMMAND(mMatSetTranslation)
-	REGISTER_COMMAND(mMatAddTranslation)
-	REGISTER_COMMAND(mMatGetRotation)
-	REGISTER_COMMAND(mMatSetRotation)
-	REGISTER_COMMAND(mMatAddRotation)
-	REGISTER_COMMAND(mMatGetScale)
-	REGISTER_COMMAND(mMatSetScale)
-	REGISTER_COMMAND(mMatAddScale)
-	REGISTER_COMMAND(mMatGetShear)
-	REGISTER_COMMAND(mMatSetShear)
-	REGISTER_COMMAND(mMatAddShear)
-*/
+	REGISTER_COMMAND(melfunctions,mMatGetTranslation)
+	REGISTER_COMMAND(melfunctions,mMatSetTranslation)
+	REGISTER_COMMAND(melfunctions,mMatAddTranslation)
+	REGISTER_COMMAND(melfunctions,mMatGetRotation)
+	REGISTER_COMMAND(melfunctions,mMatSetRotation)
+	REGISTER_COMMAND(melfunctions,mMatAddRotation)
+	REGISTER_COMMAND(melfunctions,mMatGetScale)
+	REGISTER_COMMAND(melfunctions,mMatSetScale)
+	REGISTER_COMMAND(melfunctions,mMatAddScale)
+	REGISTER_COMMAND(melfunctions,mMatGetShear)
+	REGISTER_COMMAND(melfunctions,mMatSetShear)
+	REGISTER_COMMAND(melfunctions,mMatAddShear)
 
 	// vector management
     REGISTER_COMMAND(melfunctions,mVecCreate)
@@ -107,6 +121,8 @@ MStatus initializePlugin( MObject obj )
     REGISTER_COMMAND(melfunctions,mVecAppend)
     REGISTER_COMMAND(melfunctions,mVecGet)
     REGISTER_COMMAND(melfunctions,mVecSet)
+    REGISTER_COMMAND(melfunctions,mVecGather)
+    REGISTER_COMMAND(melfunctions,mVecCompact)
 	REGISTER_COMMAND(melfunctions,mVecGetX)
 	REGISTER_COMMAND(melfunctions,mVecGetY)
 	REGISTER_COMMAND(melfunctions,mVecGetZ)
@@ -131,7 +147,7 @@ MStatus initializePlugin( MObject obj )
 	REGISTER_COMMAND(melfunctions,mVecDot)
 	REGISTER_COMMAND(melfunctions,mVecMult)    
 	REGISTER_COMMAND(melfunctions,mVecRotateByEuler)
-//	REGISTER_COMMAND(melfunctions,mVecRotateByQuat)
+	REGISTER_COMMAND(melfunctions,mVecRotateByQuat)
 	REGISTER_COMMAND(melfunctions,mVecRotateByAxisAngle)
 	REGISTER_COMMAND(melfunctions,mVecAimUpToEuler)    
 	REGISTER_COMMAND(melfunctions,mVecIsEqual)
@@ -146,6 +162,22 @@ MStatus initializePlugin( MObject obj )
 	REGISTER_COMMAND(melfunctions,mVecLerp)    
 	REGISTER_COMMAND(melfunctions,mVecSlerp)        
 
+	// vector reduction
+	REGISTER_COMMAND(melfunctions,mVecSum)
+	REGISTER_COMMAND(melfunctions,mVecMean)
+	REGISTER_COMMAND(melfunctions,mVecBounds)
+	REGISTER_COMMAND(melfunctions,mVecCentroid)
+
+	// quaternion math
+	REGISTER_COMMAND(melfunctions,mQuatCreateFromEuler)
+	REGISTER_COMMAND(melfunctions,mQuatCreateFromAxisAngle)
+	REGISTER_COMMAND(melfunctions,mQuatCreateFromMatrix)
+	REGISTER_COMMAND(melfunctions,mQuatMult)
+	REGISTER_COMMAND(melfunctions,mQuatConjugate)
+	REGISTER_COMMAND(melfunctions,mQuatSlerp)
+	REGISTER_COMMAND(melfunctions,mQuatNlerp)
+	REGISTER_COMMAND(melfunctions,mQuatToMatrix)
+
 
 	//uv management
 	REGISTER_COMMAND(melfunctions,mUVCreate)
@@ -159,6 +191,9 @@ MStatus initializePlugin( MObject obj )
 	REGISTER_COMMAND(melfunctions,mUVSetU)
 	REGISTER_COMMAND(melfunctions,mUVSetV)
 	REGISTER_COMMAND(melfunctions,mUVSetComponent)
+	REGISTER_COMMAND(melfunctions,mUVTransform)
+	REGISTER_COMMAND(melfunctions,mUVWrap)
+	REGISTER_COMMAND(melfunctions,mUVTile)
 
 
 	// double management
@@ -167,6 +202,11 @@ MStatus initializePlugin( MObject obj )
 	REGISTER_COMMAND(melfunctions,mDblAppend)
 	REGISTER_COMMAND(melfunctions,mDblGet)
 	REGISTER_COMMAND(melfunctions,mDblSet)
+	REGISTER_COMMAND(melfunctions,mDblSort)
+	REGISTER_COMMAND(melfunctions,mDblArgSort)
+	REGISTER_COMMAND(melfunctions,mDblScan)
+	REGISTER_COMMAND(melfunctions,mDblCompact)
+	REGISTER_COMMAND(melfunctions,mDblWhere)
 
 	// double math
 	REGISTER_COMMAND(melfunctions,mDblAdd)
@@ -229,6 +269,14 @@ MStatus initializePlugin( MObject obj )
 	REGISTER_COMMAND(melfunctions,mDblLinStep)
 	REGISTER_COMMAND(melfunctions,mDblFit)
 
+	// double reduction
+	REGISTER_COMMAND(melfunctions,mDblSum)
+	REGISTER_COMMAND(melfunctions,mDblMean)
+	REGISTER_COMMAND(melfunctions,mDblMinMax)
+	REGISTER_COMMAND(melfunctions,mDblVariance)
+	REGISTER_COMMAND(melfunctions,mDblHistogram)
+	REGISTER_COMMAND(melfunctions,mDblDigitize)
+
 	// noise
 	REGISTER_COMMAND(melfunctions,mSeed)    
 	REGISTER_COMMAND(melfunctions,mDblRand)
@@ -241,6 +289,16 @@ MStatus initializePlugin( MObject obj )
     REGISTER_COMMAND(melfunctions,mVec3dNoise )      
  	REGISTER_COMMAND(melfunctions,mDbl3dTurbulence)                 
  	REGISTER_COMMAND(melfunctions,mVec3dTurbulence)  
+	REGISTER_COMMAND(melfunctions,mDbl3dBasisNoise)
+	REGISTER_COMMAND(melfunctions,mDbl3dFBm)
+	REGISTER_COMMAND(melfunctions,mDbl3dMultiFractal)
+	REGISTER_COMMAND(melfunctions,mDbl3dHeteroTerrain)
+	REGISTER_COMMAND(melfunctions,mDbl3dHybridMultiFractal)
+	REGISTER_COMMAND(melfunctions,mDbl3dRidgedMultiFractal)
+	REGISTER_COMMAND(melfunctions,mDbl3dVLNoise)
+	REGISTER_COMMAND(melfunctions,mVec3dNoiseGradient)
+	REGISTER_COMMAND(melfunctions,mVec3dCurlNoise)
+	REGISTER_COMMAND(melfunctions,mDblNoiseGrid)
           
    	// attributes
     REGISTER_COMMAND(melfunctions,mDblSetAttr)    
@@ -252,11 +310,18 @@ MStatus initializePlugin( MObject obj )
      
 	// neighbour info
     REGISTER_COMMAND(melfunctions,mNeighbourInfo)
+
+	// plugin side array stores
+    REGISTER_COMMAND(melfunctions,mArrayStore)
+    REGISTER_COMMAND(melfunctions,mStoreVecMatMult)
+    REGISTER_COMMAND(melfunctions,mStoreMatMult)
+    REGISTER_COMMAND(melfunctions,mStore3dNoise)
     
     // mesh functionality
 //  REGISTER_COMMAND(melfunctions,mUVMeshInfo)    
     REGISTER_COMMAND(melfunctions,mVertexMeshInfo)        
 
+	melfunctions::mThreadPool::init();
 
 	return status;
 }
@@ -266,12 +331,17 @@ MStatus uninitializePlugin( MObject obj )
 	MStatus   status;
 	MFnPlugin plugin( obj );
 
+	// worker threads, stopped first as a failed deregistration returns early
+	melfunctions::mThreadPool::release();
+	DEREGISTER_COMMAND(mThreadCount)
+
 	// matrix management
     DEREGISTER_COMMAND(mMatCreate)
     DEREGISTER_COMMAND(mMatSize)
     DEREGISTER_COMMAND(mMatAppend)
     DEREGISTER_COMMAND(mMatGet)
     DEREGISTER_COMMAND(mMatSet)
+    DEREGISTER_COMMAND(mMatCompact)
 	DEREGISTER_COMMAND(mMatGetComponent)
 	DEREGISTER_COMMAND(mMatSetComponent)
 //	REGISTER_COMMAND(mMatGetRow)
@@ -283,6 +353,9 @@ MStatus uninitializePlugin( MObject obj )
 	DEREGISTER_COMMAND(mMatAdd)
 	DEREGISTER_COMMAND(mMatSub)
 	DEREGISTER_COMMAND(mMatMult)
+	DEREGISTER_COMMAND(mMatHierarchy)
+	DEREGISTER_COMMAND(mMatBlend)
+	DEREGISTER_COMMAND(mMatOrthonormalize)
 	DEREGISTER_COMMAND(mMatDblMult)
 	DEREGISTER_COMMAND(mMatIsEqual)
 	DEREGISTER_COMMAND(mMatIsNotEqual)    
@@ -295,19 +368,18 @@ MStatus uninitializePlugin( MObject obj )
 	DEREGISTER_COMMAND(mMatDet4x4)
 	DEREGISTER_COMMAND(mMatDet3x3)
 
-/*	REGISTER_COMMAND(mMatGetTranslation)
-	REGISTER_COMMAND(mMatSetTranslation)
-	REGISTER_COMMAND(mMatAddTranslation)
-	REGISTER_COMMAND(mMatGetRotation)
-	REGISTER_COMMAND(mMatSetRotation)
-	REGISTER_COMMAND(mMatAddRotation)
-	REGISTER_COMMAND(mMatGetScale)
-	REGISTER_COMMAND(mMatSetScale)
-	REGISTER_COMMAND(mMatAddScale)
-	REGISTER_COMMAND(mMatGetShear)
-	REGISTER_COMMAND(mMatSetShear)
-	REGISTER_COMMAND(mMatAddShear)
-*/
+	DEREGISTER_COMMAND(mMatGetTranslation)
+	DEREGISTER_COMMAND(mMatSetTranslation)
+	DEREGISTER_COMMAND(mMatAddTranslation)
+	DEREGISTER_COMMAND(mMatGetRotation)
+	DEREGISTER_COMMAND(mMatSetRotation)
+	DEREGISTER_COMMAND(mMatAddRotation)
+	DEREGISTER_COMMAND(mMatGetScale)
+	DEREGISTER_COMMAND(mMatSetScale)
+	DEREGISTER_COMMAND(mMatAddScale)
+	DEREGISTER_COMMAND(mMatGetShear)
+	DEREGISTER_COMMAND(mMatSetShear)
+	DEREGISTER_COMMAND(mMatAddShear)
 
 	// vector management
     DEREGISTER_COMMAND(mVecCreate)
@@ -316,6 +388,8 @@ MStatus uninitializePlugin( MObject obj )
     DEREGISTER_COMMAND(mVecAppend)
     DEREGISTER_COMMAND(mVecGet)
     DEREGISTER_COMMAND(mVecSet)
+    DEREGISTER_COMMAND(mVecGather)
+    DEREGISTER_COMMAND(mVecCompact)
 	DEREGISTER_COMMAND(mVecGetX)
 	DEREGISTER_COMMAND(mVecGetY)
 	DEREGISTER_COMMAND(mVecGetZ)
@@ -340,7 +414,7 @@ MStatus uninitializePlugin( MObject obj )
 	DEREGISTER_COMMAND(mVecDot)
 	DEREGISTER_COMMAND(mVecMult)    
 	DEREGISTER_COMMAND(mVecRotateByEuler)
-//	DEREGISTER_COMMAND(mVecRotateByQuat)
+	DEREGISTER_COMMAND(mVecRotateByQuat)
 	DEREGISTER_COMMAND(mVecRotateByAxisAngle)
 	DEREGISTER_COMMAND(mVecAimUpToEuler)        
 	DEREGISTER_COMMAND(mVecIsEqual)
@@ -355,6 +429,22 @@ MStatus uninitializePlugin( MObject obj )
 	DEREGISTER_COMMAND(mVecLerp)    
 	DEREGISTER_COMMAND(mVecSlerp)        
 
+	// vector reduction
+	DEREGISTER_COMMAND(mVecSum)
+	DEREGISTER_COMMAND(mVecMean)
+	DEREGISTER_COMMAND(mVecBounds)
+	DEREGISTER_COMMAND(mVecCentroid)
+
+	// quaternion math
+	DEREGISTER_COMMAND(mQuatCreateFromEuler)
+	DEREGISTER_COMMAND(mQuatCreateFromAxisAngle)
+	DEREGISTER_COMMAND(mQuatCreateFromMatrix)
+	DEREGISTER_COMMAND(mQuatMult)
+	DEREGISTER_COMMAND(mQuatConjugate)
+	DEREGISTER_COMMAND(mQuatSlerp)
+	DEREGISTER_COMMAND(mQuatNlerp)
+	DEREGISTER_COMMAND(mQuatToMatrix)
+
 
 	//uv management
 	DEREGISTER_COMMAND(mUVCreate)
@@ -368,6 +458,9 @@ MStatus uninitializePlugin( MObject obj )
 	DEREGISTER_COMMAND(mUVSetU)
 	DEREGISTER_COMMAND(mUVSetV)
 	DEREGISTER_COMMAND(mUVSetComponent)
+	DEREGISTER_COMMAND(mUVTransform)
+	DEREGISTER_COMMAND(mUVWrap)
+	DEREGISTER_COMMAND(mUVTile)
 
 
 	// double management
@@ -376,6 +469,11 @@ MStatus uninitializePlugin( MObject obj )
 	DEREGISTER_COMMAND(mDblAppend)
 	DEREGISTER_COMMAND(mDblGet)
 	DEREGISTER_COMMAND(mDblSet)
+	DEREGISTER_COMMAND(mDblSort)
+	DEREGISTER_COMMAND(mDblArgSort)
+	DEREGISTER_COMMAND(mDblScan)
+	DEREGISTER_COMMAND(mDblCompact)
+	DEREGISTER_COMMAND(mDblWhere)
 
 	// double math
 	DEREGISTER_COMMAND(mDblAdd)
@@ -438,6 +536,14 @@ MStatus uninitializePlugin( MObject obj )
 	DEREGISTER_COMMAND(mDblLinStep)
 	DEREGISTER_COMMAND(mDblFit)
 
+	// double reduction
+	DEREGISTER_COMMAND(mDblSum)
+	DEREGISTER_COMMAND(mDblMean)
+	DEREGISTER_COMMAND(mDblMinMax)
+	DEREGISTER_COMMAND(mDblVariance)
+	DEREGISTER_COMMAND(mDblHistogram)
+	DEREGISTER_COMMAND(mDblDigitize)
+
 	// noise
 	DEREGISTER_COMMAND(mSeed)    
 	DEREGISTER_COMMAND(mDblRand)
@@ -450,6 +556,16 @@ MStatus uninitializePlugin( MObject obj )
  	DEREGISTER_COMMAND(mVec3dNoise )                
  	DEREGISTER_COMMAND(mDbl3dTurbulence)
  	DEREGISTER_COMMAND(mVec3dTurbulence)    
+	DEREGISTER_COMMAND(mDbl3dBasisNoise)
+	DEREGISTER_COMMAND(mDbl3dFBm)
+	DEREGISTER_COMMAND(mDbl3dMultiFractal)
+	DEREGISTER_COMMAND(mDbl3dHeteroTerrain)
+	DEREGISTER_COMMAND(mDbl3dHybridMultiFractal)
+	DEREGISTER_COMMAND(mDbl3dRidgedMultiFractal)
+	DEREGISTER_COMMAND(mDbl3dVLNoise)
+	DEREGISTER_COMMAND(mVec3dNoiseGradient)
+	DEREGISTER_COMMAND(mVec3dCurlNoise)
+	DEREGISTER_COMMAND(mDblNoiseGrid)
     
 	// attributes
     DEREGISTER_COMMAND(mDblSetAttr)    
@@ -462,6 +578,12 @@ MStatus uninitializePlugin( MObject obj )
         
 	// neighbour info
     DEREGISTER_COMMAND(mNeighbourInfo)
+
+	// plugin side array stores
+    DEREGISTER_COMMAND(mArrayStore)
+    DEREGISTER_COMMAND(mStoreVecMatMult)
+    DEREGISTER_COMMAND(mStoreMatMult)
+    DEREGISTER_COMMAND(mStore3dNoise)
     
     // mesh functionality
 //  DEREGISTER_COMMAND(mUVMeshInfo)    